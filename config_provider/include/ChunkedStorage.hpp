@@ -0,0 +1,406 @@
+#ifndef CHUNKED_STORAGE_HPP
+#define CHUNKED_STORAGE_HPP
+
+#include <esp_log.h>
+#include <esp_rom_crc.h>
+#include <etl/string.h>
+
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <expected>
+#include <iterator>
+#include <span>
+
+#include "esp_err.h"
+#include "esp_system_error.hpp"
+#include "nvs_handle.hpp"
+
+/**
+ * Values that do not fit in a single NVS entry are split over numbered chunk entries.
+ *
+ * A header entry holds the length, checksum and chunk count, and is only written after all chunks are in place.
+ * Chunks alternate between two slots, so the previous value stays intact until the new header replaces the old
+ * one. NVS writes a single entry atomically, so after a power loss either the old or the new value is visible,
+ * never a partially written one.
+ *
+ * Keys are derived from a checksum of the original key, as the original key may already use the maximum length:
+ *   <8 hex digits>h          header
+ *   <8 hex digits><a|b><n>   chunk n of slot a or b
+ * Two keys can share a checksum, so the header stores the original key. A value whose header names another key
+ * does not exist for this key, and writing it is refused instead of overwriting the other value.
+ */
+namespace sdk::chunked {
+
+    using ChunkKey = etl::string<NVS_KEY_NAME_MAX_SIZE - 1>;
+
+    /**
+     * @brief Stored in front of every chunked value
+     */
+    struct Header {
+        uint32_t magic;
+        uint32_t length;
+        uint32_t crc;
+        uint16_t chunkCount;
+        uint8_t  slot;
+        uint8_t  reserved;
+        /**
+         * @brief Original key the value belongs to, zero padded
+         */
+        char key[NVS_KEY_NAME_MAX_SIZE];
+    };
+
+    static constexpr uint32_t headerMagic = 0x4b4e4843; // "CHNK"
+    static constexpr size_t   chunkSize   = CONFIG_LARGE_OBJECT_CHUNK_SIZE;
+    // Chunk keys have room for three decimal digits
+    static constexpr uint16_t maxChunks = 999;
+
+    static constexpr char TAG[] = "CHUNKED STORAGE";
+
+    inline uint32_t keyId(const char* key) {
+        return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(key), std::strlen(key));
+    }
+
+    inline ChunkKey headerKey(const char* key) {
+        char buffer[NVS_KEY_NAME_MAX_SIZE];
+        snprintf(buffer, sizeof(buffer), "%08" PRIx32 "h", keyId(key));
+        return buffer;
+    }
+
+    inline ChunkKey chunkKey(const char* key, uint8_t slot, uint16_t index) {
+        char buffer[NVS_KEY_NAME_MAX_SIZE];
+        snprintf(buffer, sizeof(buffer), "%08" PRIx32 "%c%u", keyId(key), slot == 0 ? 'a' : 'b', index);
+        return buffer;
+    }
+
+    /**
+     * @brief Read the header stored under the checksum of a key, whichever key it belongs to
+     * @param handle Open NVS handle
+     * @param key Key of the original value
+     * @return The header, ESP_ERR_NVS_NOT_FOUND if no chunked value exists, ESP_ERR_INVALID_VERSION if the header is malformed
+     */
+    inline std::expected<Header, std::error_code> readAnyHeader(nvs::NVSHandle& handle, const char* key) {
+        Header header{};
+        if (const auto err = handle.get_blob(headerKey(key).c_str(), &header, sizeof(header)); err != ESP_OK) {
+            return std::unexpected(std::make_error_code(err));
+        }
+        if (header.magic != headerMagic || header.slot > 1 || header.chunkCount > maxChunks || header.key[sizeof(header.key) - 1] != '\0') {
+            ESP_LOGE(TAG, "Malformed header for %s", key);
+            return std::unexpected(std::make_error_code(ESP_ERR_INVALID_VERSION));
+        }
+        return header;
+    }
+
+    inline bool belongsTo(const Header& header, const char* key) {
+        return std::strncmp(header.key, key, sizeof(header.key)) == 0;
+    }
+
+    /**
+     * @brief Read the header of a chunked value
+     * @param handle Open NVS handle
+     * @param key Key of the original value
+     * @return The header, ESP_ERR_NVS_NOT_FOUND if no chunked value exists for this key, ESP_ERR_INVALID_VERSION if the header is malformed
+     */
+    inline std::expected<Header, std::error_code> readHeader(nvs::NVSHandle& handle, const char* key) {
+        auto header = readAnyHeader(handle, key);
+        if (header && !belongsTo(*header, key)) {
+            return std::unexpected(std::make_error_code(ESP_ERR_NVS_NOT_FOUND));
+        }
+        return header;
+    }
+
+    /**
+     * @brief Erase the chunks of a slot, starting at the given index, until no further chunk is found
+     * @param handle Open NVS handle
+     * @param key Key of the original value
+     * @param slot Slot to erase
+     * @param from First chunk index to erase
+     */
+    inline void eraseSlot(nvs::NVSHandle& handle, const char* key, uint8_t slot, uint16_t from = 0) {
+        for (uint16_t index = from; index < maxChunks; index++) {
+            if (handle.erase_item(chunkKey(key, slot, index).c_str()) != ESP_OK) {
+                return;
+            }
+        }
+    }
+
+    /**
+     * @brief Remove a chunked value, the header goes first so a power loss never leaves a readable partial value
+     * @param handle Open NVS handle
+     * @param key Key of the original value
+     * @return Error code of type esp_err_t, ESP_ERR_NVS_NOT_FOUND if no chunked value exists
+     */
+    inline std::error_code erase(nvs::NVSHandle& handle, const char* key) {
+        // The chunks of a value whose key has the same checksum are not ours to erase
+        if (const auto header = readAnyHeader(handle, key); header && !belongsTo(*header, key)) {
+            return std::make_error_code(ESP_ERR_NVS_NOT_FOUND);
+        }
+        if (const auto err = handle.erase_item(headerKey(key).c_str()); err != ESP_OK) {
+            return std::make_error_code(err);
+        }
+        eraseSlot(handle, key, 0);
+        eraseSlot(handle, key, 1);
+        return {};
+    }
+
+    /**
+     * @brief Streams a value into chunk entries, it only becomes visible once finish() succeeds
+     *
+     *        When the checksum of the key is taken by the value of another key, every write fails with
+     *        ESP_ERR_INVALID_STATE and the other value is left alone.
+     */
+    class Writer {
+    public:
+        Writer(nvs::NVSHandle& handle, const char* key) : m_handle(handle), m_key(key) {
+            auto previous = readAnyHeader(m_handle, key);
+            m_header      = {.magic      = headerMagic,
+                             .length     = 0,
+                             .crc        = 0,
+                             .chunkCount = 0,
+                             .slot       = static_cast<uint8_t>(previous ? previous->slot ^ 1 : 0),
+                             .reserved   = 0,
+                             .key        = {}};
+            std::strncpy(m_header.key, key, sizeof(m_header.key) - 1);
+            if (previous && !belongsTo(*previous, key)) {
+                ESP_LOGE(TAG, "Key %s has the same checksum as %s", key, previous->key);
+                m_error = std::make_error_code(ESP_ERR_INVALID_STATE);
+            }
+        }
+
+        Writer(const Writer&)            = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        /**
+         * @brief Append data to the value
+         * @param data Data to append
+         * @return Error code of type esp_err_t, errors are sticky
+         */
+        std::error_code write(std::span<const uint8_t> data) {
+            while (!m_error && !data.empty()) {
+                const size_t count = std::min(data.size(), m_buffer.size() - m_used);
+                std::memcpy(m_buffer.data() + m_used, data.data(), count);
+                m_used += count;
+                data = data.subspan(count);
+                if (m_used == m_buffer.size()) {
+                    flush();
+                }
+            }
+            return m_error;
+        }
+
+        /**
+         * @brief Write the remaining data and publish the value by writing its header
+         * @param commit Commit changes to NVS after publishing, if false, the caller commits
+         * @return Error code of type esp_err_t, on error the previous value is still intact
+         */
+        std::error_code finish(const bool commit = true) {
+            if (!m_error && m_used > 0) {
+                flush();
+            }
+            if (m_error) {
+                return m_error;
+            }
+            if (const auto err = m_handle.set_blob(headerKey(m_key.c_str()).c_str(), &m_header, sizeof(m_header)); err != ESP_OK) {
+                ESP_LOGE(TAG, "Error publishing %s: %s", m_key.c_str(), esp_err_to_name(err));
+                return m_error = std::make_error_code(err);
+            }
+
+            // The new value is live, leftovers of the previous value or an interrupted write can go
+            eraseSlot(m_handle, m_key.c_str(), m_header.slot, m_header.chunkCount);
+            eraseSlot(m_handle, m_key.c_str(), m_header.slot ^ 1);
+            if (commit) {
+                return std::make_error_code(m_handle.commit());
+            }
+            return {};
+        }
+
+        /**
+         * @brief Get the amount of bytes written so far
+         */
+        [[nodiscard]] size_t size() const {
+            return m_header.length + m_used;
+        }
+
+    private:
+        void flush() {
+            if (m_header.chunkCount == maxChunks) {
+                ESP_LOGE(TAG, "Value for %s exceeds %u chunks", m_key.c_str(), maxChunks);
+                m_error = std::make_error_code(ESP_ERR_INVALID_SIZE);
+                return;
+            }
+            const auto key = chunkKey(m_key.c_str(), m_header.slot, m_header.chunkCount);
+            if (const auto err = m_handle.set_blob(key.c_str(), m_buffer.data(), m_used); err != ESP_OK) {
+                ESP_LOGE(TAG, "Error writing chunk %s: %s", key.c_str(), esp_err_to_name(err));
+                m_error = std::make_error_code(err);
+                return;
+            }
+            m_header.crc = esp_rom_crc32_le(m_header.crc, m_buffer.data(), m_used);
+            m_header.length += m_used;
+            m_header.chunkCount++;
+            m_used = 0;
+        }
+
+        nvs::NVSHandle&                       m_handle;
+        etl::string<NVS_KEY_NAME_MAX_SIZE>    m_key;
+        Header                                m_header{};
+        std::array<uint8_t, chunkSize>        m_buffer{};
+        size_t                                m_used{0};
+        std::error_code                       m_error{};
+    };
+
+    /**
+     * @brief Streams a chunked value, keeping only a single chunk in memory
+     *
+     *        The checksum can only be verified once the last chunk is loaded. When it does not match, reading stops
+     *        and error() returns ESP_ERR_INVALID_CRC, so consumers must check error() after reading everything.
+     */
+    class Reader {
+    public:
+        /**
+         * @brief Input iterator over the bytes of the value, allows the json parser to read straight from NVS
+         */
+        class Iterator {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type        = char;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = const char*;
+            using reference         = const char&;
+
+            explicit Iterator(Reader* reader = nullptr) : m_reader(reader) {}
+
+            reference operator*() const { return m_reader->current(); }
+
+            Iterator& operator++() {
+                m_reader->advance();
+                return *this;
+            }
+
+            void operator++(int) { m_reader->advance(); }
+
+            bool operator==(const Iterator& other) const {
+                return atEnd() == other.atEnd();
+            }
+
+        private:
+            [[nodiscard]] bool atEnd() const { return m_reader == nullptr || m_reader->atEnd(); }
+
+            Reader* m_reader;
+        };
+
+        Reader(nvs::NVSHandle& handle, const char* key) : m_handle(handle), m_key(key) {}
+
+        Reader(const Reader&)            = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        /**
+         * @brief Read the header of the value, call before reading
+         * @return Error code of type esp_err_t, ESP_ERR_NVS_NOT_FOUND if no chunked value exists
+         */
+        std::error_code open() {
+            auto header = readHeader(m_handle, m_key.c_str());
+            if (!header) {
+                return m_error = header.error();
+            }
+            m_header = header.value();
+            m_error  = {};
+            return {};
+        }
+
+        /**
+         * @brief Copy the next bytes of the value
+         * @param buffer Place to store the bytes
+         * @return Amount of bytes copied, 0 at the end of the value
+         */
+        std::expected<size_t, std::error_code> read(std::span<uint8_t> buffer) {
+            size_t count = 0;
+            while (count < buffer.size() && fill()) {
+                const size_t available = std::min(buffer.size() - count, m_chunkLength - m_position);
+                std::memcpy(buffer.data() + count, m_buffer.data() + m_position, available);
+                m_position += available;
+                m_consumed += available;
+                count += available;
+            }
+            if (m_error) {
+                return std::unexpected(m_error);
+            }
+            return count;
+        }
+
+        Iterator begin() { return Iterator(this); }
+
+        Iterator end() { return Iterator(); }
+
+        /**
+         * @brief Total size of the value
+         */
+        [[nodiscard]] size_t size() const { return m_header.length; }
+
+        /**
+         * @brief Error that stopped reading, if any
+         */
+        [[nodiscard]] std::error_code error() const { return m_error; }
+
+    private:
+        [[nodiscard]] bool atEnd() {
+            return !fill();
+        }
+
+        const char& current() {
+            return reinterpret_cast<const char&>(m_buffer[m_position]);
+        }
+
+        void advance() {
+            m_position++;
+            m_consumed++;
+        }
+
+        /**
+         * @brief Makes sure unread data is buffered, loading the next chunk when needed
+         * @return False at the end of the value or on error
+         */
+        bool fill() {
+            if (m_error || m_consumed >= m_header.length) {
+                return false;
+            }
+            if (m_position < m_chunkLength) {
+                return true;
+            }
+
+            const auto key    = chunkKey(m_key.c_str(), m_header.slot, m_nextChunk);
+            const auto length = std::min(m_buffer.size(), static_cast<size_t>(m_header.length) - m_consumed);
+            if (const auto err = m_handle.get_blob(key.c_str(), m_buffer.data(), length); err != ESP_OK) {
+                ESP_LOGE(TAG, "Error reading chunk %s: %s", key.c_str(), esp_err_to_name(err));
+                m_error = std::make_error_code(err);
+                return false;
+            }
+            m_crc         = esp_rom_crc32_le(m_crc, m_buffer.data(), length);
+            m_chunkLength = length;
+            m_position    = 0;
+            m_nextChunk++;
+
+            if (m_consumed + length == m_header.length && m_crc != m_header.crc) {
+                ESP_LOGE(TAG, "Checksum mismatch for %s", m_key.c_str());
+                m_error = std::make_error_code(ESP_ERR_INVALID_CRC);
+                return false;
+            }
+            return true;
+        }
+
+        nvs::NVSHandle&                    m_handle;
+        etl::string<NVS_KEY_NAME_MAX_SIZE> m_key;
+        Header                             m_header{};
+        std::array<uint8_t, chunkSize>     m_buffer{};
+        size_t                             m_chunkLength{0};
+        size_t                             m_position{0};
+        size_t                             m_consumed{0};
+        uint16_t                           m_nextChunk{0};
+        uint32_t                           m_crc{0};
+        std::error_code                    m_error{};
+    };
+
+} // namespace sdk::chunked
+
+#endif // CHUNKED_STORAGE_HPP
@@ -0,0 +1,218 @@
+#ifndef CONFIG_METRICS_HPP
+#define CONFIG_METRICS_HPP
+
+#include <esp_log.h>
+#include <etl/string.h>
+#include <etl/vector.h>
+
+#include <array>
+#include <expected>
+#include <mutex>
+
+#include "esp_err.h"
+#include "esp_system_error.hpp"
+#include "nvs.h"
+
+namespace sdk {
+
+    /**
+     * @brief Tracks the NVS write traffic caused by ConfigProvider, to find components that wear out the flash
+     *
+     *        Counters are kept in fixed size tables, reading them only takes a lock and a walk over those tables.
+     *        When CONFIG_NVS_WRITE_METRICS is disabled, recording compiles to nothing.
+     */
+    class ConfigMetrics {
+    public:
+        using Name = etl::string<NVS_NS_NAME_MAX_SIZE>;
+
+        /**
+         * @brief Upper bounds of the commit latency histogram buckets in microseconds, the last bucket has no bound
+         */
+        static constexpr std::array<uint32_t, 11> commitLatencyBounds{100, 200, 500, 1'000, 2'000, 5'000, 10'000, 20'000, 50'000, 100'000, 200'000};
+
+        using Histogram = std::array<uint32_t, commitLatencyBounds.size() + 1>;
+
+        /**
+         * @brief Write traffic of a single key
+         */
+        struct KeyMetrics {
+            Name     nvsNamespace;
+            Name     key;
+            uint32_t writes;
+            uint32_t erases;
+            /**
+             * @brief Payload bytes written
+             */
+            uint64_t bytesWritten;
+            /**
+             * @brief Estimate of 32 byte NVS entries written, which is what actually wears the flash
+             */
+            uint64_t entriesWritten;
+        };
+
+        /**
+         * @brief Commit and erase traffic of a namespace
+         */
+        struct NamespaceMetrics {
+            Name      nvsNamespace;
+            uint32_t  commits;
+            uint32_t  namespaceErases;
+            uint64_t  commitLatencyTotal;
+            Histogram commitLatency;
+        };
+
+        /**
+         * @brief Record a write of an item
+         * @param nvsNamespace Namespace of the item
+         * @param key Key of the item
+         * @param bytes Size of the written payload, variable length items are expected to include the zero terminator
+         * @param variableLength Whether the item is a string or blob, which take a header entry and data entries
+         */
+        static void recordWrite(const char* nvsNamespace, const char* key, size_t bytes, bool variableLength) {
+#ifdef CONFIG_NVS_WRITE_METRICS
+            std::lock_guard lock(m_mutex);
+            if (auto* metrics = findKey(nvsNamespace, key)) {
+                metrics->writes++;
+                metrics->bytesWritten += bytes;
+                metrics->entriesWritten += variableLength ? 1 + (bytes + NVS_ENTRY_SIZE - 1) / NVS_ENTRY_SIZE : 1;
+            }
+#endif
+        }
+
+        /**
+         * @brief Record the erase of an item
+         * @param nvsNamespace Namespace of the item
+         * @param key Key of the item
+         */
+        static void recordErase(const char* nvsNamespace, const char* key) {
+#ifdef CONFIG_NVS_WRITE_METRICS
+            std::lock_guard lock(m_mutex);
+            if (auto* metrics = findKey(nvsNamespace, key)) {
+                metrics->erases++;
+            }
+#endif
+        }
+
+        /**
+         * @brief Record the erase of an entire namespace
+         * @param nvsNamespace Namespace that was erased
+         */
+        static void recordNamespaceErase(const char* nvsNamespace) {
+#ifdef CONFIG_NVS_WRITE_METRICS
+            std::lock_guard lock(m_mutex);
+            if (auto* metrics = findNamespace(nvsNamespace)) {
+                metrics->namespaceErases++;
+            }
+#endif
+        }
+
+        /**
+         * @brief Record a commit
+         * @param nvsNamespace Namespace of the committed handle
+         * @param microseconds Time the commit took
+         */
+        static void recordCommit(const char* nvsNamespace, int64_t microseconds) {
+#ifdef CONFIG_NVS_WRITE_METRICS
+            std::lock_guard lock(m_mutex);
+            if (auto* metrics = findNamespace(nvsNamespace)) {
+                metrics->commits++;
+                metrics->commitLatencyTotal += microseconds;
+                size_t bucket = 0;
+                while (bucket < commitLatencyBounds.size() && microseconds > commitLatencyBounds[bucket]) { bucket++; }
+                metrics->commitLatency[bucket]++;
+            }
+#endif
+        }
+
+        /**
+         * @brief Visit the metrics of every key that has been written or erased
+         * @param visitor Called with a const KeyMetrics&, don't call other ConfigMetrics functions from it
+         */
+        template<typename VISITOR>
+        static void forEachKey(VISITOR&& visitor) {
+            std::lock_guard lock(m_mutex);
+            for (const auto& metrics: m_keys) { visitor(metrics); }
+        }
+
+        /**
+         * @brief Visit the metrics of every namespace that has been committed or erased
+         * @param visitor Called with a const NamespaceMetrics&, don't call other ConfigMetrics functions from it
+         */
+        template<typename VISITOR>
+        static void forEachNamespace(VISITOR&& visitor) {
+            std::lock_guard lock(m_mutex);
+            for (const auto& metrics: m_namespaces) { visitor(metrics); }
+        }
+
+        /**
+         * @brief Get the amount of keys that were not tracked because the table was full
+         */
+        static uint32_t droppedKeys() {
+            std::lock_guard lock(m_mutex);
+            return m_droppedKeys;
+        }
+
+        /**
+         * @brief Get the entry statistics of an NVS partition
+         * @param partition Label of the partition, nullptr for the default partition
+         * @return Used, free and total entry counts, or an error of type esp_err_t
+         */
+        static std::expected<nvs_stats_t, std::error_code> nvsStats(const char* partition = nullptr) {
+            nvs_stats_t stats{};
+            if (const auto err = nvs_get_stats(partition, &stats); err != ESP_OK) {
+                return std::unexpected(std::make_error_code(err));
+            }
+            return stats;
+        }
+
+        /**
+         * @brief Clear all counters
+         */
+        static void reset() {
+            std::lock_guard lock(m_mutex);
+            m_keys.clear();
+            m_namespaces.clear();
+            m_droppedKeys = 0;
+        }
+
+    private:
+        static constexpr char   TAG[]          = "CONFIG METRICS";
+        static constexpr size_t NVS_ENTRY_SIZE = 32;
+
+        static inline std::mutex m_mutex;
+
+        static inline etl::vector<KeyMetrics, CONFIG_NVS_WRITE_METRICS_MAX_KEYS>             m_keys{};
+        static inline etl::vector<NamespaceMetrics, CONFIG_NVS_WRITE_METRICS_MAX_NAMESPACES> m_namespaces{};
+        static inline uint32_t                                                              m_droppedKeys{0};
+
+        static KeyMetrics* findKey(const char* nvsNamespace, const char* key) {
+            for (auto& metrics: m_keys) {
+                if (metrics.key == key && metrics.nvsNamespace == nvsNamespace) {
+                    return &metrics;
+                }
+            }
+            if (m_keys.full()) {
+                if (m_droppedKeys++ == 0) {
+                    ESP_LOGW(TAG, "Key table is full, not tracking %s/%s", nvsNamespace, key);
+                }
+                return nullptr;
+            }
+            return &m_keys.emplace_back(KeyMetrics{.nvsNamespace = nvsNamespace, .key = key, .writes = 0, .erases = 0, .bytesWritten = 0, .entriesWritten = 0});
+        }
+
+        static NamespaceMetrics* findNamespace(const char* nvsNamespace) {
+            for (auto& metrics: m_namespaces) {
+                if (metrics.nvsNamespace == nvsNamespace) {
+                    return &metrics;
+                }
+            }
+            if (m_namespaces.full()) {
+                return nullptr;
+            }
+            return &m_namespaces.emplace_back(NamespaceMetrics{.nvsNamespace = nvsNamespace, .commits = 0, .namespaceErases = 0, .commitLatencyTotal = 0, .commitLatency = {}});
+        }
+    };
+
+} // namespace sdk
+
+#endif // CONFIG_METRICS_HPP
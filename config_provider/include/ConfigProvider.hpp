@@ -5,13 +5,28 @@
 #include <etl/string.h>
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
 #include <any>
+#include <cinttypes>
+#include <cstdio>
 #include <cstring>
-
+#include <expected>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include "ChunkedStorage.hpp"
+#include "ConfigMetrics.hpp"
 #include "esp_app_desc.h"
 #include "esp_err.h"
 #include "esp_system_error.hpp"
+#include "esp_timer.h"
 #include "etl/unordered_map.h"
+#include "etl/vector.h"
 #include "nvs.h"
 #include "nvs_flash.h"
 #include "nvs_handle.hpp"
@@ -40,8 +55,12 @@ namespace sdk {
     using ConfigKey = etl::string<NVS_NS_NAME_MAX_SIZE>;
     using keyHash   = size_t;
 
+    class ConfigTransaction;
+
     class ConfigProvider {
     private:
+        friend class ConfigTransaction;
+
         static inline const char* TAG = "CONFIG";
 
         static inline bool m_initialized = false;
@@ -52,7 +71,60 @@ namespace sdk {
 
         std::unique_ptr<nvs::NVSHandle> m_handle;
 
+        /**
+         * @brief Called once when NVS is initialized, defined after ConfigTransaction
+         */
+        static void recoverTransaction();
+
+        /**
+         * @brief Lets nlohmann::json serialize into NVS, a value is gathered into a string until it reaches
+         *        maxStringSize, from then on it is streamed into chunks
+         */
+        class JsonOutput final : public nlohmann::detail::output_adapter_protocol<char> {
+        public:
+            JsonOutput(nvs::NVSHandle& handle, const ConfigKey& key) : m_handle(handle), m_key(key) {}
+
+            void write_character(const char c) override {
+                write_characters(&c, 1);
+            }
+
+            void write_characters(const char* s, const std::size_t length) override {
+                if (!m_writer && m_string.size() + length < maxStringSize) {
+                    m_string.append(s, length);
+                    return;
+                }
+                if (!m_writer) {
+                    m_writer.emplace(m_handle, m_key.c_str());
+                    m_writer->write({reinterpret_cast<const uint8_t*>(m_string.data()), m_string.size()});
+                    std::string().swap(m_string);
+                }
+                m_writer->write({reinterpret_cast<const uint8_t*>(s), length});
+            }
+
+            /**
+             * @brief Get the writer once the value outgrew a single string, nullptr before that
+             */
+            chunked::Writer* writer() {
+                return m_writer ? &*m_writer : nullptr;
+            }
+
+            [[nodiscard]] const std::string& string() const {
+                return m_string;
+            }
+
+        private:
+            nvs::NVSHandle&                m_handle;
+            const ConfigKey&               m_key;
+            std::string                    m_string;
+            std::optional<chunked::Writer> m_writer;
+        };
+
     public:
+        /**
+         * @brief Largest string NVS can store in a single entry, including the zero terminator
+         */
+        static constexpr size_t maxStringSize = 4000;
+
         explicit ConfigProvider(const ConfigKey& nvsNamespace, const bool readOnly = true) : m_namespace(nvsNamespace), m_readOnly(readOnly){};
 
         /**
@@ -75,6 +147,9 @@ namespace sdk {
                 }
                 ESP_ERROR_CHECK(err);
                 m_initialized = true;
+
+                // Finish or roll back a transaction that was interrupted by a reset
+                recoverTransaction();
             }
             nvs_open_mode_t nvsMode = m_readOnly ? NVS_READONLY : NVS_READWRITE;
 
@@ -127,11 +202,12 @@ namespace sdk {
         }
 
         /**
-         * @brief Load an etl::string from NVS
+         * @brief Load an etl::string from NVS, reading directly into the string's storage
          * @tparam LENGTH Length of the string
          * @param key Key of the nvs entry, max length is NVS_KEY_NAME_MAX_SIZE
          * @param string Place to store the string, will be untouched if not found
-         * @return Error code of type esp_err_t, will be ESP_ERR_NVS_NOT_FOUND if the entry does not exist
+         * @return Error code of type esp_err_t, will be ESP_ERR_NVS_NOT_FOUND if the entry does not exist,
+         *         ESP_ERR_NVS_INVALID_LENGTH if the stored string does not fit
          */
         template<size_t LENGTH>
         std::error_code loadItem(const ConfigKey key, etl::string<LENGTH>& string) {
@@ -141,35 +217,121 @@ namespace sdk {
             if (auto err = getStringSize(key, storedSize)) {
                 return err;
             }
-            assert(LENGTH >= storedSize && "LENGTH too small");
-            char buffer[LENGTH];
-            if (auto err = std::make_error_code(m_handle->get_string(key.c_str(), &buffer[0], storedSize))) {
+            // The stored size includes the zero terminator, for which etl::string always reserves room
+            if (storedSize > LENGTH + 1) {
+                ESP_LOGE(TAG, "String %s does not fit: %zu > %zu", key.c_str(), storedSize - 1, LENGTH);
+                return std::make_error_code(ESP_ERR_NVS_INVALID_LENGTH);
+            }
+            string.uninitialized_resize(storedSize - 1);
+            if (auto err = std::make_error_code(m_handle->get_string(key.c_str(), string.data(), storedSize))) {
                 ESP_LOGE(TAG, "Error loading string: %s, err: %s", key.c_str(), err.message().c_str());
+                string.clear();
+                return err;
+            }
+            return {};
+        }
+
+        /**
+         * @brief Load a blob from NVS directly into the given buffer
+         * @param key Key of the nvs entry, max length is NVS_KEY_NAME_MAX_SIZE
+         * @param buffer Place to store the blob, must be at least as large as the stored blob
+         * @param size Place to store the size of the loaded blob
+         * @return Error code of type esp_err_t, will be ESP_ERR_NVS_NOT_FOUND if the entry does not exist,
+         *         ESP_ERR_NVS_INVALID_LENGTH if the buffer is too small
+         */
+        std::error_code loadBlob(const ConfigKey key, std::span<uint8_t> buffer, size_t& size) {
+            assert(m_handle != nullptr && "Call initialize() first");
+            size_t storedSize = 0;
+
+            if (auto err = std::make_error_code(m_handle->get_item_size(nvs::ItemType::BLOB, key.c_str(), storedSize))) {
+                return err;
+            }
+            if (storedSize > buffer.size()) {
+                ESP_LOGE(TAG, "Blob %s does not fit: %zu > %zu", key.c_str(), storedSize, buffer.size());
+                return std::make_error_code(ESP_ERR_NVS_INVALID_LENGTH);
+            }
+            if (auto err = std::make_error_code(m_handle->get_blob(key.c_str(), buffer.data(), storedSize))) {
+                ESP_LOGE(TAG, "Error loading blob: %s, err: %s", key.c_str(), err.message().c_str());
                 return err;
-            } else {
-                string.assign(buffer);
             }
+            size = storedSize;
             return {};
         }
 
         /**
          * @brief Load a json string from NVS
-         * @tparam BUFFER_SIZE Size of the buffer to store the json object
+         *
+         *        NVS can't read part of a single entry, so small values are read whole into a heap buffer of their exact
+         *        size, which the parser then reads in place. Values stored in chunks are parsed while streaming, one
+         *        chunk at a time, BUFFER_SIZE does not apply to them
+         * @tparam BUFFER_SIZE Largest small value that is accepted, in bytes
          * @param key Key of the nvs entry, max length is NVS_KEY_NAME_MAX_SIZE
          * @param json Place to store the json, will be untouched if not found
-         * @return Error code of type esp_err_t, will be ESP_ERR_NVS_NOT_FOUND if the entry does not exist
+         * @return Error code of type esp_err_t, will be ESP_ERR_NVS_NOT_FOUND if the entry does not exist,
+         *         ESP_ERR_NVS_INVALID_LENGTH if a small value exceeds BUFFER_SIZE, ESP_ERR_INVALID_CRC if a chunked value is corrupted
          */
         template<size_t BUFFER_SIZE>
         std::error_code loadJson(const ConfigKey key, nlohmann::json& json) {
             assert(m_handle != nullptr && "Call initialize() first");
-            etl::string<BUFFER_SIZE> buffer;
-            if (auto err = loadItem(key, buffer)) {
+
+            // Chunked values take precedence, the header is only removed once a smaller replacement is written
+            if (auto err = loadChunkedJson(key, json); err.value() != ESP_ERR_NVS_NOT_FOUND) {
                 return err;
             }
-            json = nlohmann::json::parse(buffer);
+
+            // The parsed json lives on the heap anyway, so the string is kept off the stack of the calling task
+            size_t storedSize = 0;
+            if (auto err = getStringSize(key, storedSize)) {
+                return err;
+            }
+            // The stored size includes the zero terminator
+            if (storedSize > BUFFER_SIZE + 1) {
+                ESP_LOGE(TAG, "Json %s does not fit: %zu > %zu", key.c_str(), storedSize - 1, BUFFER_SIZE);
+                return std::make_error_code(ESP_ERR_NVS_INVALID_LENGTH);
+            }
+            const auto buffer = std::make_unique_for_overwrite<char[]>(storedSize);
+            if (auto err = std::make_error_code(m_handle->get_string(key.c_str(), buffer.get(), storedSize))) {
+                ESP_LOGE(TAG, "Error loading json: %s, err: %s", key.c_str(), err.message().c_str());
+                return err;
+            }
+            json = nlohmann::json::parse(buffer.get(), buffer.get() + storedSize - 1);
             return {};
         }
 
+        /**
+         * @brief Load a json value that was stored in chunks, parsing it while streaming
+         * @param key Key of the nvs entry, max length is NVS_KEY_NAME_MAX_SIZE
+         * @param json Place to store the json, will be untouched on error
+         * @return Error code of type esp_err_t, will be ESP_ERR_NVS_NOT_FOUND if no chunked value exists,
+         *         ESP_ERR_INVALID_CRC if it is corrupted
+         */
+        std::error_code loadChunkedJson(const ConfigKey key, nlohmann::json& json) {
+            assert(m_handle != nullptr && "Call initialize() first");
+            chunked::Reader reader(*m_handle, key.c_str());
+            if (auto err = reader.open()) {
+                return err;
+            }
+            auto parsed = nlohmann::json::parse(reader.begin(), reader.end(), nullptr, false);
+            if (reader.error()) {
+                return reader.error();
+            } else if (parsed.is_discarded()) {
+                ESP_LOGE(TAG, "Error parsing chunked json: %s", key.c_str());
+                return std::make_error_code(ESP_ERR_INVALID_STATE);
+            }
+            json = std::move(parsed);
+            return {};
+        }
+
+        /**
+         * @brief Open a reader to stream a value that was stored in chunks
+         * @param key Key of the nvs entry, max length is NVS_KEY_NAME_MAX_SIZE
+         * @return Reader, call open() on it before reading
+         */
+        chunked::Reader openReader(const ConfigKey key) {
+            assert(m_handle != nullptr && "Call initialize() first");
+            return {*m_handle, key.c_str()};
+        }
+
         /**
          * @brief Save an item to NVS
          * @tparam T Item type
@@ -186,6 +348,7 @@ namespace sdk {
                 ESP_LOGE(TAG, "Error saving item %s: %s", key.c_str(), err.message().c_str());
                 return err;
             }
+            ConfigMetrics::recordWrite(m_namespace.c_str(), key.c_str(), sizeof(T), false);
             if (commit) {
                 return this->commit();
             }
@@ -208,6 +371,28 @@ namespace sdk {
                 ESP_LOGE(TAG, "Error saving string %s: %s", key.c_str(), err.message().c_str());
                 return err;
             }
+            ConfigMetrics::recordWrite(m_namespace.c_str(), key.c_str(), string.size() + 1, true);
+            if (commit) {
+                return this->commit();
+            }
+            return {};
+        }
+
+        /**
+         * @brief Save a blob to NVS
+         * @param key Key of the nvs entry, max length is NVS_KEY_NAME_MAX_SIZE
+         * @param blob Data to save
+         * @param commit Commit changes to NVS after saving, if false, call commit() manually
+         * @return Error code of type esp_err_t
+         */
+        std::error_code saveBlob(const ConfigKey key, std::span<const uint8_t> blob, bool commit = true) {
+            assert(m_handle != nullptr && "Call initialize() first");
+            assert(!m_readOnly && "Unable to save if NVS is opened in READONLY mode");
+            if (auto err = std::make_error_code(m_handle->set_blob(key.c_str(), blob.data(), blob.size()))) {
+                ESP_LOGE(TAG, "Error saving blob %s: %s", key.c_str(), err.message().c_str());
+                return err;
+            }
+            ConfigMetrics::recordWrite(m_namespace.c_str(), key.c_str(), blob.size(), true);
             if (commit) {
                 return this->commit();
             }
@@ -216,6 +401,9 @@ namespace sdk {
 
         /**
          * @brief Save a json object to NVS
+         *
+         *        Objects too large for a single NVS string are split into chunks. The object is serialized straight
+         *        into the string or the chunks, without dumping it first
          * @param key Key of the nvs entry, max length is NVS_KEY_NAME_MAX_SIZE
          * @param json Json object to save
          * @param commit Commit changes to NVS after saving, if false, call commit() manually
@@ -224,16 +412,47 @@ namespace sdk {
         std::error_code saveJson(const ConfigKey key, const nlohmann::json& json, bool commit = true) {
             assert(m_handle != nullptr && "Call initialize() first");
             assert(!m_readOnly && "Unable to save if NVS is opened in READONLY mode");
-            if (auto err = std::make_error_code(m_handle->set_string(key.c_str(), json.dump().c_str()))) {
-                ESP_LOGE(TAG, "Error saving json %s: %s", key.c_str(), err.message().c_str());
-                return err;
+            const auto output = std::make_shared<JsonOutput>(*m_handle, key);
+            nlohmann::detail::serializer<nlohmann::json> serializer(output, ' ', nlohmann::json::error_handler_t::strict);
+            serializer.dump(json, false, false, 0);
+
+            size_t size = 0;
+            if (auto* writer = output->writer()) {
+                // Write errors are sticky, finish() reports the first one
+                if (auto err = writer->finish(false)) {
+                    ESP_LOGE(TAG, "Error saving json %s: %s", key.c_str(), err.message().c_str());
+                    return err;
+                }
+                // A previous, smaller version is now shadowed by the chunks, so it can go
+                m_handle->erase_item(key.c_str());
+                size = writer->size();
+            } else {
+                if (auto err = std::make_error_code(m_handle->set_string(key.c_str(), output->string().c_str()))) {
+                    ESP_LOGE(TAG, "Error saving json %s: %s", key.c_str(), err.message().c_str());
+                    return err;
+                }
+                // Chunks of a previous, larger version would shadow the new string
+                chunked::erase(*m_handle, key.c_str());
+                size = output->string().size();
             }
+            ConfigMetrics::recordWrite(m_namespace.c_str(), key.c_str(), size + 1, true);
             if (commit) {
                 return this->commit();
             }
             return {};
         }
 
+        /**
+         * @brief Open a writer to stream a value into chunks, allowing values larger than a single NVS entry
+         * @param key Key of the nvs entry, max length is NVS_KEY_NAME_MAX_SIZE
+         * @return Writer, the value is only stored once finish() is called on it
+         */
+        chunked::Writer openWriter(const ConfigKey key) {
+            assert(m_handle != nullptr && "Call initialize() first");
+            assert(!m_readOnly && "Unable to save if NVS is opened in READONLY mode");
+            return {*m_handle, key.c_str()};
+        }
+
         /**
          * @brief Erase an item from NVS
          * @param key Key of the nvs entry, max length is NVS_KEY_NAME_MAX_SIZE
@@ -243,10 +462,13 @@ namespace sdk {
         std::error_code eraseItem(const etl::string<NVS_KEY_NAME_MAX_SIZE>& key, bool commit = true) {
             assert(m_handle != nullptr && "Call initialize() first");
             assert(!m_readOnly && "Unable to erase if NVS is opened in READONLY mode");
-            if (auto err = std::make_error_code(m_handle->erase_item(key.c_str()))) {
+            const bool erasedChunks = !chunked::erase(*m_handle, key.c_str());
+            if (auto err = std::make_error_code(m_handle->erase_item(key.c_str()));
+                err && !(erasedChunks && err.value() == ESP_ERR_NVS_NOT_FOUND)) {
                 ESP_LOGE(TAG, "Error erasing item %s: %s", key.c_str(), err.message().c_str());
                 return err;
             }
+            ConfigMetrics::recordErase(m_namespace.c_str(), key.c_str());
             if (commit) {
                 return this->commit();
             }
@@ -264,6 +486,7 @@ namespace sdk {
                 ESP_LOGE(TAG, "Error erasing namespace %s: %s", m_namespace.c_str(), err.message().c_str());
                 return err;
             }
+            ConfigMetrics::recordNamespaceErase(m_namespace.c_str());
             return {};
         }
 
@@ -274,20 +497,450 @@ namespace sdk {
         std::error_code commit() {
             assert(m_handle != nullptr && "Call initialize() first");
             assert(!m_readOnly && "Unable to commit if NVS is opened in READONLY mode");
+            const int64_t start = esp_timer_get_time();
             if (auto err = std::make_error_code(m_handle->commit())) {
                 ESP_LOGE(TAG, "Error committing changes: %s", err.message().c_str());
                 return err;
             }
+            ConfigMetrics::recordCommit(m_namespace.c_str(), esp_timer_get_time() - start);
             return {};
         }
     };
 
+    /**
+     * @brief Saves multiple config values atomically, publishing them with a single commit
+     *
+     *        Values are first staged in the stagingNamespace namespace. commit() then writes a marker
+     *        with the next generation number, after which the staged values are copied to their destination and
+     *        the staging area is cleared. When the device resets before the marker is written the staged values are
+     *        rolled back, when it resets after, copying is finished. Both happen when NVS is first initialized.
+     *        Components that keep a copy of a staged value in memory update it from an onCommit() hook, so memory
+     *        never runs ahead of NVS.
+     *
+     *        All transactions share the staging area, so a transaction holds a lock from the first staged value until it
+     *        is committed or dropped. Another transaction waits for it when staging its first value, don't keep two
+     *        transactions open on the same task.
+     */
+    class ConfigTransaction {
+    public:
+        /**
+         * @brief Namespace values are staged in
+         */
+        static constexpr char stagingNamespace[] = "config_txn";
+
+        ConfigTransaction() : m_provider(stagingNamespace, false) {}
+
+        ConfigTransaction(const ConfigTransaction&)            = delete;
+        ConfigTransaction& operator=(const ConfigTransaction&) = delete;
+
+        /**
+         * @brief Discards staged values if the transaction was not committed, then releases the staging area
+         */
+        ~ConfigTransaction() {
+            if ((m_count > 0 || m_writer) && !m_committed) {
+                discardValue();
+                clearStaged(*m_provider.m_handle);
+                m_provider.m_handle->commit();
+            }
+        }
+
+        /**
+         * @brief Stage a json value, it is only written to its destination on commit()
+         * @param nvsNamespace Namespace the value will be saved in
+         * @param key Key the value will be saved under
+         * @param json Value to save
+         * @return Error code of type esp_err_t, ESP_ERR_INVALID_STATE if already committed
+         */
+        std::error_code stage(const ConfigKey& nvsNamespace, const ConfigKey& key, const nlohmann::json& json) {
+            const auto dumped = json.dump();
+            if (auto err = beginValue(nvsNamespace, key)) {
+                return err;
+            }
+            appendValue({reinterpret_cast<const uint8_t*>(dumped.data()), dumped.size()});
+            // Dumped json needs no validation
+            return finishValue(false);
+        }
+
+        /**
+         * @brief Start staging a serialized json value that arrives in pieces, such as from a snapshot
+         * @param nvsNamespace Namespace the value will be saved in
+         * @param key Key the value will be saved under
+         * @return Error code of type esp_err_t, ESP_ERR_INVALID_STATE if committed or another value is still open
+         */
+        std::error_code beginValue(const ConfigKey& nvsNamespace, const ConfigKey& key) {
+            if (m_committed || m_writer) {
+                return std::make_error_code(ESP_ERR_INVALID_STATE);
+            }
+            if (m_count == 0) {
+                if (auto err = begin()) {
+                    return err;
+                }
+            }
+            if (m_count == maxEntries) {
+                ESP_LOGE(TAG, "Transaction is full, unable to stage %s", key.c_str());
+                return std::make_error_code(ESP_ERR_NO_MEM);
+            }
+
+            m_target = {};
+            std::strncpy(m_target.nvsNamespace, nvsNamespace.c_str(), sizeof(m_target.nvsNamespace) - 1);
+            std::strncpy(m_target.key, key.c_str(), sizeof(m_target.key) - 1);
+            m_writer.emplace(*m_provider.m_handle, entryKey('s', m_count).c_str());
+            return {};
+        }
+
+        /**
+         * @brief Append to the value opened with beginValue()
+         * @param data Next piece of the serialized value
+         * @return Error code of type esp_err_t, errors are sticky until endValue()
+         */
+        std::error_code appendValue(std::span<const uint8_t> data) {
+            if (!m_writer) {
+                return std::make_error_code(ESP_ERR_INVALID_STATE);
+            }
+            return m_writer->write(data);
+        }
+
+        /**
+         * @brief Stage the value opened with beginValue(), after checking it is valid json. On error it is discarded
+         * @return Error code of type esp_err_t, ESP_ERR_INVALID_ARG if the value is not valid json
+         */
+        std::error_code endValue() {
+            if (!m_writer) {
+                return std::make_error_code(ESP_ERR_INVALID_STATE);
+            }
+            return finishValue(true);
+        }
+
+        /**
+         * @brief Run hook once the transaction is committed, such as to update the in memory copy of a staged value
+         *
+         *        Hooks run when the marker is written, even if copying to the destination fails, as the copy is then
+         *        finished on the next boot. They never run for a transaction that is dropped.
+         * @param hook Function to run, in the order hooks were added
+         * @return Error code of type esp_err_t, ESP_ERR_NO_MEM if too many hooks were added
+         */
+        std::error_code onCommit(std::function<void()> hook) {
+            if (m_committed) {
+                return std::make_error_code(ESP_ERR_INVALID_STATE);
+            }
+            if (m_hooks.full()) {
+                ESP_LOGE(TAG, "Too many commit hooks");
+                return std::make_error_code(ESP_ERR_NO_MEM);
+            }
+            m_hooks.push_back(std::move(hook));
+            return {};
+        }
+
+        /**
+         * @brief Publish all staged values with a single commit, then run the commit hooks
+         * @return Error code of type esp_err_t. When the marker was written but copying failed, the copy is
+         *         finished on the next boot
+         */
+        std::error_code commit() {
+            if (m_writer) {
+                ESP_LOGE(TAG, "Unable to commit while %s is still being staged", m_target.key);
+                return std::make_error_code(ESP_ERR_INVALID_STATE);
+            }
+            if (m_committed || m_count == 0) {
+                return {};
+            }
+            const Marker marker{.magic = markerMagic, .generation = m_generation, .count = m_count, .reserved = 0};
+            if (auto err = std::make_error_code(m_provider.m_handle->set_blob(MARKER_KEY, &marker, sizeof(marker)))) {
+                ESP_LOGE(TAG, "Error writing transaction marker: %s", err.message().c_str());
+                return err;
+            }
+            if (auto err = m_provider.commit()) {
+                return err;
+            }
+            m_committed    = true;
+            const auto err = apply(m_provider, marker);
+            // Hooks take the locks of their components, which hold those while staging
+            m_lock.unlock();
+            for (auto& hook: m_hooks) { hook(); }
+            m_hooks.clear();
+            return err;
+        }
+
+        /**
+         * @brief Get the generation of this transaction, the generation of the last completed one plus one
+         */
+        [[nodiscard]] uint32_t generation() const {
+            return m_generation;
+        }
+
+        /**
+         * @brief Finish or roll back a transaction that was interrupted by a reset
+         * @return Error code of type esp_err_t
+         */
+        static std::error_code recover() {
+            // Most boots have nothing to recover, look before opening for writing so they don't touch the flash
+            if (!interrupted()) {
+                return {};
+            }
+
+            std::lock_guard lock(m_mutex);
+            ConfigProvider  provider(stagingNamespace, false);
+            if (auto err = provider.initialize()) {
+                return err;
+            }
+
+            Marker marker{};
+            if (provider.m_handle->get_blob(MARKER_KEY, &marker, sizeof(marker)) == ESP_OK && marker.magic == markerMagic) {
+                ESP_LOGW(TAG, "Finishing interrupted transaction, generation %" PRIu32, marker.generation);
+                return apply(provider, marker);
+            }
+
+            // Without a marker anything staged is from a transaction that never committed
+            if (clearStaged(*provider.m_handle)) {
+                ESP_LOGW(TAG, "Rolled back uncommitted transaction");
+            }
+            return provider.commit();
+        }
+
+    private:
+        /**
+         * @brief Written once all values are staged, its presence means the transaction has to be completed
+         */
+        struct Marker {
+            uint32_t magic;
+            uint32_t generation;
+            uint16_t count;
+            uint16_t reserved;
+        };
+
+        /**
+         * @brief Destination of a staged value
+         */
+        struct Target {
+            char nvsNamespace[NVS_NS_NAME_MAX_SIZE];
+            char key[NVS_KEY_NAME_MAX_SIZE];
+        };
+
+        static constexpr char     TAG[]            = "CONFIG TRANSACTION";
+        static constexpr char     MARKER_KEY[]     = "marker";
+        static constexpr char     GENERATION_KEY[] = "generation";
+        static constexpr uint32_t markerMagic      = 0x4e584e54; // "TNXN"
+        // Entry keys have room for two decimal digits
+        static constexpr uint16_t maxEntries = 100;
+        // One per component that takes part in a transaction
+        static constexpr size_t maxCommitHooks = 8;
+
+        ConfigProvider                 m_provider;
+        uint32_t                       m_generation{0};
+        uint16_t                       m_count{0};
+        bool                           m_committed{false};
+        Target                         m_target{};
+        std::optional<chunked::Writer> m_writer{};
+
+        etl::vector<std::function<void()>, maxCommitHooks> m_hooks{};
+
+        // Guards the staging area, held by a transaction from begin() until it is committed or dropped
+        static inline std::mutex     m_mutex;
+        std::unique_lock<std::mutex> m_lock{m_mutex, std::defer_lock};
+
+        static ConfigKey entryKey(char type, uint16_t index) {
+            char buffer[NVS_KEY_NAME_MAX_SIZE];
+            snprintf(buffer, sizeof(buffer), "%c%u", type, index);
+            return buffer;
+        }
+
+        std::error_code begin() {
+            // Initializing NVS the first time recovers, which takes the lock as well
+            if (auto err = m_provider.initialize()) {
+                return err;
+            }
+            // Still held when staging the first value failed
+            if (!m_lock.owns_lock()) {
+                m_lock.lock();
+            }
+            uint32_t lastGeneration = 0;
+            m_provider.m_handle->get_item(GENERATION_KEY, lastGeneration);
+            m_generation = lastGeneration + 1;
+            // Leftovers of a transaction that was dropped before committing in this boot
+            clearStaged(*m_provider.m_handle);
+            return {};
+        }
+
+        /**
+         * @brief Check whether the staging namespace holds a marker or staged values, without opening it for writing
+         */
+        static bool interrupted() {
+            esp_err_t  err    = ESP_OK;
+            const auto handle = nvs::open_nvs_handle(stagingNamespace, NVS_READONLY, &err);
+            if (err != ESP_OK) {
+                // The namespace is only created by the first transaction
+                return err != ESP_ERR_NVS_NOT_FOUND;
+            }
+            size_t size = 0;
+            if (handle->get_item_size(nvs::ItemType::BLOB, MARKER_KEY, size) == ESP_OK ||
+                handle->get_item_size(nvs::ItemType::BLOB, entryKey('t', 0).c_str(), size) == ESP_OK) {
+                return true;
+            }
+            // A value staged without its target, the transaction was dropped halfway
+            const auto header = chunked::readAnyHeader(*handle, entryKey('s', 0).c_str());
+            return header || header.error().value() != ESP_ERR_NVS_NOT_FOUND;
+        }
+
+        /**
+         * @brief Finish writing the open value and record its target
+         * @param validate Read the value back and parse it, so a malformed value can't block apply()
+         * @return Error code of type esp_err_t
+         */
+        std::error_code finishValue(bool validate) {
+            // Staged values are committed together with the marker
+            if (auto err = m_writer->finish(false)) {
+                ESP_LOGE(TAG, "Error staging %s: %s", m_target.key, err.message().c_str());
+                discardValue();
+                return err;
+            }
+            m_writer.reset();
+
+            const auto key = entryKey('s', m_count);
+            if (validate) {
+                chunked::Reader reader(*m_provider.m_handle, key.c_str());
+                auto            err = reader.open();
+                if (!err && !nlohmann::json::accept(reader.begin(), reader.end())) {
+                    err = reader.error() ? reader.error() : std::make_error_code(ESP_ERR_INVALID_ARG);
+                }
+                if (err) {
+                    ESP_LOGE(TAG, "Error validating %s: %s", m_target.key, err.message().c_str());
+                    chunked::erase(*m_provider.m_handle, key.c_str());
+                    return err;
+                }
+            }
+
+            if (auto err = std::make_error_code(m_provider.m_handle->set_blob(entryKey('t', m_count).c_str(), &m_target, sizeof(m_target)))) {
+                ESP_LOGE(TAG, "Error staging %s: %s", m_target.key, err.message().c_str());
+                chunked::erase(*m_provider.m_handle, key.c_str());
+                return err;
+            }
+            m_count++;
+            return {};
+        }
+
+        /**
+         * @brief Drop the value that is being staged, including the chunks written so far
+         */
+        void discardValue() {
+            if (!m_writer) {
+                return;
+            }
+            m_writer.reset();
+            const auto key = entryKey('s', m_count);
+            chunked::eraseSlot(*m_provider.m_handle, key.c_str(), 0);
+            chunked::eraseSlot(*m_provider.m_handle, key.c_str(), 1);
+        }
+
+        /**
+         * @brief Erase all staged values
+         * @return True if anything was erased
+         */
+        static bool clearStaged(nvs::NVSHandle& handle) {
+            bool erased = false;
+            for (uint16_t index = 0; index < maxEntries; index++) {
+                const bool stagedValue  = !chunked::erase(handle, entryKey('s', index).c_str());
+                const bool stagedTarget = handle.erase_item(entryKey('t', index).c_str()) == ESP_OK;
+                if (!stagedValue && !stagedTarget) {
+                    break;
+                }
+                erased = true;
+            }
+            return erased;
+        }
+
+        /**
+         * @brief Copy the staged values to their destination and clear the staging area, safe to repeat
+         *
+         *        Values that can't be read back are skipped, errors writing the destination are returned and retried
+         *        on the next boot.
+         * @param provider Provider of the transaction namespace
+         * @param marker Marker of the committed transaction
+         * @return Error code of type esp_err_t
+         */
+        static std::error_code apply(ConfigProvider& provider, const Marker& marker) {
+            // Values for the same namespace share a handle and a single commit
+            std::optional<ConfigProvider> destination;
+            for (uint16_t index = 0; index < marker.count; index++) {
+                Target         target{};
+                nlohmann::json json;
+                // An entry that can't be read never will be, skip it so the rest is still published. Otherwise
+                // every boot would fail on it and keep the marker around.
+                if (auto err = std::make_error_code(provider.m_handle->get_blob(entryKey('t', index).c_str(), &target, sizeof(target)))) {
+                    ESP_LOGE(TAG, "Skipping transaction target %u: %s", index, err.message().c_str());
+                    continue;
+                }
+                target.nvsNamespace[sizeof(target.nvsNamespace) - 1] = '\0';
+                target.key[sizeof(target.key) - 1]                   = '\0';
+                if (auto err = provider.loadChunkedJson(entryKey('s', index), json)) {
+                    ESP_LOGE(TAG, "Skipping staged value for %s: %s", target.key, err.message().c_str());
+                    continue;
+                }
+
+                if (!destination || destination->m_namespace != target.nvsNamespace) {
+                    if (destination) {
+                        if (auto err = destination->commit()) {
+                            return err;
+                        }
+                    }
+                    destination.emplace(target.nvsNamespace, false);
+                    if (auto err = destination->initialize()) {
+                        return err;
+                    }
+                }
+                if (auto err = destination->saveJson(target.key, json, false)) {
+                    return err;
+                }
+            }
+            if (destination) {
+                if (auto err = destination->commit()) {
+                    return err;
+                }
+            }
+
+            // Until the marker is gone, the next boot repeats the copy
+            if (auto err = std::make_error_code(provider.m_handle->set_item(GENERATION_KEY, marker.generation))) {
+                ESP_LOGE(TAG, "Error writing transaction generation: %s", err.message().c_str());
+                return err;
+            }
+            if (auto err = std::make_error_code(provider.m_handle->erase_item(MARKER_KEY))) {
+                ESP_LOGE(TAG, "Error erasing transaction marker: %s", err.message().c_str());
+                return err;
+            }
+            clearStaged(*provider.m_handle);
+            return provider.commit();
+        }
+    };
+
+    inline void ConfigProvider::recoverTransaction() {
+        if (auto err = ConfigTransaction::recover()) {
+            ESP_LOGE(TAG, "Error recovering config transaction: %s", err.message().c_str());
+        }
+    }
+
     enum class RestartType {
         NONE,
         COMPONENT,
         DEVICE
     };
 
+    /**
+     * @brief Who may see and change a field of a ConfigObject that is bound in the ConfigRegistry
+     */
+    enum class FieldVisibility {
+        /**
+         * @brief Read and patched by clients
+         */
+        PUBLIC,
+        /**
+         * @brief Patched by clients but never read back, such as passwords
+         */
+        SECRET,
+        /**
+         * @brief State the component keeps for itself, clients can neither read nor patch it
+         */
+        INTERNAL
+    };
+
     template<typename T>
     class ConfigField {
     private:
@@ -364,22 +1017,272 @@ namespace sdk {
         }
     };
 
+    template<typename T>
+    struct IsEtlString : std::false_type {};
+
+    template<size_t N>
+    struct IsEtlString<etl::string<N>> : std::true_type {};
+
+    /**
+     * @brief Check whether a json value can be stored in a ConfigField of type T without narrowing or truncation
+     * @tparam T Type of the ConfigField
+     * @param value Json value to check
+     * @return True if value.get<T>() is safe to call
+     */
+    template<typename T>
+    bool jsonHoldsType(const nlohmann::json& value) {
+        if constexpr (std::is_same_v<T, bool>) {
+            return value.is_boolean();
+        } else if constexpr (std::is_enum_v<T>) {
+            return jsonHoldsType<std::underlying_type_t<T>>(value);
+        } else if constexpr (std::is_unsigned_v<T>) {
+            // Json built in code holds positive numbers as signed, only parsed json tells them apart
+            if (value.is_number_unsigned()) {
+                return value.template get<uint64_t>() <= std::numeric_limits<T>::max();
+            }
+            return value.is_number_integer() && value.template get<int64_t>() >= 0 &&
+                   static_cast<uint64_t>(value.template get<int64_t>()) <= std::numeric_limits<T>::max();
+        } else if constexpr (std::is_integral_v<T>) {
+            if (value.is_number_unsigned()) {
+                return value.template get<uint64_t>() <= static_cast<uint64_t>(std::numeric_limits<T>::max());
+            }
+            return value.is_number_integer() && value.template get<int64_t>() >= std::numeric_limits<T>::min() &&
+                   value.template get<int64_t>() <= std::numeric_limits<T>::max();
+        } else if constexpr (std::is_floating_point_v<T>) {
+            return value.is_number();
+        } else if constexpr (IsEtlString<T>::value) {
+            return value.is_string() && value.template get_ref<const std::string&>().size() <= T::MAX_SIZE;
+        } else {
+            return !value.is_null();
+        }
+    }
+
+    /**
+     * @brief Upgrades a stored config object written by an older firmware version
+     */
+    struct ConfigMigration {
+        /**
+         * @brief First stored version the migration applies to
+         */
+        semver::version from;
+        /**
+         * @brief Version the stored object is in after the migration, it applies to versions before this one
+         */
+        semver::version to;
+        /**
+         * @brief Rewrites the stored json into the format of version `to`
+         */
+        void (*apply)(nlohmann::json& json);
+    };
+
+    /**
+     * @brief Keys of all ConfigObject types in the firmware, so they can be handled together
+     *
+     *        Every ConfigObject type registers itself during static initialization, whether or not an instance exists.
+     *        Components can also bind the instance they own, to let clients read and patch it by key, and to have it
+     *        reloaded when a snapshot import replaces it. Binding is opt in, the component provides hooks that take
+     *        its own lock and go through its own update path. Hooks it leaves out are not offered.
+     */
+    class ConfigRegistry {
+    public:
+        using Keys = etl::vector<const char*, CONFIG_MAX_CONFIG_OBJECTS>;
+
+        /**
+         * @brief Result of patching an instance, see ConfigObject::applyPatch()
+         */
+        struct PatchSummary {
+            /**
+             * @brief Number of fields whose value changed
+             */
+            size_t changed{0};
+            /**
+             * @brief Strongest restart type of all changed fields
+             */
+            RestartType restartType{RestartType::NONE};
+        };
+
+        /**
+         * @brief Type erased access to the live instance of a ConfigObject type, through the component that owns it
+         */
+        struct Instance {
+            const char* key   = nullptr;
+            void*       owner = nullptr;
+            /**
+             * @brief Returns a copy of the fields clients may read, see ConfigObject::exposedJson()
+             */
+            nlohmann::json (*read)(void* owner) = nullptr;
+            /**
+             * @brief Applies a merge patch from a client and saves the object if anything changed, ESP_ERR_INVALID_ARG
+             *        on a malformed patch or one that touches fields clients may not change
+             */
+            std::expected<PatchSummary, std::error_code> (*patch)(void* owner, const nlohmann::json& patch) = nullptr;
+            /**
+             * @brief Loads the stored object again after it was replaced in NVS, such as by a snapshot import, see
+             *        ConfigObject::reload()
+             */
+            std::expected<PatchSummary, std::error_code> (*reload)(void* owner) = nullptr;
+        };
+
+        /**
+         * @brief Register the key of a ConfigObject type
+         * @param key Key the object is stored under, must outlive the registry
+         * @return True, so it can initialize a static member
+         */
+        static bool add(const char* key) {
+            auto& registered = registry();
+            if (std::find_if(registered.begin(), registered.end(), [key](const char* other) { return std::strcmp(key, other) == 0; }) != registered.end()) {
+                return true;
+            }
+            assert(!registered.full() && "Increase CONFIG_MAX_CONFIG_OBJECTS");
+            registered.push_back(key);
+            return true;
+        }
+
+        /**
+         * @brief Get the keys of all registered ConfigObject types
+         */
+        static const Keys& keys() {
+            return registry();
+        }
+
+        /**
+         * @brief Make an instance reachable by its key, replacing the instance bound before it
+         * @param instance Instance to bind, its owner must unbind it before it is destroyed
+         */
+        static void bind(const Instance& instance) {
+            std::lock_guard lock(m_mutex);
+            auto&           bound = instances();
+            if (auto existing = findInstance(instance.key); existing != bound.end()) {
+                *existing = instance;
+                return;
+            }
+            assert(!bound.full() && "Increase CONFIG_MAX_CONFIG_OBJECTS");
+            bound.push_back(instance);
+        }
+
+        /**
+         * @brief Remove the instance bound under key, if owner bound it. Waits for hooks of the instance that are running
+         * @param key Key the instance was bound under
+         * @param owner Owner of the instance, so an owner that was replaced can't remove its successor
+         */
+        static void unbind(const char* key, const void* owner) {
+            std::lock_guard lock(m_mutex);
+            auto&           bound = instances();
+            if (auto existing = findInstance(key); existing != bound.end() && existing->owner == owner) {
+                bound.erase(existing);
+            }
+        }
+
+        /**
+         * @brief Read the instance bound under key
+         * @param key Key of the ConfigObject type
+         * @return The fields clients may read, ESP_ERR_NOT_FOUND if no instance is bound under key
+         */
+        static std::expected<nlohmann::json, std::error_code> read(std::string_view key) {
+            std::lock_guard lock(m_mutex);
+            if (auto existing = findInstance(key); existing != instances().end() && existing->read != nullptr) {
+                return existing->read(existing->owner);
+            }
+            return std::unexpected(std::make_error_code(ESP_ERR_NOT_FOUND));
+        }
+
+        /**
+         * @brief Patch the instance bound under key
+         * @param key Key of the ConfigObject type
+         * @param patch Json merge patch from a client
+         * @return See Instance::patch, ESP_ERR_NOT_FOUND if no instance is bound under key
+         */
+        static std::expected<PatchSummary, std::error_code> patch(std::string_view key, const nlohmann::json& patch) {
+            std::lock_guard lock(m_mutex);
+            if (auto existing = findInstance(key); existing != instances().end() && existing->patch != nullptr) {
+                return existing->patch(existing->owner, patch);
+            }
+            return std::unexpected(std::make_error_code(ESP_ERR_NOT_FOUND));
+        }
+
+        /**
+         * @brief Let the owner of the instance bound under key load it again from NVS
+         * @param key Key of the ConfigObject type
+         * @return See Instance::reload, ESP_ERR_NOT_FOUND if no instance that can reload is bound under key
+         */
+        static std::expected<PatchSummary, std::error_code> reload(std::string_view key) {
+            std::lock_guard lock(m_mutex);
+            if (auto existing = findInstance(key); existing != instances().end() && existing->reload != nullptr) {
+                return existing->reload(existing->owner);
+            }
+            return std::unexpected(std::make_error_code(ESP_ERR_NOT_FOUND));
+        }
+
+    private:
+        using Instances = etl::vector<Instance, CONFIG_MAX_CONFIG_OBJECTS>;
+
+        // Held while a hook runs, so unbind() can't return while the owner is still in use
+        static inline std::mutex m_mutex;
+
+        // Function local, so registering from static initializers does not depend on initialization order
+        static Keys& registry() {
+            static Keys keys;
+            return keys;
+        }
+
+        static Instances& instances() {
+            static Instances instances;
+            return instances;
+        }
+
+        // Call with m_mutex held
+        static Instances::iterator findInstance(std::string_view key) {
+            auto& bound = instances();
+            return std::find_if(bound.begin(), bound.end(), [key](const Instance& instance) { return key == instance.key; });
+        }
+    };
+
     template<size_t NUM_ITEMS, size_t BUFFER_SIZE, StringLiteral KEY>
     class ConfigObject {
+    public:
+        /**
+         * @brief Result of applying a merge patch
+         */
+        struct PatchResult {
+            /**
+             * @brief Keys of the fields whose value changed
+             */
+            etl::vector<ConfigKey, NUM_ITEMS> changedKeys;
+            /**
+             * @brief Strongest restart type of all changed fields
+             */
+            RestartType restartType{RestartType::NONE};
+        };
+
     private:
+        // Assigns a json value to a type erased ConfigField, returns false if the type does not match
+        // When apply is false only the type check is done
+        using FieldSetter = bool (*)(void* field, const nlohmann::json& value, bool apply);
+
         semver::version m_version;
 
         bool m_isDefault{true};
 
+        // Whether the object was found in NVS
+        bool m_isStored{false};
+
         // Map to store the restart required status of each field
         etl::unordered_map<keyHash, RestartType, NUM_ITEMS> m_restartRequiredMap{};
 
         // Map to store pointers to ConfigObject fields, accessed using hash
         etl::unordered_map<keyHash, void*, NUM_ITEMS> m_fieldPointers{};
 
+        // Map to store typed setters for the ConfigObject fields, used to apply merge patches
+        etl::unordered_map<keyHash, FieldSetter, NUM_ITEMS> m_fieldSetters{};
+
+        // Fields that are not PUBLIC, see FieldVisibility
+        etl::unordered_map<keyHash, FieldVisibility, NUM_ITEMS> m_hiddenFields{};
+
         // Use JSON with static buffer
         nlohmann::json m_json;
 
+        static inline const bool m_registered = ConfigRegistry::add(KEY.c_str());
+
         /**
          * @brief Retrieves itself from NVS
          * @return Error code of type esp_err_t
@@ -398,7 +1301,9 @@ namespace sdk {
             // If the version field is not found, set it to the current version
             if (auto err = provider.loadJson<BUFFER_SIZE>(KEY.c_str(), m_json)) {
                 return err;
-            } else if (m_json.contains(CONFIG_VERSION_KEY)) {
+            }
+            m_isStored = true;
+            if (m_json.contains(CONFIG_VERSION_KEY)) {
                 m_version = semver::from_string(m_json.at(CONFIG_VERSION_KEY).get<std::string>());
             } else {
                 auto app_desc = esp_app_get_description();
@@ -417,17 +1322,120 @@ namespace sdk {
          * @param key Key to hash
          * @return Hash of the key
          */
-        keyHash hash(ConfigKey key) {
+        static keyHash hash(ConfigKey key) {
             etl::hash<etl::string<NVS_KEY_NAME_MAX_SIZE>> hasher;
             return hasher(key);
         }
 
+        /**
+         * @brief Writes the json object to NVS in the namespace "config"
+         * @return Error code of type esp_err_t
+         */
+        std::error_code write() {
+            ConfigProvider provider(CONFIG_NAMESPACE, false);
+
+            if (auto err = provider.initialize()) {
+                return err;
+            }
+            if (auto err = provider.saveJson(KEY.c_str(), m_json, true)) {
+                ESP_LOGE(KEY.c_str(), "Error saving config: %s", err.message().c_str());
+                return err;
+            }
+
+            return {};
+        }
+
+        /**
+         * @brief Checks a merge patch against the allocated fields without applying it
+         * @param patch Json object containing the changes
+         * @return Error code of type esp_err_t, ESP_ERR_INVALID_ARG on a malformed patch
+         */
+        std::error_code validatePatch(const nlohmann::json& patch) const {
+            if (!patch.is_object()) {
+                ESP_LOGE(KEY.c_str(), "Merge patch must be a json object");
+                return std::make_error_code(ESP_ERR_INVALID_ARG);
+            }
+
+            for (const auto& item: patch.items()) {
+                if (item.key() == CONFIG_VERSION_KEY) {
+                    continue;
+                }
+                const keyHash fieldHash = hash(item.key().c_str());
+                auto          setter    = m_fieldSetters.find(fieldHash);
+                if (setter == m_fieldSetters.end()) {
+                    ESP_LOGE(KEY.c_str(), "Merge patch contains unknown field %s", item.key().c_str());
+                    return std::make_error_code(ESP_ERR_INVALID_ARG);
+                }
+                if (item.value().is_null()) {
+                    ESP_LOGE(KEY.c_str(), "Unable to delete field %s", item.key().c_str());
+                    return std::make_error_code(ESP_ERR_INVALID_ARG);
+                }
+                if (!setter->second(m_fieldPointers.at(fieldHash), item.value(), false)) {
+                    ESP_LOGE(KEY.c_str(), "Merge patch has wrong type for field %s", item.key().c_str());
+                    return std::make_error_code(ESP_ERR_INVALID_ARG);
+                }
+            }
+            return {};
+        }
+
+        /**
+         * @brief Value of a field after merging a patch value into it
+         *
+         *        Nested objects are merged recursively, anything else replaces the stored value
+         */
+        nlohmann::json mergedValue(const std::string& key, const nlohmann::json& patchValue) const {
+            if (!patchValue.is_object()) {
+                return patchValue;
+            }
+            nlohmann::json value = m_json.value(key, nlohmann::json::object());
+            value.merge_patch(patchValue);
+            return value;
+        }
+
+    protected:
+        /**
+         * @brief Runs the migrations that apply to the stored version, call this before allocating fields
+         *
+         *        Migrations run in order, each moving the version forward so the next one can pick up from there.
+         *        The migrated object is written back with the current version, so this only does work on the first
+         *        boot after a firmware upgrade. Later boots only compare the version.
+         * @param migrations Migrations sorted by version
+         * @param current Version to migrate to, defaults to the firmware version
+         * @return Error code of type esp_err_t
+         */
+        std::error_code migrate(std::span<const ConfigMigration> migrations, const semver::version& current = firmwareVersion()) {
+            if (!m_isStored || m_version >= current) {
+                return {};
+            }
+
+            const auto stored = m_version;
+            for (const auto& migration: migrations) {
+                if (migration.from <= m_version && m_version < migration.to && migration.to <= current) {
+                    migration.apply(m_json);
+                    m_version = migration.to;
+                }
+            }
+
+            m_version                  = current;
+            m_json[CONFIG_VERSION_KEY] = semver::to_etl_string(current);
+            ESP_LOGI(KEY.c_str(), "Migrated config from %s to %s", semver::to_etl_string(stored).c_str(), semver::to_etl_string(current).c_str());
+            return write();
+        }
+
+        /**
+         * @brief Get the version of the running firmware
+         */
+        static semver::version firmwareVersion() {
+            return semver::from_string(esp_app_get_description()->version);
+        }
+
     public:
         /**
          * @brief Constructor to be used for incoming config changes
          * @param data Json object containing changes. Should only contain the fields that need to be updated
          */
         explicit ConfigObject(const nlohmann::json& data) {
+            static_cast<void>(m_registered);
             for (const auto& object: data.items()) { m_json[object.key()] = object.value(); }
         };
 
@@ -444,9 +1452,17 @@ namespace sdk {
          * @brief Constructor that attempts to retrieve itself from NVS and load the fields
          */
         ConfigObject() {
+            static_cast<void>(m_registered);
             load();
         }
 
+        /**
+         * @brief Key the object is stored under, also the key to bind it under in the ConfigRegistry
+         */
+        static const char* key() {
+            return KEY.c_str();
+        }
+
         /**
          * @brief Updates a ConfigObject field by replacing it
          * @tparam T ConfigField type
@@ -468,26 +1484,191 @@ namespace sdk {
             m_json.at(field.key().c_str()) = newValue;
         }
 
+        /**
+         * @brief Applies a JSON merge patch (RFC 7386) to the allocated fields, without rebuilding the object
+         *
+         *        Fields that are absent from the patch are left untouched. The patch is validated before anything
+         *        is applied, so on error the object is unchanged. Deleting a field with null is not supported, as
+         *        every field has to keep a value, nor are keys that were not allocated.
+         * @param patch Json object containing the changes
+         * @return The changed keys and the strongest restart type they require, ESP_ERR_INVALID_ARG on a malformed patch
+         */
+        std::expected<PatchResult, std::error_code> applyPatch(const nlohmann::json& patch) {
+            if (auto err = validatePatch(patch)) {
+                return std::unexpected(err);
+            }
+
+            PatchResult result;
+            for (const auto& item: patch.items()) {
+                if (item.key() == CONFIG_VERSION_KEY) {
+                    continue;
+                }
+                const auto& key   = item.key();
+                auto        value = mergedValue(key, item.value());
+                if (m_json.contains(key) && m_json.at(key) == value) {
+                    continue;
+                }
+
+                const keyHash fieldHash = hash(key.c_str());
+                [[maybe_unused]] const bool applied = m_fieldSetters.at(fieldHash)(m_fieldPointers.at(fieldHash), value, true);
+                assert(applied && "Merge patch was validated, so applying it can't fail");
+                m_json[key] = std::move(value);
+                m_isDefault = false;
+
+                result.changedKeys.emplace_back(key.c_str());
+                if (const auto restartType = m_restartRequiredMap.at(fieldHash); restartType > result.restartType) {
+                    result.restartType = restartType;
+                }
+            }
+            return result;
+        }
+
+        /**
+         * @brief Stages the object with a merge patch applied, leaving the object itself untouched
+         *
+         *        Apply the same patch with applyPatch() from a ConfigTransaction::onCommit() hook, so the fields only
+         *        change once the transaction is committed. Nothing is staged when no field changes.
+         * @param patch Json object containing the changes
+         * @param transaction Transaction to stage in
+         * @return The keys that will change and the strongest restart type they require, ESP_ERR_INVALID_ARG on a
+         *         malformed patch
+         */
+        std::expected<PatchResult, std::error_code> stagePatch(const nlohmann::json& patch, ConfigTransaction& transaction) const {
+            if (auto err = validatePatch(patch)) {
+                return std::unexpected(err);
+            }
+
+            PatchResult    result;
+            nlohmann::json patched = m_json;
+            for (const auto& item: patch.items()) {
+                if (item.key() == CONFIG_VERSION_KEY) {
+                    continue;
+                }
+                const auto& key   = item.key();
+                auto        value = mergedValue(key, item.value());
+                if (patched.contains(key) && patched.at(key) == value) {
+                    continue;
+                }
+                patched[key] = std::move(value);
+
+                result.changedKeys.emplace_back(key.c_str());
+                if (const auto restartType = m_restartRequiredMap.at(hash(key.c_str())); restartType > result.restartType) {
+                    result.restartType = restartType;
+                }
+            }
+            if (result.changedKeys.empty()) {
+                return result;
+            }
+
+            patched[CONFIG_VERSION_KEY] = std::string(esp_app_get_description()->version);
+            if (auto err = transaction.stage(CONFIG_NAMESPACE, KEY.c_str(), patched)) {
+                ESP_LOGE(KEY.c_str(), "Error staging config: %s", err.message().c_str());
+                return std::unexpected(err);
+            }
+            return result;
+        }
+
+        /**
+         * @brief Loads the stored object again and applies it like a merge patch, such as after a snapshot import
+         *
+         *        Saving the object afterwards keeps what was stored, instead of writing the old values back over it.
+         *        Stored keys that are not allocated are ignored, fields that are not stored keep their value.
+         * @return The changed keys and the strongest restart type they require, ESP_ERR_INVALID_ARG if a stored value
+         *         does not fit its field, in which case the object is unchanged
+         */
+        std::expected<PatchResult, std::error_code> reload() {
+            ConfigProvider provider(CONFIG_NAMESPACE, true);
+            if (auto err = provider.initialize()) {
+                return std::unexpected(err);
+            }
+            nlohmann::json stored;
+            if (auto err = provider.loadJson<BUFFER_SIZE>(KEY.c_str(), stored)) {
+                return std::unexpected(err);
+            }
+            if (!stored.is_object()) {
+                ESP_LOGE(KEY.c_str(), "Stored config is not an object");
+                return std::unexpected(std::make_error_code(ESP_ERR_INVALID_ARG));
+            }
+
+            nlohmann::json patch = nlohmann::json::object();
+            for (const auto& item: stored.items()) {
+                if (m_fieldPointers.find(hash(item.key().c_str())) != m_fieldPointers.end()) {
+                    patch[item.key()] = item.value();
+                }
+            }
+            auto result = applyPatch(patch);
+            if (result) {
+                m_isStored = true;
+            }
+            return result;
+        }
+
+        /**
+         * @brief Copy of the fields clients may read, leaving out SECRET and INTERNAL fields
+         */
+        nlohmann::json exposedJson() const {
+            nlohmann::json exposed = nlohmann::json::object();
+            for (const auto& item: m_json.items()) {
+                if (m_hiddenFields.find(hash(item.key().c_str())) == m_hiddenFields.end()) {
+                    exposed[item.key()] = item.value();
+                }
+            }
+            return exposed;
+        }
+
+        /**
+         * @brief Checks a merge patch from a client, which may not touch INTERNAL fields
+         * @param patch Json object containing the changes
+         * @return Error code of type esp_err_t, ESP_ERR_INVALID_ARG on a malformed patch or one with INTERNAL fields
+         */
+        std::error_code validateClientPatch(const nlohmann::json& patch) const {
+            if (auto err = validatePatch(patch)) {
+                return err;
+            }
+            for (const auto& item: patch.items()) {
+                if (const auto hidden = m_hiddenFields.find(hash(item.key().c_str())); hidden != m_hiddenFields.end() && hidden->second == FieldVisibility::INTERNAL) {
+                    ESP_LOGE(KEY.c_str(), "Field %s can't be changed by clients", item.key().c_str());
+                    return std::make_error_code(ESP_ERR_INVALID_ARG);
+                }
+            }
+            return {};
+        }
+
         /**
          * @brief Allocates a field in the json object
          * @tparam T Type of the field
          * @param field Field to allocate, if it already exists in NVS, the default value of field will be overwritten
+         * @param visibility Whether clients may read and patch the field once the object is bound in the ConfigRegistry
          * @return ConfigField to be assigned to the passed field
          */
         template<typename T>
-        ConfigField<T> allocate(ConfigField<T>& field) {
+        ConfigField<T> allocate(ConfigField<T>& field, FieldVisibility visibility = FieldVisibility::PUBLIC) {
             keyHash fieldNameHash               = hash(field.key());
             m_restartRequiredMap[fieldNameHash] = field.restartType();
+            if (visibility != FieldVisibility::PUBLIC) {
+                m_hiddenFields[fieldNameHash] = visibility;
+            }
             m_fieldPointers[fieldNameHash]      = static_cast<void*>(&field);
+            m_fieldSetters[fieldNameHash]       = [](void* pointer, const nlohmann::json& value, bool apply) {
+                if (!jsonHoldsType<T>(value)) {
+                    return false;
+                } else if (!apply) {
+                    return true;
+                }
+                auto* target = static_cast<ConfigField<T>*>(pointer);
+                *target      = ConfigField<T>{value.get<T>(), target->key(), target->restartType()};
+                return true;
+            };
 
-            if (!m_json.contains(field.key().c_str())) {
+            const auto stored = m_json.find(field.key().c_str());
+            if (stored == m_json.end()) {
                 assert(m_json.size() + sizeof(field) < BUFFER_SIZE);
                 m_json.emplace(field.key().c_str(), field.value());
 
                 // ConfigField is immutable, so return a new object
                 return ConfigField<T>{field.value(), field.key(), field.restartType()};
             } else {
-                T    retrieved_value = m_json.value(static_cast<const char*>(field.key().c_str()), field.value());
+                T    retrieved_value = stored->template get<T>();
                 auto newField        = ConfigField<T>{retrieved_value, field.key(), field.restartType()};
 
                 if (field.value() != newField.value()) {
@@ -503,22 +1684,30 @@ namespace sdk {
          * @return Error code of type esp_err_t
          */
         std::error_code save() {
-            ConfigProvider provider(CONFIG_NAMESPACE, false);
-
             // Update the version field to the current version
             auto app_desc = esp_app_get_description();
 
             m_json[CONFIG_VERSION_KEY] = std::string(app_desc->version);
-            m_version                     = semver::from_string(app_desc->version);
+            m_version                  = semver::from_string(app_desc->version);
 
-            if (auto err = provider.initialize()) {
-                return err;
-            }
-            if (auto err = provider.saveJson(KEY.c_str(), m_json, true)) {
-                ESP_LOGE(KEY.c_str(), "Error saving config: %s", err.message().c_str());
+            return write();
+        }
+
+        /**
+         * @brief Stages itself in a transaction, it is saved to the namespace "config" when the transaction commits
+         * @param transaction Transaction to stage in
+         * @return Error code of type esp_err_t
+         */
+        std::error_code save(ConfigTransaction& transaction) {
+            auto app_desc = esp_app_get_description();
+
+            m_json[CONFIG_VERSION_KEY] = std::string(app_desc->version);
+            m_version                  = semver::from_string(app_desc->version);
+
+            if (auto err = transaction.stage(CONFIG_NAMESPACE, KEY.c_str(), m_json)) {
+                ESP_LOGE(KEY.c_str(), "Error staging config: %s", err.message().c_str());
                 return err;
             }
-
             return {};
         }
 
@@ -603,7 +1792,12 @@ namespace sdk {
                 return 0;
             }
             size_t size = 0;
-            provider.getStringSize(KEY.c_str(), size);
+            if (provider.getStringSize(KEY.c_str(), size).value() == ESP_ERR_NVS_NOT_FOUND) {
+                auto reader = provider.openReader(KEY.c_str());
+                if (!reader.open()) {
+                    size = reader.size();
+                }
+            }
             return size;
         }
     };
@@ -0,0 +1,352 @@
+#ifndef CONFIG_SNAPSHOT_HPP
+#define CONFIG_SNAPSHOT_HPP
+
+#include <esp_log.h>
+#include <esp_rom_crc.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <span>
+
+#include "ConfigProvider.hpp"
+#include "esp_app_desc.h"
+#include "esp_err.h"
+#include "esp_system_error.hpp"
+
+/**
+ * A snapshot holds every registered ConfigObject in one binary image:
+ *   Header, then per object an EntryHeader followed by the stored json, then the CRC32 of everything before it.
+ *
+ * Importing stages all objects in a single ConfigTransaction, which is only committed once the checksum matches.
+ * Both directions stream, so a snapshot never has to fit in memory and can be passed through an HTTP body as is.
+ */
+namespace sdk {
+
+    class ConfigSnapshot {
+    public:
+        struct Header {
+            uint32_t magic;
+            uint16_t formatVersion;
+            uint16_t count;
+            char     firmwareVersion[32];
+        };
+
+        struct EntryHeader {
+            char     key[NVS_KEY_NAME_MAX_SIZE];
+            uint32_t length;
+        };
+
+        static constexpr uint32_t snapshotMagic = 0x504e5343; // "CSNP"
+        static constexpr uint16_t formatVersion = 1;
+
+        /**
+         * @brief Write a snapshot of all registered ConfigObjects that are stored in NVS
+         * @tparam SINK Callable as std::error_code(std::span<const uint8_t>)
+         * @param sink Receives the snapshot in pieces, returning an error stops the export
+         * @return Error code of type esp_err_t, or the error returned by the sink
+         */
+        template<typename SINK>
+        static std::error_code exportTo(SINK&& sink) {
+            ConfigProvider provider(CONFIG_NAMESPACE, true);
+            const auto     openError = provider.initialize();
+            if (openError && openError.value() != ESP_ERR_NVS_NOT_FOUND) {
+                return openError;
+            }
+            // Without a config namespace nothing was ever saved, which is still a valid snapshot
+            const bool hasConfig = !openError;
+
+            uint32_t crc  = 0;
+            auto     emit = [&sink, &crc](const void* data, size_t size) {
+                const std::span<const uint8_t> bytes{static_cast<const uint8_t*>(data), size};
+                crc = esp_rom_crc32_le(crc, bytes.data(), bytes.size());
+                return sink(bytes);
+            };
+
+            Header header{.magic = snapshotMagic, .formatVersion = formatVersion, .count = 0, .firmwareVersion = {}};
+            std::strncpy(header.firmwareVersion, esp_app_get_description()->version, sizeof(header.firmwareVersion) - 1);
+            for (const char* key: ConfigRegistry::keys()) {
+                if (hasConfig && find(provider, key)) {
+                    header.count++;
+                }
+            }
+            if (auto err = emit(&header, sizeof(header))) {
+                return err;
+            }
+
+            for (const char* key: ConfigRegistry::keys()) {
+                const auto stored = hasConfig ? find(provider, key) : std::nullopt;
+                if (!stored) {
+                    continue;
+                }
+                EntryHeader entry{.key = {}, .length = static_cast<uint32_t>(stored->size)};
+                std::strncpy(entry.key, key, sizeof(entry.key) - 1);
+                if (auto err = emit(&entry, sizeof(entry))) {
+                    return err;
+                }
+
+                if (stored->chunked) {
+                    auto reader = provider.openReader(key);
+                    if (auto err = reader.open()) {
+                        return err;
+                    }
+                    std::array<uint8_t, 128> buffer{};
+                    while (true) {
+                        const auto count = reader.read(buffer);
+                        if (!count) {
+                            ESP_LOGE(TAG, "Error exporting %s: %s", key, count.error().message().c_str());
+                            return count.error();
+                        } else if (count.value() == 0) {
+                            break;
+                        } else if (auto err = emit(buffer.data(), count.value())) {
+                            return err;
+                        }
+                    }
+                } else {
+                    // Too large for the stack, this is the only allocation of the export
+                    auto buffer = std::make_unique<etl::string<ConfigProvider::maxStringSize>>();
+                    if (auto err = provider.loadItem(key, *buffer)) {
+                        return err;
+                    }
+                    if (auto err = emit(buffer->data(), buffer->size())) {
+                        return err;
+                    }
+                }
+            }
+
+            return sink(std::span<const uint8_t>{reinterpret_cast<const uint8_t*>(&crc), sizeof(crc)});
+        }
+
+        /**
+         * @brief Restores a snapshot that arrives in pieces of any size
+         *
+         *        Nothing is visible until finish() verifies the checksum and commits. Dropping the importer before
+         *        that rolls back everything staged so far. Once committed, the owners of imported objects that are bound
+         *        in the ConfigRegistry reload them, so they don't save their old values over the import. Objects without
+         *        such an owner may still be held with their old values, restartType() then asks for a device restart.
+         */
+        class Importer {
+        public:
+            /**
+             * @brief Feed the next piece of the snapshot
+             * @param data Snapshot bytes
+             * @return Error code of type esp_err_t, errors are sticky. ESP_ERR_INVALID_VERSION if this is not a
+             *         snapshot or was made with a newer format, ESP_ERR_INVALID_SIZE on data past the end,
+             *         ESP_ERR_NOT_FOUND for an object that is not registered, ESP_ERR_INVALID_ARG for a value
+             *         that is not valid json
+             */
+            std::error_code write(std::span<const uint8_t> data) {
+                while (!m_error && !data.empty()) {
+                    switch (m_state) {
+                        case State::HEADER:
+                            if (collect(data, &m_header, sizeof(m_header), true)) {
+                                m_error = onHeader();
+                            }
+                            break;
+                        case State::ENTRY:
+                            if (collect(data, &m_entry, sizeof(m_entry), true)) {
+                                m_error = onEntry();
+                            }
+                            break;
+                        case State::VALUE: {
+                            const auto piece = data.first(std::min<size_t>(data.size(), m_remaining));
+                            m_crc            = esp_rom_crc32_le(m_crc, piece.data(), piece.size());
+                            m_remaining -= piece.size();
+                            data = data.subspan(piece.size());
+                            if (auto err = m_transaction.appendValue(piece)) {
+                                m_error = err;
+                            } else if (m_remaining == 0) {
+                                m_error = m_transaction.endValue();
+                                nextEntry();
+                            }
+                            break;
+                        }
+                        case State::TRAILER:
+                            if (collect(data, &m_expectedCrc, sizeof(m_expectedCrc), false)) {
+                                m_state = State::DONE;
+                            }
+                            break;
+                        case State::DONE:
+                            ESP_LOGE(TAG, "Unexpected data after the end of the snapshot");
+                            m_error = std::make_error_code(ESP_ERR_INVALID_SIZE);
+                            break;
+                    }
+                }
+                return m_error;
+            }
+
+            /**
+             * @brief Verify the checksum and publish all objects with a single commit
+             * @return Error code of type esp_err_t, ESP_ERR_INVALID_SIZE if the snapshot is incomplete,
+             *         ESP_ERR_INVALID_CRC if it is corrupted
+             */
+            std::error_code finish() {
+                if (m_error) {
+                    return m_error;
+                }
+                if (m_state != State::DONE) {
+                    ESP_LOGE(TAG, "Snapshot is incomplete");
+                    return m_error = std::make_error_code(ESP_ERR_INVALID_SIZE);
+                }
+                if (m_crc != m_expectedCrc) {
+                    ESP_LOGE(TAG, "Snapshot checksum mismatch");
+                    return m_error = std::make_error_code(ESP_ERR_INVALID_CRC);
+                }
+                if (auto err = m_transaction.commit()) {
+                    return m_error = err;
+                }
+                ESP_LOGI(TAG, "Imported %u objects, exported by firmware %s", m_header.count, m_header.firmwareVersion);
+                return {};
+            }
+
+            /**
+             * @brief Get the restart the imported config needs to take effect, once finish() succeeded
+             */
+            [[nodiscard]] RestartType restartType() const {
+                return m_restartType;
+            }
+
+        private:
+            enum class State {
+                HEADER,
+                ENTRY,
+                VALUE,
+                TRAILER,
+                DONE
+            };
+
+            ConfigTransaction                    m_transaction;
+            State                                m_state{State::HEADER};
+            Header                               m_header{};
+            EntryHeader                          m_entry{};
+            std::array<uint8_t, sizeof(Header)>  m_partial{};
+            size_t                               m_collected{0};
+            size_t                               m_remaining{0};
+            uint16_t                             m_index{0};
+            uint32_t                             m_crc{0};
+            uint32_t                             m_expectedCrc{0};
+            std::error_code                      m_error{};
+            // Keys of the registry, which outlive the importer
+            ConfigRegistry::Keys                 m_imported{};
+            RestartType                          m_restartType{RestartType::NONE};
+
+            /**
+             * @brief Gather a fixed size record that may be split across pieces
+             * @return True once the record is complete and copied to target
+             */
+            bool collect(std::span<const uint8_t>& data, void* target, size_t size, bool checksum) {
+                const size_t count = std::min(data.size(), size - m_collected);
+                std::memcpy(m_partial.data() + m_collected, data.data(), count);
+                if (checksum) {
+                    m_crc = esp_rom_crc32_le(m_crc, data.data(), count);
+                }
+                m_collected += count;
+                data = data.subspan(count);
+                if (m_collected < size) {
+                    return false;
+                }
+                std::memcpy(target, m_partial.data(), size);
+                m_collected = 0;
+                return true;
+            }
+
+            std::error_code onHeader() {
+                if (m_header.magic != snapshotMagic || m_header.formatVersion > formatVersion) {
+                    ESP_LOGE(TAG, "Not a supported config snapshot");
+                    return std::make_error_code(ESP_ERR_INVALID_VERSION);
+                }
+                m_header.firmwareVersion[sizeof(m_header.firmwareVersion) - 1] = '\0';
+                m_index                                                        = 0;
+                m_state                                                        = m_header.count > 0 ? State::ENTRY : State::TRAILER;
+                // Commit hooks run right after the copy to the destination, before anyone can save over it
+                return m_transaction.onCommit([this] { reloadImported(); });
+            }
+
+            std::error_code onEntry() {
+                if (std::memchr(m_entry.key, '\0', sizeof(m_entry.key)) == nullptr || m_entry.key[0] == '\0' || m_entry.length == 0) {
+                    ESP_LOGE(TAG, "Malformed snapshot entry %u", m_index);
+                    return std::make_error_code(ESP_ERR_INVALID_ARG);
+                }
+                // Only objects this firmware knows, anything else would be written to NVS and never read again
+                const auto& keys  = ConfigRegistry::keys();
+                const auto  known = std::find_if(keys.begin(), keys.end(), [this](const char* key) { return std::strcmp(key, m_entry.key) == 0; });
+                if (known == keys.end()) {
+                    ESP_LOGE(TAG, "Snapshot holds unknown object %s", m_entry.key);
+                    return std::make_error_code(ESP_ERR_NOT_FOUND);
+                }
+                if (std::find(m_imported.begin(), m_imported.end(), *known) == m_imported.end()) {
+                    m_imported.push_back(*known);
+                }
+                if (auto err = m_transaction.beginValue(CONFIG_NAMESPACE, m_entry.key)) {
+                    return err;
+                }
+                m_remaining = m_entry.length;
+                m_state     = State::VALUE;
+                return {};
+            }
+
+            /**
+             * @brief Have the owners of the imported objects load them again, and gather the restart that needs
+             */
+            void reloadImported() {
+                for (const char* key: m_imported) {
+                    const auto reloaded = ConfigRegistry::reload(key);
+                    if (reloaded) {
+                        m_restartType = std::max(m_restartType, reloaded->restartType);
+                    } else {
+                        if (reloaded.error().value() != ESP_ERR_NOT_FOUND) {
+                            ESP_LOGE(TAG, "Error reloading %s: %s", key, reloaded.error().message().c_str());
+                        }
+                        m_restartType = RestartType::DEVICE;
+                    }
+                }
+            }
+
+            void nextEntry() {
+                m_index++;
+                m_state = m_index < m_header.count ? State::ENTRY : State::TRAILER;
+            }
+        };
+
+        /**
+         * @brief Restore a snapshot that is completely in memory
+         * @param snapshot Snapshot bytes
+         * @return Error code of type esp_err_t
+         */
+        static std::error_code import(std::span<const uint8_t> snapshot) {
+            Importer importer;
+            if (auto err = importer.write(snapshot)) {
+                return err;
+            }
+            return importer.finish();
+        }
+
+    private:
+        static constexpr char TAG[] = "CONFIG SNAPSHOT";
+
+        struct StoredValue {
+            size_t size;
+            bool   chunked;
+        };
+
+        /**
+         * @brief Look up how a ConfigObject is stored, if at all
+         */
+        static std::optional<StoredValue> find(ConfigProvider& provider, const char* key) {
+            auto reader = provider.openReader(key);
+            if (!reader.open()) {
+                return StoredValue{.size = reader.size(), .chunked = true};
+            }
+            size_t size = 0;
+            if (provider.getStringSize(key, size) || size == 0) {
+                return std::nullopt;
+            }
+            // The stored size includes the zero terminator
+            return StoredValue{.size = size - 1, .chunked = false};
+        }
+    };
+
+} // namespace sdk
+
+#endif // CONFIG_SNAPSHOT_HPP
@@ -0,0 +1,184 @@
+#ifndef HTTP_ADMISSION_CONTROL_HPP
+#define HTTP_ADMISSION_CONTROL_HPP
+
+#include <esp_err.h>
+#include <esp_http_server.h>
+#include <etl/vector.h>
+
+#include <array>
+#include <cstdint>
+#include <expected>
+#include <mutex>
+#include <optional>
+#include <system_error>
+
+#include "ConfigProvider.hpp"
+#include "HttpStatusCode.hpp"
+#include "RouteMetrics.hpp"
+
+namespace sdk::Http {
+
+    /**
+     * @brief Keeps a single client from using up the few sockets and the time of the httpd task
+     *
+     *        Every client IP may have a limited number of connections open and gets a token bucket that each request
+     *        takes a token from. Connections are checked when httpd accepts them, requests once their route is found, so
+     *        what is rejected costs a lookup in a small table. The table remembers the clients that were seen last,
+     *        the least recently seen client without open connections makes room for a new one.
+     */
+    class AdmissionControl {
+    public:
+        class Config final : public ConfigObject<3, 128, "HTTP ADMISSION"> {
+            using Base = ConfigObject<3, 128, "HTTP ADMISSION">;
+
+        public:
+            /**
+             * @brief Tokens added to the bucket of a client per second, 0 disables rate limiting
+             */
+            sdk::ConfigField<uint16_t> rate{CONFIG_HTTP_RATE_LIMIT_RATE, "rate"};
+            /**
+             * @brief Size of the bucket, the amount of requests a client can make at once
+             */
+            sdk::ConfigField<uint16_t> burst{CONFIG_HTTP_RATE_LIMIT_BURST, "burst"};
+            /**
+             * @brief Connections a client may have open at once, 0 disables the limit
+             */
+            sdk::ConfigField<uint8_t> connections{CONFIG_HTTP_MAX_CONNECTIONS_PER_CLIENT, "connections"};
+
+            void allocateFields() {
+                rate        = allocate(rate);
+                burst       = allocate(burst);
+                connections = allocate(connections);
+            }
+
+            Config(const nlohmann::json& data) : Base(data) {
+                allocateFields();
+            }
+
+            Config() : Base() {
+                allocateFields();
+            }
+        };
+
+        struct Counters {
+            uint32_t connectionsAccepted;
+            /**
+             * @brief Connections closed right away as their client had too many open
+             */
+            uint32_t connectionsRejected;
+            /**
+             * @brief Requests answered with 429 as their client ran out of tokens
+             */
+            uint32_t requestsLimited;
+            /**
+             * @brief Clients dropped from the table to make room for another client
+             */
+            uint32_t clientsEvicted;
+            /**
+             * @brief Sockets closed while every socket was in use, for any reason. httpd doesn't tell its LRU purges
+             *        apart from other closes, so they are included but not counted on their own
+             */
+            uint32_t socketsClosedAtCapacity;
+            uint16_t openSockets;
+        };
+
+        /**
+         * @brief Binds the limits in the ConfigRegistry, so clients can read and patch them through the admission control
+         */
+        AdmissionControl();
+        ~AdmissionControl();
+
+        AdmissionControl(const AdmissionControl&)            = delete;
+        AdmissionControl& operator=(const AdmissionControl&) = delete;
+
+        /**
+         * @brief Hook into the connections of a server, must be called before httpd_start().
+         * @param config Config of the server, gets its open_fn, close_fn and global_user_ctx set and LRU purging enabled.
+         * @return ESP_ERR_INVALID_STATE if the config already has an open_fn, close_fn or global_user_ctx.
+         */
+        esp_err_t install(httpd_config_t& config);
+
+        /**
+         * @brief Check whether a request may be handled, and answer it with 429 Too Many Requests if not.
+         * @param req The request, before it is handled.
+         * @param metrics Metrics of the route the request matched, which count the 429. nullptr if it matched none.
+         * @return True if the request may be handled, otherwise it was answered already.
+         */
+        bool admit(httpd_req_t* req, RouteMetrics* metrics);
+
+        /**
+         * @brief Get a copy of the counters.
+         */
+        [[nodiscard]] Counters read() const;
+
+        /**
+         * @brief Updates the limits, they apply to the next connection or request
+         * @param config Json merge patch with the fields to update
+         * @param saveConfig Whether to store the limits in NVS
+         */
+        void setConfig(const nlohmann::json& config, bool saveConfig = true);
+
+        /**
+         * @brief Stages the updated limits in a transaction, the limits only change once the transaction commits
+         * @param config Json merge patch with the fields to update
+         * @param transaction Transaction to stage the config in
+         * @return Error code of type esp_err_t, an invalid update is ESP_ERR_INVALID_ARG
+         */
+        std::error_code setConfig(const nlohmann::json& config, ConfigTransaction& transaction);
+
+    private:
+        static constexpr char TAG[] = "HTTP ADMISSION";
+
+        // Tokens are counted in thousandths, so slow rates still refill between requests
+        static constexpr uint32_t TOKEN = 1000;
+
+        // IPv6 address, IPv4 clients are stored as IPv4 mapped addresses
+        using Address = std::array<uint8_t, 16>;
+
+        struct Client {
+            Address  address;
+            uint8_t  connections;
+            uint32_t tokens;
+            int64_t  lastRefill;
+            int64_t  lastSeen;
+        };
+
+        mutable std::mutex                                     m_mutex;
+        Config                                                 m_config;
+        etl::vector<Client, CONFIG_HTTP_ADMISSION_MAX_CLIENTS> m_clients;
+        Counters                                               m_counters{};
+        uint16_t                                               m_maxSockets = 0;
+
+        static esp_err_t onOpen(httpd_handle_t handle, int socket);
+        static void      onClose(httpd_handle_t handle, int socket);
+
+        static std::optional<Address> peerAddress(int socket);
+
+        /**
+         * @brief Find a client, or add it to the table if there is room or a client can be evicted.
+         * @return The client, nullptr if the table is full of clients with open connections.
+         */
+        Client* findOrAdd(const Address& address, int64_t now);
+
+        Client* find(const Address& address);
+
+        /**
+         * @brief Applies a config update, must be called with m_mutex held
+         * @return The amount of changed fields and the restart they require, ESP_ERR_INVALID_ARG if the update is invalid
+         */
+        std::expected<ConfigRegistry::PatchSummary, std::error_code> patchConfig(const nlohmann::json& config);
+
+        /**
+         * @brief Applies and saves a config update from a client of the ConfigRegistry
+         */
+        std::expected<ConfigRegistry::PatchSummary, std::error_code> patchFromClient(const nlohmann::json& config);
+
+        /**
+         * @brief Loads the limits again after a snapshot import replaced them
+         */
+        std::expected<ConfigRegistry::PatchSummary, std::error_code> reloadConfig();
+    };
+
+} // namespace sdk::Http
+
+#endif /* HTTP_ADMISSION_CONTROL_HPP */
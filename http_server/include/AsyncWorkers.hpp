@@ -0,0 +1,55 @@
+#ifndef HTTP_ASYNC_WORKERS_HPP
+#define HTTP_ASYNC_WORKERS_HPP
+
+#include <esp_err.h>
+#include <esp_http_server.h>
+#include <freertos/FreeRTOS.h>
+
+#include <cstddef>
+
+namespace sdk::Http {
+
+    /**
+     * @brief Tasks that finish requests detached from the httpd task, so a slow callback doesn't stall other clients
+     *
+     *        CONFIG_HTTP_ASYNC_WORKERS tasks take requests from a queue. At most CONFIG_HTTP_ASYNC_MAX_IN_FLIGHT
+     *        requests are detached at once, queued or running, the pool is shared by every server.
+     */
+    class AsyncWorkers {
+    public:
+        /**
+         * @brief Handles a detached request on a worker, the request is completed after it returns.
+         */
+        using Handler = esp_err_t (*)(httpd_req_t* req, void* context);
+
+        /**
+         * @brief Create the worker tasks, does nothing if they are running already.
+         * @return Error code of type esp_err_t, ESP_ERR_NO_MEM if a task could not be created.
+         */
+        static esp_err_t start();
+
+        /**
+         * @brief Detach a request from the httpd task and queue it for a worker.
+         * @param req The request, don't use it anymore when this succeeds.
+         * @param handler Called with a copy of the request on a worker.
+         * @param context Passed to the handler, must stay valid until the request is completed.
+         * @return Error code of type esp_err_t, ESP_ERR_NO_MEM if too many requests are in flight.
+         */
+        static esp_err_t submit(httpd_req_t* req, Handler handler, void* context);
+
+        /**
+         * @brief Wait until every detached request has been completed.
+         * @param timeout Maximum time to wait.
+         * @return ESP_OK if no requests are in flight, ESP_ERR_TIMEOUT otherwise.
+         */
+        static esp_err_t drain(TickType_t timeout);
+
+        /**
+         * @brief Get the number of requests that are queued or running.
+         */
+        static std::size_t inFlight();
+    };
+
+} // namespace sdk::Http
+
+#endif /* HTTP_ASYNC_WORKERS_HPP */
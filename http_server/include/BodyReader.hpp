@@ -0,0 +1,170 @@
+#ifndef HTTP_BODY_READER_HPP
+#define HTTP_BODY_READER_HPP
+
+#include <esp_err.h>
+#include <esp_http_server.h>
+#include <esp_log.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <expected>
+#include <iterator>
+#include <span>
+
+namespace sdk::Http {
+
+    /**
+     * @brief Reads a request body as it arrives, until Content-Length bytes are consumed
+     *
+     *        The body may arrive in any number of TCP segments, each receive is retried on a socket timeout up to
+     *        CONFIG_RETRIEVE_BODY_TIMEOUT_RETRY_COUNT times. Errors are of type esp_err_t or HTTPD_SOCK_ERR_*.
+     *
+     *        The iterators allow parsers to read straight from the socket, keeping only a small buffer in memory:
+     *        @code
+     *        auto json = nlohmann::json::parse(body.begin(), body.end(), nullptr, false);
+     *        if (body.error() != ESP_OK || json.is_discarded()) { ... }
+     *        @endcode
+     */
+    class BodyReader {
+    public:
+        /**
+         * @brief Input iterator over the bytes of the body
+         */
+        class Iterator {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type        = char;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = const char*;
+            using reference         = const char&;
+
+            explicit Iterator(BodyReader* reader = nullptr) : m_reader(reader) {}
+
+            reference operator*() const { return m_reader->m_buffer[m_reader->m_position]; }
+
+            Iterator& operator++() {
+                m_reader->m_position++;
+                return *this;
+            }
+
+            void operator++(int) { m_reader->m_position++; }
+
+            bool operator==(const Iterator& other) const {
+                return atEnd() == other.atEnd();
+            }
+
+        private:
+            [[nodiscard]] bool atEnd() const { return m_reader == nullptr || !m_reader->fill(); }
+
+            BodyReader* m_reader;
+        };
+
+        explicit BodyReader(httpd_req_t* req) : m_req(req), m_remaining(req->content_len) {}
+
+        BodyReader(const BodyReader&)            = delete;
+        BodyReader& operator=(const BodyReader&) = delete;
+
+        /**
+         * @brief Read the next part of the body, waiting until the buffer is full or the body is complete
+         * @param buffer Place to store the body
+         * @return Amount of bytes read, 0 once the whole body is consumed
+         */
+        std::expected<size_t, esp_err_t> read(std::span<char> buffer) {
+            // Bytes buffered for the iterators come first
+            size_t count = std::min(buffer.size(), m_length - m_position);
+            std::memcpy(buffer.data(), m_buffer.data() + m_position, count);
+            m_position += count;
+
+            while (count < buffer.size() && m_remaining > 0) {
+                const size_t received = receive(buffer.data() + count, std::min(buffer.size() - count, m_remaining));
+                if (received == 0) {
+                    return std::unexpected(m_error);
+                }
+                count += received;
+            }
+            return count;
+        }
+
+        /**
+         * @brief Total size of the body, as announced by the client
+         */
+        [[nodiscard]] size_t contentLength() const { return m_req->content_len; }
+
+        /**
+         * @brief The request the body belongs to, such as to check its headers
+         */
+        [[nodiscard]] httpd_req_t* request() const { return m_req; }
+
+        /**
+         * @brief Amount of bytes that were not read yet
+         */
+        [[nodiscard]] size_t remaining() const { return m_remaining + m_length - m_position; }
+
+        /**
+         * @brief Error that stopped reading, if any
+         */
+        [[nodiscard]] esp_err_t error() const { return m_error; }
+
+        Iterator begin() { return Iterator(this); }
+
+        Iterator end() { return Iterator(); }
+
+    private:
+        static constexpr char TAG[] = "HTTP BODY";
+
+        httpd_req_t*          m_req;
+        size_t                m_remaining;
+        std::array<char, 128> m_buffer{};
+        size_t                m_length{0};
+        size_t                m_position{0};
+        esp_err_t             m_error{ESP_OK};
+
+        /**
+         * @brief Receive whatever part of the body is available, retrying on timeouts
+         * @return Amount of bytes received, 0 on error
+         */
+        size_t receive(char* buffer, size_t size) {
+            if (m_error != ESP_OK) {
+                return 0;
+            }
+            for (int i = 0; i < CONFIG_RETRIEVE_BODY_TIMEOUT_RETRY_COUNT; i++) {
+                const int received = httpd_req_recv(m_req, buffer, size);
+                if (received > 0) {
+                    m_remaining -= received;
+                    return received;
+                }
+                // If there was a timeout while receiving the body, retry
+                if (received == HTTPD_SOCK_ERR_TIMEOUT) {
+                    continue;
+                }
+                // Zero means the connection closed before the whole body arrived
+                ESP_LOGE(TAG, "Error receiving body for %s, %zu bytes missing", m_req->uri, m_remaining);
+                m_error = received == 0 ? HTTPD_SOCK_ERR_FAIL : received;
+                return 0;
+            }
+            ESP_LOGE(TAG, "Timeout receiving body for %s, %zu bytes missing", m_req->uri, m_remaining);
+            m_error = HTTPD_SOCK_ERR_TIMEOUT;
+            return 0;
+        }
+
+        /**
+         * @brief Makes sure unread data is buffered for the iterators
+         * @return False at the end of the body or on error
+         */
+        bool fill() {
+            if (m_position < m_length) {
+                return true;
+            }
+            if (m_remaining == 0) {
+                return false;
+            }
+            m_length   = receive(m_buffer.data(), std::min(m_buffer.size(), m_remaining));
+            m_position = 0;
+            return m_length > 0;
+        }
+    };
+
+} // namespace sdk::Http
+
+#endif /* HTTP_BODY_READER_HPP */
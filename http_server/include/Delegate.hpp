@@ -0,0 +1,125 @@
+#ifndef HTTP_DELEGATE_HPP
+#define HTTP_DELEGATE_HPP
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace sdk::Http {
+
+    template<typename SIGNATURE, std::size_t CAPACITY = CONFIG_HTTP_DELEGATE_SIZE>
+    class Delegate;
+
+    /**
+     * @brief A callable that is stored inside the object itself, so it never allocates
+     *
+     *        Takes lambdas, function pointers and function objects like std::function does, as long as they fit in
+     *        CAPACITY bytes. Anything larger fails to compile instead of falling back to the heap.
+     * @tparam R Return type of the callable.
+     * @tparam ARGS Argument types of the callable.
+     * @tparam CAPACITY Room for the callable and its captures, in bytes.
+     */
+    template<typename R, typename... ARGS, std::size_t CAPACITY>
+    class Delegate<R(ARGS...), CAPACITY> {
+    public:
+        Delegate() = default;
+
+        Delegate(std::nullptr_t) {}
+
+        template<typename F>
+            requires(!std::is_same_v<std::decay_t<F>, Delegate> && std::is_invocable_r_v<R, std::decay_t<F>&, ARGS...>)
+        Delegate(F&& callable) {
+            using T = std::decay_t<F>;
+            static_assert(sizeof(T) <= CAPACITY, "Callable is too large for a Delegate, capture less or increase HTTP_DELEGATE_SIZE");
+            static_assert(alignof(T) <= alignof(std::max_align_t), "Callable is over-aligned");
+            if constexpr (std::is_pointer_v<T> || std::is_member_pointer_v<T>) {
+                if (callable == nullptr) {
+                    return;
+                }
+            }
+            ::new (static_cast<void*>(m_storage)) T(std::forward<F>(callable));
+            m_operations = &operations<T>;
+        }
+
+        Delegate(const Delegate& other) : m_operations(other.m_operations) {
+            if (m_operations != nullptr) {
+                m_operations->copy(m_storage, other.m_storage);
+            }
+        }
+
+        Delegate(Delegate&& other) noexcept : m_operations(other.m_operations) {
+            if (m_operations != nullptr) {
+                m_operations->move(m_storage, other.m_storage);
+            }
+        }
+
+        Delegate& operator=(const Delegate& other) {
+            if (this != &other) {
+                reset();
+                if (other.m_operations != nullptr) {
+                    other.m_operations->copy(m_storage, other.m_storage);
+                    m_operations = other.m_operations;
+                }
+            }
+            return *this;
+        }
+
+        Delegate& operator=(Delegate&& other) noexcept {
+            if (this != &other) {
+                reset();
+                if (other.m_operations != nullptr) {
+                    other.m_operations->move(m_storage, other.m_storage);
+                    m_operations = other.m_operations;
+                }
+            }
+            return *this;
+        }
+
+        ~Delegate() {
+            reset();
+        }
+
+        /**
+         * @brief Call the stored callable, which must not be empty.
+         */
+        R operator()(ARGS... args) const {
+            return m_operations->invoke(m_storage, std::forward<ARGS>(args)...);
+        }
+
+        explicit operator bool() const {
+            return m_operations != nullptr;
+        }
+
+    private:
+        struct Operations {
+            R (*invoke)(void* storage, ARGS&&... args);
+            void (*copy)(void* to, const void* from);
+            void (*move)(void* to, void* from);
+            void (*destroy)(void* storage);
+        };
+
+        template<typename T>
+        static constexpr Operations operations = {
+                .invoke  = [](void* storage, ARGS&&... args) -> R { return std::invoke(*static_cast<T*>(storage), std::forward<ARGS>(args)...); },
+                .copy    = [](void* to, const void* from) { ::new (to) T(*static_cast<const T*>(from)); },
+                .move    = [](void* to, void* from) { ::new (to) T(std::move(*static_cast<T*>(from))); },
+                .destroy = [](void* storage) { static_cast<T*>(storage)->~T(); },
+        };
+
+        void reset() {
+            if (m_operations != nullptr) {
+                m_operations->destroy(m_storage);
+                m_operations = nullptr;
+            }
+        }
+
+        // Mutable like the target of std::function, whose call operator is const as well
+        alignas(std::max_align_t) mutable std::byte m_storage[CAPACITY];
+        const Operations*                           m_operations = nullptr;
+    };
+
+} // namespace sdk::Http
+
+#endif /* HTTP_DELEGATE_HPP */
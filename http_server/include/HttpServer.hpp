@@ -5,14 +5,29 @@
 #include <esp_err.h>
 #include <esp_http_server.h>
 #include <esp_log.h>
+#include <esp_rom_crc.h>
 #include <etl/string.h>
-#include <etl/unordered_map.h>
 #include <etl/vector.h>
 
+#include <cinttypes>
 #include <expected>
+#include <memory>
+#include <optional>
+#include <string_view>
 
 #include "ConfigProvider.hpp"
+#include "AdmissionControl.hpp"
+#include "AsyncWorkers.hpp"
+#include "BodyReader.hpp"
+#include "Delegate.hpp"
 #include "HttpStatusCode.hpp"
+#include "QueryParameters.hpp"
+#include "RequestArena.hpp"
+#include "ResponseWriter.hpp"
+#include "RouteMetrics.hpp"
+#include "RoutePattern.hpp"
+#include "StaticAssets.hpp"
+#include "WebSocket.hpp"
 
 namespace sdk::Http {
 
@@ -22,8 +37,8 @@ namespace sdk::Http {
 
         using SendHeader = std::pair<etl::string<32>, etl::string<128>>;
         using Uri        = etl::string<128>;
-        using QueryKey   = etl::string<20>;
-        using QueryValue = etl::string<50>;
+        using QueryKey   = Http::QueryKey;
+        using QueryValue = Http::QueryValue;
 
         /**
          * @brief Error type for the server. To be used in the callbacks to return an error.
@@ -44,16 +59,39 @@ namespace sdk::Http {
             const char* statusMessage() const { return statusCodePhrase(code); }
         };
 
+        /**
+         * @brief Decides whether a request may use a sensitive route, such as by checking its Authorization header.
+         */
+        using Authorize = bool (*)(httpd_req_t* req);
+
+        /**
+         * @brief Conditional GET support for a route. Responses carry an ETag, a request whose If-None-Match
+         *        contains it is answered with 304 Not Modified and no body.
+         */
+        struct CachePolicy {
+            /**
+             * @brief Returns a value that changes whenever the response changes, such as a config save counter.
+             *        With it, a 304 is sent without calling the callback at all. It gets the route's userContext and
+             *        must account for query parameters if the response depends on them.
+             *        Without it, the ETag is a checksum of the response, which saves sending the body but not creating it.
+             */
+            Delegate<uint32_t(void* userContext)> version;
+            /**
+             * @brief Value of the Cache-Control header, such as "no-cache" or "max-age=60". Not sent when empty.
+             */
+            etl::string<64> cacheControl;
+        };
+
         /**
          * @brief Callback type for GET requests.
          * @tparam N_PARAMETERS The number of parameters that the callback expects.
          * @tparam SIZE_RETURN The size of the returned string.
          * @param uri The full URI of the request made.
-         * @param parameters The parameters of the request, already decoded.
+         * @param parameters The parameters of the request, decoded when read.
          * @param userContext Any user context that was passed when registering the callback. Will be nullptr if not provided.
          */
         template<std::size_t N_PARAMETERS, std::size_t SIZE_RETURN>
-        using GetCallback = std::function<std::expected<etl::string<SIZE_RETURN>, Error>(const Uri& uri, const etl::unordered_map<QueryKey, QueryValue, N_PARAMETERS>& parameters, void* userContext)>;
+        using GetCallback = Delegate<std::expected<etl::string<SIZE_RETURN>, Error>(const Uri& uri, const QueryParameters<N_PARAMETERS>& parameters, void* userContext)>;
 
         /**
          * @brief Callback type for POST requests.
@@ -62,11 +100,47 @@ namespace sdk::Http {
          * @tparam SIZE_BODY The size of the buffer for the request body.
          * @param uri The full URI of the request made.
          * @param body The body of the request.
-         * @param parameters The parameters of the request, already decoded.
+         * @param parameters The parameters of the request, decoded when read.
          * @param userContext Any user context that was passed when registering the callback. Will be nullptr if not provided.
          */
         template<std::size_t N_PARAMETERS, std::size_t SIZE_RETURN, std::size_t SIZE_BODY>
-        using PostCallback = std::function<std::expected<etl::string<SIZE_RETURN>, Error>(const Uri& uri, const etl::string<SIZE_BODY>& body, const etl::unordered_map<QueryKey, QueryValue, N_PARAMETERS>& parameters, void* userContext)>;
+        using PostCallback = Delegate<std::expected<etl::string<SIZE_RETURN>, Error>(const Uri& uri, const etl::string<SIZE_BODY>& body, const QueryParameters<N_PARAMETERS>& parameters, void* userContext)>;
+
+        /**
+         * @brief Callback type for GET requests that stream their response.
+         * @tparam N_PARAMETERS The number of parameters that the callback expects.
+         * @param uri The full URI of the request made.
+         * @param parameters The parameters of the request, decoded when read.
+         * @param writer Sends the response in chunks as it is written. Does not need to be finished by the callback.
+         * @param userContext Any user context that was passed when registering the callback. Will be nullptr if not provided.
+         */
+        template<std::size_t N_PARAMETERS>
+        using StreamingGetCallback = Delegate<std::expected<void, Error>(const Uri& uri, const QueryParameters<N_PARAMETERS>& parameters, ResponseWriter& writer, void* userContext)>;
+
+        /**
+         * @brief Callback type for POST requests that stream their response.
+         * @tparam N_PARAMETERS The number of parameters that the callback expects.
+         * @tparam SIZE_BODY The size of the buffer for the request body.
+         * @param uri The full URI of the request made.
+         * @param body The body of the request.
+         * @param parameters The parameters of the request, decoded when read.
+         * @param writer Sends the response in chunks as it is written. Does not need to be finished by the callback.
+         * @param userContext Any user context that was passed when registering the callback. Will be nullptr if not provided.
+         */
+        template<std::size_t N_PARAMETERS, std::size_t SIZE_BODY>
+        using StreamingPostCallback = Delegate<std::expected<void, Error>(const Uri& uri, const etl::string<SIZE_BODY>& body, const QueryParameters<N_PARAMETERS>& parameters, ResponseWriter& writer, void* userContext)>;
+
+        /**
+         * @brief Callback type for POST requests that consume the body as it arrives.
+         * @tparam N_PARAMETERS The number of parameters that the callback expects.
+         * @tparam SIZE_RETURN The size of the returned string.
+         * @param uri The full URI of the request made.
+         * @param body Reader for the body, which does not have to fit in memory. Unread data is discarded.
+         * @param parameters The parameters of the request, decoded when read.
+         * @param userContext Any user context that was passed when registering the callback. Will be nullptr if not provided.
+         */
+        template<std::size_t N_PARAMETERS, std::size_t SIZE_RETURN>
+        using UploadCallback = Delegate<std::expected<etl::string<SIZE_RETURN>, Error>(const Uri& uri, BodyReader& body, const QueryParameters<N_PARAMETERS>& parameters, void* userContext)>;
 
         explicit Server(const httpd_config_t& config = HTTPD_DEFAULT_CONFIG()) : m_config(config) {}
 
@@ -76,6 +150,12 @@ namespace sdk::Http {
         Status          run() override;
         Status          stop() override;
 
+        /**
+         * @brief Get the per client limits, to change them at runtime with AdmissionControl::setConfig().
+         *        They only apply when HTTP_ADMISSION_CONTROL is enabled and the config has no connection callbacks.
+         */
+        AdmissionControl& admission() { return m_admission; }
+
         /**
          * @brief Register a raw URI handler.
          * @param uri The URI to register the handler for.
@@ -86,9 +166,33 @@ namespace sdk::Http {
          */
         std::error_code registerRawUri(const Uri& uri, const httpd_method_t& method, RawHandler handler, void* userContext = nullptr) const;
 
+        /**
+         * @brief Serve the files embedded with http_server_embed_static_assets(), straight from flash.
+         *
+         *        Files are sent gzip encoded with their ETag. HTML files must be revalidated on every load, other files
+         *        are cached for CONFIG_HTTP_STATIC_ASSET_MAX_AGE seconds. A path ending in '/' serves its index.html.
+         * @param uri The URI to serve the files under, requires a wildcard uri_match_fn in the config if it has a wildcard.
+         * @param assets The files to serve.
+         * @return An error code if the handler could not be registered.
+         */
+        std::error_code registerStaticAssets(const Uri& uri = "/*", std::span<const StaticAsset> assets = staticAssets());
+
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+        /**
+         * @brief Register a WebSocket endpoint, to push messages to clients with WebSocketEndpoint::broadcast().
+         *        Only available when the project enables CONFIG_HTTPD_WS_SUPPORT, esp_http_server leaves it disabled.
+         * @param uri The URI clients connect to.
+         * @param endpoint The endpoint that tracks the clients, must outlive the server.
+         * @param onMessage Called for every text frame a client sends, may be nullptr.
+         * @param userContext Any user context to pass to onMessage.
+         * @return An error code if the endpoint could not be registered.
+         */
+        std::error_code registerWebSocket(const Uri& uri, WebSocketEndpoint& endpoint, WebSocketEndpoint::MessageCallback onMessage = nullptr, void* userContext = nullptr) const;
+#endif
+
         /**
          * @brief Register a GET request callback.
-         * @tparam PATH The path of the URI to register the handler for.
+         * @tparam PATH The path of the URI to register the handler for, may contain {name} segments, see RoutePattern.
          * @tparam N_HEADERS The number of headers to send with the response.
          * @tparam N_PARAMETERS The number of parameters that the callback expects.
          * @tparam SIZE_RETURN The size of the returned string by the callback.
@@ -96,47 +200,19 @@ namespace sdk::Http {
          * @param parameters List of parameter keys that the callback expects. No additional parameters will be passed to the callback.
          * @param headers List of headers to send with the response.
          * @param userContext Any user context to pass to the handler.
+         * @param cache Enables ETags and conditional requests for this route, see CachePolicy.
+         * @param async Run the callback on an AsyncWorkers task instead of the httpd task, for callbacks that block.
          * @return An error code if the handler could not be registered.
          */
         template<StringLiteral PATH, std::size_t N_HEADERS, std::size_t N_PARAMETERS, std::size_t SIZE_RETURN>
-        std::error_code registerGet(GetCallback<N_PARAMETERS, SIZE_RETURN> callback, const std::array<QueryKey, N_PARAMETERS>& parameters, const etl::vector<SendHeader, N_HEADERS>& headers, void* userContext = nullptr) {
+        std::error_code registerGet(GetCallback<N_PARAMETERS, SIZE_RETURN> callback, const std::array<QueryKey, N_PARAMETERS>& parameters, const etl::vector<SendHeader, N_HEADERS>& headers, void* userContext = nullptr, std::optional<CachePolicy> cache = std::nullopt, bool async = false) {
             ESP_LOGD(TAG, "Registering GET callback for %s", PATH.c_str());
-
-            if (m_server == nullptr) {
-                ESP_LOGE(TAG, "Webserver not initialized");
-                return std::make_error_code(ESP_ERR_INVALID_STATE);
-            }
-
-            // Static so that the data will not be destroyed after the function returns, as the handler needs to access it
-            static GetData<N_HEADERS, N_PARAMETERS, SIZE_RETURN> data{
-                    .callback    = callback,
-                    .parameters  = parameters,
-                    .headers     = headers,
-                    .userContext = userContext};
-
-            const httpd_uri uri = {
-                    .uri      = PATH.c_str(),
-                    .method   = HTTP_GET,
-                    .handler  = getHandler<N_HEADERS, N_PARAMETERS, SIZE_RETURN>,
-                    .user_ctx = &data,
-#ifdef CONFIG_HTTPD_WS_SUPPORT
-                    .is_websocket             = false,
-                    .handle_ws_control_frames = false,
-                    .supported_subprotocol    = nullptr,
-#endif
-            };
-            if (const auto ret = httpd_register_uri_handler(m_server, &uri); ret != ESP_OK) {
-                assert(ret == ESP_ERR_HTTPD_HANDLER_EXISTS && "Don't register the same URI twice");
-                ESP_LOGE(TAG, "Error registering Get callback: %s", esp_err_to_name(ret));
-                return std::make_error_code(ret);
-            }
-            ESP_LOGD(TAG, "Registered GET callback for %s", PATH.c_str());
-            return {};
+            return addRoute<PATH>(HTTP_GET, std::make_unique<GetData<N_HEADERS, N_PARAMETERS, SIZE_RETURN>>(std::move(callback), parameters, headers, userContext, std::move(cache)), async);
         }
 
         /**
          * @brief Register a POST request callback.
-         * @tparam PATH The path of the URI to register the handler for.
+         * @tparam PATH The path of the URI to register the handler for, may contain {name} segments, see RoutePattern.
          * @tparam N_HEADERS The number of headers to send with the response.
          * @tparam N_PARAMETERS The number of parameters that the callback expects.
          * @tparam SIZE_RETURN The size of the returned string by the callback.
@@ -145,45 +221,207 @@ namespace sdk::Http {
          * @param parameters List of parameter keys that the callback expects. No additional parameters will be passed to the callback.
          * @param headers List of headers to send with the response.
          * @param userContext Any user context to pass to the handler.
+         * @param async Receive the body and run the callback on an AsyncWorkers task instead of the httpd task, for callbacks that block.
          * @return An error code if the handler could not be registered.
          */
         template<StringLiteral PATH, std::size_t N_HEADERS, std::size_t N_PARAMETERS, std::size_t SIZE_RETURN, std::size_t SIZE_BODY>
-        std::error_code registerPost(PostCallback<N_PARAMETERS, SIZE_RETURN, SIZE_BODY> callback, const std::array<QueryKey, N_PARAMETERS>& parameters, const etl::vector<SendHeader, N_HEADERS>& headers, void* userContext = nullptr) {
-            ESP_LOGD(TAG, "Registering GET callback for %s", PATH.c_str());
+        std::error_code registerPost(PostCallback<N_PARAMETERS, SIZE_RETURN, SIZE_BODY> callback, const std::array<QueryKey, N_PARAMETERS>& parameters, const etl::vector<SendHeader, N_HEADERS>& headers, void* userContext = nullptr, bool async = false) {
+            ESP_LOGD(TAG, "Registering POST callback for %s", PATH.c_str());
+            return addRoute<PATH>(HTTP_POST, std::make_unique<PostData<N_HEADERS, N_PARAMETERS, SIZE_RETURN, SIZE_BODY>>(std::move(callback), parameters, headers, userContext), async);
+        }
 
-            if (m_server == nullptr) {
-                ESP_LOGE(TAG, "Webserver not initialized");
-                return std::make_error_code(ESP_ERR_INVALID_STATE);
-            }
+        /**
+         * @brief Register a PATCH request callback, for partial updates. Handled like a POST request.
+         * @tparam PATH The path of the URI to register the handler for, may contain {name} segments, see RoutePattern.
+         * @tparam N_HEADERS The number of headers to send with the response.
+         * @tparam N_PARAMETERS The number of parameters that the callback expects.
+         * @tparam SIZE_RETURN The size of the returned string by the callback.
+         * @tparam SIZE_BODY The size of the buffer for the request body.
+         * @param callback The callback to call when the URI is requested.
+         * @param parameters List of parameter keys that the callback expects. No additional parameters will be passed to the callback.
+         * @param headers List of headers to send with the response.
+         * @param userContext Any user context to pass to the handler.
+         * @return An error code if the handler could not be registered.
+         */
+        template<StringLiteral PATH, std::size_t N_HEADERS, std::size_t N_PARAMETERS, std::size_t SIZE_RETURN, std::size_t SIZE_BODY>
+        std::error_code registerPatch(PostCallback<N_PARAMETERS, SIZE_RETURN, SIZE_BODY> callback, const std::array<QueryKey, N_PARAMETERS>& parameters, const etl::vector<SendHeader, N_HEADERS>& headers, void* userContext = nullptr) {
+            ESP_LOGD(TAG, "Registering PATCH callback for %s", PATH.c_str());
+            return addRoute<PATH>(HTTP_PATCH, std::make_unique<PostData<N_HEADERS, N_PARAMETERS, SIZE_RETURN, SIZE_BODY>>(std::move(callback), parameters, headers, userContext));
+        }
 
-            // Static so that the data will not be destroyed after the function returns, as the handler needs to access it
-            static PostData<N_HEADERS, N_PARAMETERS, SIZE_RETURN, SIZE_BODY> data{
-                    .callback    = callback,
-                    .parameters  = parameters,
-                    .headers     = headers,
-                    .userContext = userContext};
+        /**
+         * @brief Register a GET request callback that streams its response.
+         *
+         *        The response is sent with chunked transfer encoding while the callback writes it, so its size is not
+         *        limited by a buffer. An error returned before the first chunk went out is sent to the client as usual,
+         *        after that the connection is closed, so the client sees an incomplete response.
+         * @tparam PATH The path of the URI to register the handler for, may contain {name} segments, see RoutePattern.
+         * @tparam N_HEADERS The number of headers to send with the response.
+         * @tparam N_PARAMETERS The number of parameters that the callback expects.
+         * @param callback The callback to call when the URI is requested.
+         * @param parameters List of parameter keys that the callback expects. No additional parameters will be passed to the callback.
+         * @param headers List of headers to send with the response.
+         * @param userContext Any user context to pass to the handler.
+         * @return An error code if the handler could not be registered.
+         */
+        template<StringLiteral PATH, std::size_t N_HEADERS, std::size_t N_PARAMETERS>
+        std::error_code registerStreamingGet(StreamingGetCallback<N_PARAMETERS> callback, const std::array<QueryKey, N_PARAMETERS>& parameters, const etl::vector<SendHeader, N_HEADERS>& headers, void* userContext = nullptr) {
+            ESP_LOGD(TAG, "Registering streaming GET callback for %s", PATH.c_str());
+            return addRoute<PATH>(HTTP_GET, std::make_unique<StreamingGetData<N_HEADERS, N_PARAMETERS>>(std::move(callback), parameters, headers, userContext));
+        }
 
-            const httpd_uri uri = {
-                    .uri      = PATH.c_str(),
-                    .method   = HTTP_POST,
-                    .handler  = postHandler<N_HEADERS, N_PARAMETERS, SIZE_RETURN, SIZE_BODY>,
-                    .user_ctx = &data,
-#ifdef CONFIG_HTTPD_WS_SUPPORT
-                    .is_websocket             = false,
-                    .handle_ws_control_frames = false,
-                    .supported_subprotocol    = nullptr,
-#endif
-            };
-            if (const auto ret = httpd_register_uri_handler(m_server, &uri); ret != ESP_OK) {
-                assert(ret == ESP_ERR_HTTPD_HANDLER_EXISTS && "Don't register the same URI twice");
-                ESP_LOGE(TAG, "Error registering Get callback: %s", esp_err_to_name(ret));
-                return std::make_error_code(ret);
-            }
-            ESP_LOGD(TAG, "Registered GET callback for %s", PATH.c_str());
-            return {};
+        /**
+         * @brief Register a POST request callback that streams its response.
+         *
+         *        The response is sent with chunked transfer encoding while the callback writes it, see registerStreamingGet().
+         * @tparam PATH The path of the URI to register the handler for, may contain {name} segments, see RoutePattern.
+         * @tparam N_HEADERS The number of headers to send with the response.
+         * @tparam N_PARAMETERS The number of parameters that the callback expects.
+         * @tparam SIZE_BODY The size of the buffer for the request body.
+         * @param callback The callback to call when the URI is requested.
+         * @param parameters List of parameter keys that the callback expects. No additional parameters will be passed to the callback.
+         * @param headers List of headers to send with the response.
+         * @param userContext Any user context to pass to the handler.
+         * @return An error code if the handler could not be registered.
+         */
+        template<StringLiteral PATH, std::size_t N_HEADERS, std::size_t N_PARAMETERS, std::size_t SIZE_BODY>
+        std::error_code registerStreamingPost(StreamingPostCallback<N_PARAMETERS, SIZE_BODY> callback, const std::array<QueryKey, N_PARAMETERS>& parameters, const etl::vector<SendHeader, N_HEADERS>& headers, void* userContext = nullptr) {
+            ESP_LOGD(TAG, "Registering streaming POST callback for %s", PATH.c_str());
+            return addRoute<PATH>(HTTP_POST, std::make_unique<StreamingPostData<N_HEADERS, N_PARAMETERS, SIZE_BODY>>(std::move(callback), parameters, headers, userContext));
+        }
+
+        /**
+         * @brief Register a POST request callback that reads the body itself, as it arrives.
+         *
+         *        Unlike registerPost() the body is not buffered first, so it can be larger than the available memory.
+         * @tparam PATH The path of the URI to register the handler for, may contain {name} segments, see RoutePattern.
+         * @tparam N_HEADERS The number of headers to send with the response.
+         * @tparam N_PARAMETERS The number of parameters that the callback expects.
+         * @tparam SIZE_RETURN The size of the returned string by the callback.
+         * @param callback The callback to call when the URI is requested.
+         * @param parameters List of parameter keys that the callback expects. No additional parameters will be passed to the callback.
+         * @param headers List of headers to send with the response.
+         * @param userContext Any user context to pass to the handler.
+         * @param async Read the body and run the callback on an AsyncWorkers task instead of the httpd task, for large or slow uploads.
+         * @return An error code if the handler could not be registered.
+         */
+        template<StringLiteral PATH, std::size_t N_HEADERS, std::size_t N_PARAMETERS, std::size_t SIZE_RETURN>
+        std::error_code registerUpload(UploadCallback<N_PARAMETERS, SIZE_RETURN> callback, const std::array<QueryKey, N_PARAMETERS>& parameters, const etl::vector<SendHeader, N_HEADERS>& headers, void* userContext = nullptr, bool async = false) {
+            ESP_LOGD(TAG, "Registering upload callback for %s", PATH.c_str());
+            return addRoute<PATH>(HTTP_POST, std::make_unique<UploadData<N_HEADERS, N_PARAMETERS, SIZE_RETURN>>(std::move(callback), parameters, headers, userContext), async);
+        }
+
+        /**
+         * @brief Serve the metrics of every route, the state of the Manager components and heap statistics in the
+         *        Prometheus text format, to be scraped by a monitoring system. The output is streamed.
+         * @tparam PATH The path to serve the metrics on.
+         * @return An error code if the handler could not be registered.
+         */
+        template<StringLiteral PATH = "/metrics">
+        std::error_code registerMetrics() {
+            // One header slot, a vector that can't hold anything is not something etl guarantees to support
+            return registerStreamingGet<PATH, 1, 0>(
+                    [this](const Uri&, const QueryParameters<0>&, ResponseWriter& writer, void*) { return writeMetrics(writer); },
+                    {},
+                    {});
+        }
+
+        /**
+         * @brief Serve the ConfigObjects components bound in the ConfigRegistry by their KEY, such as
+         *        /api/config/WIFI%20Station.
+         *
+         *        GET writes the fields of the object as a json object, secret and internal fields left out. PATCH
+         *        hands a json merge patch to the component that owns the object, which applies it under its own lock
+         *        and saves the object when anything changed. The response tells the restart the changes need to take
+         *        effect, which is up to the client:
+         *        @code
+         *        {"changed":2,"restart":"component"}
+         *        @endcode
+         * @tparam PATH The path to serve the objects on, must capture the key as {key}.
+         * @return An error code if the handlers could not be registered.
+         */
+        template<StringLiteral PATH = "/api/config/{key}">
+        std::error_code registerConfigApi() {
+            static_assert(RoutePattern<PATH>::N_CAPTURES == 1, "The path must capture the key of the config object as {key}");
+            if (auto err = registerStreamingGet<PATH, 1, 0>(
+                        [](const Uri&, const QueryParameters<0>& parameters, ResponseWriter& writer, void*) { return writeConfig(parameters.path(), writer); },
+                        {},
+                        {})) {
+                return err;
+            }
+            return registerPatch<PATH, 1, 0, 64, CONFIG_HTTP_CONFIG_PATCH_SIZE>(
+                    [](const Uri&, const etl::string<CONFIG_HTTP_CONFIG_PATCH_SIZE>& body, const QueryParameters<0>& parameters, void*) { return patchConfig(parameters.path(), body); },
+                    {},
+                    {});
+        }
+
+        /**
+         * @brief Serve a snapshot of every stored ConfigObject and restore one, see ConfigSnapshot.
+         *
+         *        GET streams the snapshot. POST restores the snapshot in the body on an AsyncWorkers task, nothing
+         *        is saved unless every object in it is registered, valid json and the checksum matches. Components
+         *        that bound their config in the ConfigRegistry reload it, the response tells the restart that is
+         *        still needed, like the PATCH route of registerConfigApi(). Snapshots hold secret fields such as
+         *        passwords, so both routes need an Authorize hook.
+         * @tparam PATH The path to serve the snapshot on.
+         * @param authorize Accepts the requests that may read and replace the whole config.
+         * @return An error code if the handlers could not be registered, ESP_ERR_INVALID_ARG without a hook.
+         */
+        template<StringLiteral PATH = "/api/config-snapshot">
+        std::error_code registerConfigSnapshot(Authorize authorize) {
+            if (authorize == nullptr) {
+                ESP_LOGE(TAG, "Refusing to serve config snapshots without an Authorize hook");
+                return std::make_error_code(ESP_ERR_INVALID_ARG);
+            }
+            if (auto err = registerStreamingGet<PATH, 1, 0>(
+                        [authorize](const Uri&, const QueryParameters<0>&, ResponseWriter& writer, void*) { return exportConfig(authorize, writer); },
+                        {},
+                        {})) {
+                return err;
+            }
+            return registerUpload<PATH, 1, 0, 64>(
+                    [authorize](const Uri&, BodyReader& body, const QueryParameters<0>&, void*) { return importConfig(authorize, body); },
+                    {},
+                    {},
+                    nullptr,
+                    true);
         }
 
     private:
+        // What a callback returns, constructed in the request arena
+        template<std::size_t SIZE_RETURN>
+        using Result = std::expected<etl::string<SIZE_RETURN>, Error>;
+
+        /**
+         * @brief A registered route, owned by the server. httpd calls routeHandler() with the first route registered
+         *        for a URI, routes whose patterns share that URI are chained behind it.
+         */
+        struct Route {
+            virtual ~Route() = default;
+
+            /**
+             * @brief Handle a request that matched the route.
+             * @param req Pointer to the request object that was made.
+             * @param path The segments captured by the route.
+             * @return ESP_OK Whether the request was handled successfully.
+             */
+            virtual esp_err_t handle(httpd_req_t* req, const PathParameters& path) = 0;
+
+            std::string_view pattern;
+            const char*      handlerUri = nullptr;
+            httpd_method_t   method     = HTTP_GET;
+            // Checks the captures of the pattern, nullptr if the path has none and httpd's match is enough
+            bool (*match)(std::string_view path, PathParameters& captures) = nullptr;
+            // Next route with the same method and handler URI
+            Route* next = nullptr;
+            // Handled on an AsyncWorkers task
+            bool async = false;
+            // Checks the client before the route is looked up, nullptr if admission control is not installed
+            AdmissionControl* admission = nullptr;
+
+            RouteMetrics metrics;
+        };
+
         /**
          * @brief Data structure for GET request handlers. Wraps the callback and additional data.
          * @tparam N_HEADERS The number of headers to send with the response.
@@ -191,11 +429,21 @@ namespace sdk::Http {
          * @tparam SIZE_RETURN The size of the returned string.
          */
         template<std::size_t N_HEADERS, std::size_t N_PARAMETERS, std::size_t SIZE_RETURN>
-        struct GetData {
+        struct GetData final : Route {
+            static constexpr std::size_t ARENA_SIZE = RequestArena::required<Result<SIZE_RETURN>>();
+            static_assert(ARENA_SIZE <= RequestArena::SIZE, "The buffers of the route do not fit in a request arena, increase HTTP_ARENA_SIZE");
+
+            GetData(GetCallback<N_PARAMETERS, SIZE_RETURN> callback, const std::array<QueryKey, N_PARAMETERS>& parameters, const etl::vector<SendHeader, N_HEADERS>& headers, void* userContext, std::optional<CachePolicy> cache) : callback(std::move(callback)), parameters(parameters), headers(headers), userContext(userContext), cache(std::move(cache)) {}
+
+            esp_err_t handle(httpd_req_t* req, const PathParameters& path) override {
+                return getHandler(req, *this, path);
+            }
+
             GetCallback<N_PARAMETERS, SIZE_RETURN>   callback;
             std::array<QueryKey, N_PARAMETERS>       parameters;
             const etl::vector<SendHeader, N_HEADERS> headers;
             void*                                    userContext = nullptr;
+            std::optional<CachePolicy>               cache;
         };
 
         /**
@@ -206,48 +454,323 @@ namespace sdk::Http {
          * @tparam SIZE_BODY The size of the buffer for the request body.
          */
         template<std::size_t N_HEADERS, std::size_t N_PARAMETERS, std::size_t SIZE_RETURN, std::size_t SIZE_BODY>
-        struct PostData {
+        struct PostData final : Route {
+            static constexpr std::size_t ARENA_SIZE = RequestArena::required<etl::string<SIZE_BODY>, Result<SIZE_RETURN>>();
+            static_assert(ARENA_SIZE <= RequestArena::SIZE, "The buffers of the route do not fit in a request arena, increase HTTP_ARENA_SIZE");
+
+            PostData(PostCallback<N_PARAMETERS, SIZE_RETURN, SIZE_BODY> callback, const std::array<QueryKey, N_PARAMETERS>& parameters, const etl::vector<SendHeader, N_HEADERS>& headers, void* userContext) : callback(std::move(callback)), parameters(parameters), headers(headers), userContext(userContext) {}
+
+            esp_err_t handle(httpd_req_t* req, const PathParameters& path) override {
+                return postHandler(req, *this, path);
+            }
+
             PostCallback<N_PARAMETERS, SIZE_RETURN, SIZE_BODY> callback;
             std::array<QueryKey, N_PARAMETERS>                 parameters;
             const etl::vector<SendHeader, N_HEADERS>           headers;
             void*                                              userContext = nullptr;
         };
 
+        /**
+         * @brief Data structure for streaming GET request handlers. Wraps the callback and additional data.
+         * @tparam N_HEADERS The number of headers to send with the response.
+         * @tparam N_PARAMETERS The number of parameters that the callback expects.
+         */
+        template<std::size_t N_HEADERS, std::size_t N_PARAMETERS>
+        struct StreamingGetData final : Route {
+            static constexpr std::size_t ARENA_SIZE = RequestArena::required<ResponseWriter>();
+            static_assert(ARENA_SIZE <= RequestArena::SIZE, "The buffers of the route do not fit in a request arena, increase HTTP_ARENA_SIZE");
+
+            StreamingGetData(StreamingGetCallback<N_PARAMETERS> callback, const std::array<QueryKey, N_PARAMETERS>& parameters, const etl::vector<SendHeader, N_HEADERS>& headers, void* userContext) : callback(std::move(callback)), parameters(parameters), headers(headers), userContext(userContext) {}
+
+            esp_err_t handle(httpd_req_t* req, const PathParameters& path) override {
+                return streamingGetHandler(req, *this, path);
+            }
+
+            StreamingGetCallback<N_PARAMETERS>       callback;
+            std::array<QueryKey, N_PARAMETERS>       parameters;
+            const etl::vector<SendHeader, N_HEADERS> headers;
+            void*                                    userContext = nullptr;
+        };
+
+        /**
+         * @brief Data structure for streaming POST request handlers. Wraps the callback and additional data.
+         * @tparam N_HEADERS The number of headers to send with the response.
+         * @tparam N_PARAMETERS The number of parameters that the callback expects.
+         * @tparam SIZE_BODY The size of the buffer for the request body.
+         */
+        template<std::size_t N_HEADERS, std::size_t N_PARAMETERS, std::size_t SIZE_BODY>
+        struct StreamingPostData final : Route {
+            static constexpr std::size_t ARENA_SIZE = RequestArena::required<etl::string<SIZE_BODY>, ResponseWriter>();
+            static_assert(ARENA_SIZE <= RequestArena::SIZE, "The buffers of the route do not fit in a request arena, increase HTTP_ARENA_SIZE");
+
+            StreamingPostData(StreamingPostCallback<N_PARAMETERS, SIZE_BODY> callback, const std::array<QueryKey, N_PARAMETERS>& parameters, const etl::vector<SendHeader, N_HEADERS>& headers, void* userContext) : callback(std::move(callback)), parameters(parameters), headers(headers), userContext(userContext) {}
+
+            esp_err_t handle(httpd_req_t* req, const PathParameters& path) override {
+                return streamingPostHandler(req, *this, path);
+            }
+
+            StreamingPostCallback<N_PARAMETERS, SIZE_BODY> callback;
+            std::array<QueryKey, N_PARAMETERS>             parameters;
+            const etl::vector<SendHeader, N_HEADERS>       headers;
+            void*                                          userContext = nullptr;
+        };
+
+        /**
+         * @brief Data structure for upload request handlers. Wraps the callback and additional data.
+         * @tparam N_HEADERS The number of headers to send with the response.
+         * @tparam N_PARAMETERS The number of parameters that the callback expects.
+         * @tparam SIZE_RETURN The size of the returned string.
+         */
+        template<std::size_t N_HEADERS, std::size_t N_PARAMETERS, std::size_t SIZE_RETURN>
+        struct UploadData final : Route {
+            static constexpr std::size_t ARENA_SIZE = RequestArena::required<BodyReader, Result<SIZE_RETURN>>();
+            static_assert(ARENA_SIZE <= RequestArena::SIZE, "The buffers of the route do not fit in a request arena, increase HTTP_ARENA_SIZE");
+
+            UploadData(UploadCallback<N_PARAMETERS, SIZE_RETURN> callback, const std::array<QueryKey, N_PARAMETERS>& parameters, const etl::vector<SendHeader, N_HEADERS>& headers, void* userContext) : callback(std::move(callback)), parameters(parameters), headers(headers), userContext(userContext) {}
+
+            esp_err_t handle(httpd_req_t* req, const PathParameters& path) override {
+                return uploadHandler(req, *this, path);
+            }
+
+            UploadCallback<N_PARAMETERS, SIZE_RETURN> callback;
+            std::array<QueryKey, N_PARAMETERS>        parameters;
+            const etl::vector<SendHeader, N_HEADERS>  headers;
+            void*                                     userContext = nullptr;
+        };
+
         static constexpr char TAG[] = "HTTP SERVER";
 
+        // Quoted, as required for an ETag: a type character and 8 hex digits
+        using ETag = etl::string<12>;
+
         httpd_handle_t m_server = nullptr;
         httpd_config_t m_config;
 
+        etl::vector<std::unique_ptr<Route>, CONFIG_HTTP_MAX_ROUTES> m_routes;
+
+        std::span<const StaticAsset> m_staticAssets{};
+        Uri                          m_staticUri;
+        RouteMetrics                 m_staticMetrics;
+
+        AdmissionControl m_admission;
+        bool             m_admitting = false;
+
+        /**
+         * @brief Handler for the embedded static files.
+         * @param req Pointer to the request object that was made, its user context is the server.
+         * @return ESP_OK Whether the request was handled successfully.
+         */
+        static esp_err_t staticAssetHandler(httpd_req_t* req);
+
+        /**
+         * @brief Handler for every route, finds the route in the chain that matches the request path.
+         * @param req Pointer to the request object that was made, its user context is the first route of the chain.
+         * @return ESP_OK Whether the request was handled successfully.
+         */
+        static esp_err_t routeHandler(httpd_req_t* req);
+
+        /**
+         * @brief Handler for a route on an AsyncWorkers task.
+         * @param req The detached request.
+         * @param route The route that matched, its captures are matched again as they point into the original request.
+         * @return ESP_OK Whether the request was handled successfully.
+         */
+        static esp_err_t asyncRouteHandler(httpd_req_t* req, void* route);
+
+        /**
+         * @brief Write the metrics served by registerMetrics().
+         * @param writer Writer of the response.
+         * @return An error if the response could not be written.
+         */
+        std::expected<void, Error> writeMetrics(ResponseWriter& writer) const;
+
+        /**
+         * @brief Write the ConfigObject served by the GET route of registerConfigApi().
+         * @param path The segments captured by the route, holding the key.
+         * @param writer Writer of the response.
+         * @return An error if there is no such object or the response could not be written.
+         */
+        static std::expected<void, Error> writeConfig(const PathParameters& path, ResponseWriter& writer);
+
+        /**
+         * @brief Apply the change received by the PATCH route of registerConfigApi().
+         * @param path The segments captured by the route, holding the key.
+         * @param body The json merge patch.
+         * @return The amount of changed fields and the restart they need, or an error if the patch is invalid.
+         */
+        static Result<64> patchConfig(const PathParameters& path, const etl::string<CONFIG_HTTP_CONFIG_PATCH_SIZE>& body);
+
+        /**
+         * @brief Write the snapshot served by the GET route of registerConfigSnapshot().
+         * @param authorize Hook the request has to pass.
+         * @param writer Writer of the response.
+         * @return An error if the request is not authorized or the snapshot could not be written.
+         */
+        static std::expected<void, Error> exportConfig(Authorize authorize, ResponseWriter& writer);
+
+        /**
+         * @brief Restore the snapshot received by the POST route of registerConfigSnapshot().
+         * @param authorize Hook the request has to pass.
+         * @param body Reader for the snapshot.
+         * @return The restart needed to load the restored config, or an error if the snapshot was not restored.
+         */
+        static Result<64> importConfig(Authorize authorize, BodyReader& body);
+
+        /**
+         * @brief Fill in the pattern of a route and register it.
+         * @tparam PATH The path of the route.
+         * @param method The HTTP method of the route.
+         * @param route The route, owned by the server from now on.
+         * @param async Whether the route is handled on an AsyncWorkers task.
+         * @return An error code if the route could not be registered.
+         */
+        template<StringLiteral PATH>
+        std::error_code addRoute(const httpd_method_t method, std::unique_ptr<Route> route, const bool async = false) {
+            using Pattern     = RoutePattern<PATH>;
+            route->pattern    = Pattern::path;
+            route->handlerUri = Pattern::handlerUri.data();
+            route->method     = method;
+            route->match      = Pattern::N_CAPTURES > 0 ? Pattern::match : nullptr;
+            route->async      = async;
+            return registerRoute(std::move(route));
+        }
+
+        /**
+         * @brief Register a route with httpd, or chain it behind the route that already has its handler URI.
+         * @param route The route, owned by the server from now on.
+         * @return An error code if the route could not be registered.
+         */
+        std::error_code registerRoute(std::unique_ptr<Route> route);
+
         /**
          * @brief Wrapper around GET request callbacks that get registered.
          * @tparam N_HEADERS The number of headers to send with the response.
          * @tparam N_PARAMETERS The number of parameters that the callback expects.
          * @tparam SIZE_RETURN The size of the returned string.
          * @param req Pointer to the request object that was made.
+         * @param data The route that matched.
+         * @param path The segments captured by the route.
          * @return ESP_OK Whether the request was handled successfully.
          */
         template<std::size_t N_HEADERS, std::size_t N_PARAMETERS, std::size_t SIZE_RETURN>
-        static esp_err_t getHandler(httpd_req_t* req) {
+        static esp_err_t getHandler(httpd_req_t* req, GetData<N_HEADERS, N_PARAMETERS, SIZE_RETURN>& data, const PathParameters& path) {
+            RouteMetrics::Recorder metrics(data.metrics);
 
-            assert(req->user_ctx != nullptr && "User context is null");
-            auto* data = static_cast<GetData<N_HEADERS, N_PARAMETERS, SIZE_RETURN>*>(req->user_ctx);
-
-            for (const auto& header: data->headers) {
+            for (const auto& header: data.headers) {
                 auto err = httpd_resp_set_hdr(req, header.first.c_str(), header.second.c_str());
                 assert(err == ESP_OK && "Error setting headers");
             }
 
-            auto parameters = getQueryParameters(req, data->parameters);
+            // httpd keeps a pointer to header values, so the ETag has to live until the response is sent
+            ETag etag;
+            if (data.cache && data.cache->version) {
+                etag = makeETag('v', data.cache->version(data.userContext));
+                if (setCacheHeaders(req, *data.cache, etag)) {
+                    return sendNotModified(req, metrics);
+                }
+            }
+
+            auto arena = RequestArena::acquire();
+            if (!arena) {
+                return sendUnavailable(req, metrics);
+            }
 
-            auto ret = data->callback(req->uri, parameters, data->userContext);
+            metrics.restart();
+            auto parameters = getQueryParameters(req, data.parameters, path);
+
+            auto& ret = arena->emplace<Result<SIZE_RETURN>>([&] { return data.callback(req->uri, parameters, data.userContext); });
+            metrics.finish(RouteMetrics::Stage::CALLBACK);
             if (!ret.has_value()) {
-                ESP_LOGD(TAG, "Callback for %s returned an error: %s", req->uri, ret.error().statusMessage());
-                httpd_resp_send_custom_err(req, ret.error().statusMessage(), ret.error().message.c_str());
-                return ESP_FAIL;
+                return sendCallbackError(req, ret.error(), metrics);
             }
 
-            httpd_resp_send(req, ret.value().c_str(), ret.value().length());
-            return ESP_OK;
+            if (data.cache && !data.cache->version) {
+                const auto& body = ret.value();
+                etag             = makeETag('h', esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(body.data()), body.size()));
+                if (setCacheHeaders(req, *data.cache, etag)) {
+                    return sendNotModified(req, metrics);
+                }
+            }
+
+            return sendResponse(req, ret.value(), metrics);
+        }
+
+        /**
+         * @brief Create a strong ETag.
+         * @param type Distinguishes version based from checksum based tags.
+         * @param value Version or checksum of the response.
+         * @return The quoted ETag.
+         */
+        static ETag makeETag(char type, uint32_t value) {
+            char buffer[ETag::MAX_SIZE + 1];
+            snprintf(buffer, sizeof(buffer), "\"%c%08" PRIx32 "\"", type, value);
+            return buffer;
+        }
+
+        /**
+         * @brief Set the ETag and Cache-Control headers, and check whether the client already has this response.
+         * @param req Pointer to the request object that was made.
+         * @param cache Cache policy of the route.
+         * @param etag ETag of the response, must outlive the response.
+         * @return True if If-None-Match matches the ETag.
+         */
+        static bool setCacheHeaders(httpd_req_t* req, const CachePolicy& cache, const ETag& etag) {
+            httpd_resp_set_hdr(req, "ETag", etag.c_str());
+            if (!cache.cacheControl.empty()) {
+                httpd_resp_set_hdr(req, "Cache-Control", cache.cacheControl.c_str());
+            }
+            return etagMatches(req, etag.c_str());
+        }
+
+        /**
+         * @brief Check whether the client already has the response with the given ETag.
+         * @param req Pointer to the request object that was made.
+         * @param etag Quoted ETag of the response.
+         * @return True if If-None-Match matches the ETag.
+         */
+        static bool etagMatches(httpd_req_t* req, const char* etag) {
+            etl::string<128> ifNoneMatch;
+            const size_t     length = httpd_req_get_hdr_value_len(req, "If-None-Match");
+            if (length == 0) {
+                return false;
+            }
+            if (length > ifNoneMatch.max_size()) {
+                // Too many tags to check, sending the full response is always correct
+                return false;
+            }
+            ifNoneMatch.uninitialized_resize(length);
+            if (httpd_req_get_hdr_value_str(req, "If-None-Match", ifNoneMatch.data(), length + 1) != ESP_OK) {
+                return false;
+            }
+            // A list of tags, possibly weak. Tags are quoted, so a plain search can't match part of another tag
+            return ifNoneMatch == "*" || ifNoneMatch.find(etag) != etl::string<128>::npos;
+        }
+
+        /**
+         * @brief Answer a conditional request whose ETag matched.
+         * @param req Pointer to the request object that was made.
+         * @param metrics Metrics of the request.
+         * @return ESP_OK if the response was sent.
+         */
+        static esp_err_t sendNotModified(httpd_req_t* req, RouteMetrics::Recorder& metrics) {
+            ESP_LOGD(TAG, "Not modified: %s", req->uri);
+            metrics.setStatus(static_cast<uint16_t>(StatusCode::NotModified));
+            httpd_resp_set_status(req, statusCodePhrase(StatusCode::NotModified));
+            return httpd_resp_send(req, nullptr, 0);
+        }
+
+        /**
+         * @brief Answer a request that can't be handled right now, as all request arenas or async workers are in use.
+         * @param req Pointer to the request object that was made.
+         * @param metrics Metrics of the request.
+         * @return ESP_OK if the response was sent.
+         */
+        static esp_err_t sendUnavailable(httpd_req_t* req, RouteMetrics::Recorder& metrics) {
+            ESP_LOGW(TAG, "Too busy for %s", req->uri);
+            metrics.setStatus(static_cast<uint16_t>(StatusCode::ServiceUnavailable));
+            httpd_resp_set_status(req, statusCodePhrase(StatusCode::ServiceUnavailable));
+            httpd_resp_set_hdr(req, "Retry-After", "1");
+            return httpd_resp_send(req, nullptr, 0);
         }
 
         /**
@@ -257,130 +780,266 @@ namespace sdk::Http {
          * @tparam SIZE_RETURN The size of the returned string.
          * @tparam SIZE_BODY The size of the buffer for the request body.
          * @param req Pointer to the request object that was made.
+         * @param data The route that matched.
+         * @param path The segments captured by the route.
          * @return ESP_OK Whether the request was handled successfully.
          */
         template<std::size_t N_HEADERS, std::size_t N_PARAMETERS, std::size_t SIZE_RETURN, std::size_t SIZE_BODY>
-        static esp_err_t postHandler(httpd_req_t* req) {
+        static esp_err_t postHandler(httpd_req_t* req, PostData<N_HEADERS, N_PARAMETERS, SIZE_RETURN, SIZE_BODY>& data, const PathParameters& path) {
+            RouteMetrics::Recorder metrics(data.metrics);
 
-            assert(req->user_ctx != nullptr && "User context is null");
-            auto* data = static_cast<PostData<N_HEADERS, N_PARAMETERS, SIZE_RETURN, SIZE_BODY>*>(req->user_ctx);
+            auto arena = RequestArena::acquire();
+            if (!arena) {
+                return sendUnavailable(req, metrics);
+            }
 
-            auto body = receiveBody<SIZE_BODY>(req);
-            if (!body) {
-                if (body.error() == ESP_ERR_NO_MEM) {
-                    httpd_resp_send_custom_err(req, statusCodePhrase(StatusCode::PayloadTooLarge), statusCodePhrase(StatusCode::PayloadTooLarge));
-                } else if (body.error() == HTTPD_SOCK_ERR_TIMEOUT) {
-                    httpd_resp_send_408(req);
-                }
-                return body.error();
+            metrics.restart();
+            auto& body = arena->make<etl::string<SIZE_BODY>>();
+            if (const auto err = receiveBody(req, body); err != ESP_OK) {
+                return sendReceiveError(req, err, metrics);
             }
+            metrics.finish(RouteMetrics::Stage::RECEIVE);
+            metrics.setBytesIn(body.size());
 
-            for (const auto& header: data->headers) {
+            for (const auto& header: data.headers) {
                 auto err = httpd_resp_set_hdr(req, header.first.c_str(), header.second.c_str());
                 assert(err == ESP_OK && "Error setting headers");
             }
 
-            auto parameters = getQueryParameters(req, data->parameters);
+            auto parameters = getQueryParameters(req, data.parameters, path);
 
-            auto ret = data->callback(req->uri, body.value(), parameters, data->userContext);
+            auto& ret = arena->emplace<Result<SIZE_RETURN>>([&] { return data.callback(req->uri, body, parameters, data.userContext); });
+            metrics.finish(RouteMetrics::Stage::CALLBACK);
             if (!ret.has_value()) {
-                ESP_LOGD(TAG, "Callback for %s returned an error: %s", req->uri, ret.error().statusMessage());
-                httpd_resp_send_custom_err(req, ret.error().statusMessage(), ret.error().message.c_str());
-                return ESP_FAIL;
+                return sendCallbackError(req, ret.error(), metrics);
             }
 
-            httpd_resp_send(req, ret.value().c_str(), ret.value().length());
-            return ESP_OK;
+            return sendResponse(req, ret.value(), metrics);
         }
 
         /**
-         * @brief Get the query parameters from the request uri. Also decodes the parameters
-         * @tparam N_PARAMETERS The number of parameters to get.
+         * @brief Wrapper around streaming GET request callbacks that get registered.
+         * @tparam N_HEADERS The number of headers to send with the response.
+         * @tparam N_PARAMETERS The number of parameters that the callback expects.
          * @param req Pointer to the request object that was made.
-         * @param keys The keys to get the parameters for.
-         * @return A map of the found query parameters. If a key is not found, it will not be in the map.
+         * @param data The route that matched.
+         * @param path The segments captured by the route.
+         * @return ESP_OK Whether the request was handled successfully.
          */
-        template<std::size_t N_PARAMETERS>
-        static etl::unordered_map<QueryKey, QueryValue, N_PARAMETERS> getQueryParameters(httpd_req_t* req, const std::array<QueryKey, N_PARAMETERS>& keys) {
-            etl::string<QueryKey::MAX_SIZE + QueryValue::MAX_SIZE> query;
-            auto                                           err = httpd_req_get_url_query_str(req, query.data(), query.max_size());
-            assert((err == ESP_OK || err == ESP_ERR_NOT_FOUND) && "Error getting URL query string");
-            // If there are no query parameters, return an empty map
-            if (err == ESP_ERR_NOT_FOUND) {
-                return {};
-            }
-
-            etl::unordered_map<QueryKey, QueryValue, N_PARAMETERS> parameters;
-            for (const auto& key: keys) {
-                char buf[QueryValue::MAX_SIZE];
-                err = httpd_query_key_value(query.c_str(), key.c_str(), buf, sizeof(buf));
-                assert((err == ESP_OK || err == ESP_ERR_NOT_FOUND) && "Error getting query key value");
-                // If the key is not found, continue to the next key
-                if (err == ESP_ERR_NOT_FOUND) {
-                    continue;
-                }
-                parameters[key] = buf;
+        template<std::size_t N_HEADERS, std::size_t N_PARAMETERS>
+        static esp_err_t streamingGetHandler(httpd_req_t* req, StreamingGetData<N_HEADERS, N_PARAMETERS>& data, const PathParameters& path) {
+            RouteMetrics::Recorder metrics(data.metrics);
+
+            for (const auto& header: data.headers) {
+                auto err = httpd_resp_set_hdr(req, header.first.c_str(), header.second.c_str());
+                assert(err == ESP_OK && "Error setting headers");
             }
-            return parameters;
+
+            auto arena = RequestArena::acquire();
+            if (!arena) {
+                return sendUnavailable(req, metrics);
+            }
+
+            auto parameters = getQueryParameters(req, data.parameters, path);
+
+            metrics.restart();
+            auto& writer = arena->make<ResponseWriter>(req);
+            return finishStream(req, writer, data.callback(req->uri, parameters, writer, data.userContext), metrics);
         }
 
         /**
-         * @brief Decode a URL encoded string.
-         * @tparam N The size of the string to decode.
-         * @param url The URL to decode.
-         */
-        template<std::size_t N>
-        static void urlDecode(etl::string<N>& url) {
-            // Replace '+' with ' '
-            etl::replace(url.begin(), url.end(), '+', ' ');
-            auto pos = url.find('%');
-            while (pos != etl::string<N>::npos) {
-                if (pos + 2 < url.length()) {
-                    int value{};
-                    // Convert hex string to int
-                    auto [ptr, ec] = std::from_chars(url.data() + pos + 1, url.data() + pos + 3, value, 16);
-                    assert(ec == std::errc() && "Illegal characters in URL");
-                    // Replace '%<hex string>' with decoded character
-                    url.replace(pos, 3, 1, static_cast<char>(value));
-                }
-                // Find next '%', starting after the previous '%'
-                pos = url.find('%', pos + 1);
+         * @brief Wrapper around streaming POST request callbacks that get registered.
+         * @tparam N_HEADERS The number of headers to send with the response.
+         * @tparam N_PARAMETERS The number of parameters that the callback expects.
+         * @tparam SIZE_BODY The size of the buffer for the request body.
+         * @param req Pointer to the request object that was made.
+         * @param data The route that matched.
+         * @param path The segments captured by the route.
+         * @return ESP_OK Whether the request was handled successfully.
+         */
+        template<std::size_t N_HEADERS, std::size_t N_PARAMETERS, std::size_t SIZE_BODY>
+        static esp_err_t streamingPostHandler(httpd_req_t* req, StreamingPostData<N_HEADERS, N_PARAMETERS, SIZE_BODY>& data, const PathParameters& path) {
+            RouteMetrics::Recorder metrics(data.metrics);
+
+            auto arena = RequestArena::acquire();
+            if (!arena) {
+                return sendUnavailable(req, metrics);
+            }
+
+            metrics.restart();
+            auto& body = arena->make<etl::string<SIZE_BODY>>();
+            if (const auto err = receiveBody(req, body); err != ESP_OK) {
+                return sendReceiveError(req, err, metrics);
             }
+            metrics.finish(RouteMetrics::Stage::RECEIVE);
+            metrics.setBytesIn(body.size());
+
+            for (const auto& header: data.headers) {
+                auto err = httpd_resp_set_hdr(req, header.first.c_str(), header.second.c_str());
+                assert(err == ESP_OK && "Error setting headers");
+            }
+
+            auto parameters = getQueryParameters(req, data.parameters, path);
+
+            auto& writer = arena->make<ResponseWriter>(req);
+            return finishStream(req, writer, data.callback(req->uri, body, parameters, writer, data.userContext), metrics);
         }
 
         /**
-         * @brief Receive the body of a request. It will retry receiving the body if a timeout occurs.
-         * @tparam N The size of the buffer to receive the body in.
+         * @brief Wrapper around upload request callbacks that get registered.
+         * @tparam N_HEADERS The number of headers to send with the response.
+         * @tparam N_PARAMETERS The number of parameters that the callback expects.
+         * @tparam SIZE_RETURN The size of the returned string.
          * @param req Pointer to the request object that was made.
-         * @return The received body, or an error code if the body could not be received.
+         * @param data The route that matched.
+         * @param path The segments captured by the route.
+         * @return ESP_OK Whether the request was handled successfully.
          */
-        template<std::size_t N>
-        static std::expected<etl::string<N>, esp_err_t> receiveBody(httpd_req_t* req) {
-            ESP_LOGD(TAG, "Receiving body for %s, of length %d", req->uri, req->content_len);
-            // Check if the body is too large for the buffer
-            if (N <= req->content_len) {
-                ESP_LOGE(TAG, "The received body is too large for the buffer: %d > %d", req->content_len, N);
-                return std::unexpected(ESP_ERR_NO_MEM);
+        template<std::size_t N_HEADERS, std::size_t N_PARAMETERS, std::size_t SIZE_RETURN>
+        static esp_err_t uploadHandler(httpd_req_t* req, UploadData<N_HEADERS, N_PARAMETERS, SIZE_RETURN>& data, const PathParameters& path) {
+            RouteMetrics::Recorder metrics(data.metrics);
+
+            for (const auto& header: data.headers) {
+                auto err = httpd_resp_set_hdr(req, header.first.c_str(), header.second.c_str());
+                assert(err == ESP_OK && "Error setting headers");
+            }
+
+            auto arena = RequestArena::acquire();
+            if (!arena) {
+                return sendUnavailable(req, metrics);
             }
 
-            std::array<char, N> body;
+            auto parameters = getQueryParameters(req, data.parameters, path);
 
-            for(int i = 0; i < CONFIG_RETRIEVE_BODY_TIMEOUT_RETRY_COUNT; i++) {
-                auto retrieved = httpd_req_recv(req, body.data(), std::min(req->content_len, body.size()));
-                if (retrieved > 0) {
-                    if (retrieved < N) {
-                        // Zero terminate the buffer
-                        body[retrieved] = '\0';
-                    }
-                    return body.data();
-                }
-                // If there was a timeout while receiving the body, retry
-                if (retrieved == HTTPD_SOCK_ERR_TIMEOUT) {
-                    continue;
-                }
-                return std::unexpected(retrieved);
+            metrics.restart();
+            auto& body = arena->make<BodyReader>(req);
+            auto& ret  = arena->emplace<Result<SIZE_RETURN>>([&] { return data.callback(req->uri, body, parameters, data.userContext); });
+            metrics.setBytesIn(body.contentLength() - body.remaining());
+            if (body.error() != ESP_OK) {
+                return sendReceiveError(req, body.error(), metrics);
+            }
+            metrics.finish(RouteMetrics::Stage::CALLBACK);
+            if (!ret.has_value()) {
+                return sendCallbackError(req, ret.error(), metrics);
             }
-            return std::unexpected(HTTPD_SOCK_ERR_TIMEOUT);
+
+            return sendResponse(req, ret.value(), metrics);
+        }
+
+        /**
+         * @brief End a streamed response, reporting the callback's error if the response has not started yet.
+         * @param req Pointer to the request object that was made.
+         * @param writer Writer the callback used.
+         * @param result What the callback returned.
+         * @param metrics Metrics of the request.
+         * @return ESP_OK if the response was completed, ESP_FAIL closes the connection.
+         */
+        static esp_err_t finishStream(httpd_req_t* req, ResponseWriter& writer, const std::expected<void, Error>& result, RouteMetrics::Recorder& metrics) {
+            // The callback sends full chunks as it goes, the send stage is only what is left after it returns
+            metrics.finish(RouteMetrics::Stage::CALLBACK);
+            if (result.has_value()) {
+                const auto err = writer.finish();
+                metrics.finish(RouteMetrics::Stage::SEND);
+                metrics.setBytesOut(writer.bytesSent());
+                return err == ESP_OK ? ESP_OK : ESP_FAIL;
+            }
+            ESP_LOGD(TAG, "Callback for %s returned an error: %s", req->uri, result.error().statusMessage());
+            if (writer.started()) {
+                // The status line is already out, closing the connection is the only way left to signal the failure
+                ESP_LOGW(TAG, "Aborting response for %s after %zu bytes", req->uri, writer.bytesSent());
+                metrics.setBytesOut(writer.bytesSent());
+                return ESP_FAIL;
+            }
+            writer.discard();
+            return sendCallbackError(req, result.error(), metrics);
+        }
+
+        /**
+         * @brief Send the response a callback returned.
+         * @param req Pointer to the request object that was made.
+         * @param body The response body.
+         * @param metrics Metrics of the request.
+         * @return ESP_OK Whether the response was sent.
+         */
+        static esp_err_t sendResponse(httpd_req_t* req, const etl::istring& body, RouteMetrics::Recorder& metrics) {
+            const auto err = httpd_resp_send(req, body.c_str(), static_cast<ssize_t>(body.length()));
+            metrics.finish(RouteMetrics::Stage::SEND);
+            metrics.setBytesOut(body.length());
+            return err;
+        }
+
+        /**
+         * @brief Send the error a callback returned.
+         * @param req Pointer to the request object that was made.
+         * @param error The error of the callback.
+         * @param metrics Metrics of the request.
+         * @return ESP_FAIL, so httpd closes the connection.
+         */
+        static esp_err_t sendCallbackError(httpd_req_t* req, const Error& error, RouteMetrics::Recorder& metrics) {
+            ESP_LOGD(TAG, "Callback for %s returned an error: %s", req->uri, error.statusMessage());
+            httpd_resp_send_custom_err(req, error.statusMessage(), error.message.c_str());
+            metrics.setStatus(static_cast<uint16_t>(error.code));
+            return ESP_FAIL;
+        }
+
+        /**
+         * @brief Answer a request whose body could not be received.
+         * @param req Pointer to the request object that was made.
+         * @param err Why the body could not be received.
+         * @param metrics Metrics of the request.
+         * @return The error, so httpd closes the connection.
+         */
+        static esp_err_t sendReceiveError(httpd_req_t* req, const esp_err_t err, RouteMetrics::Recorder& metrics) {
+            if (err == ESP_ERR_NO_MEM) {
+                httpd_resp_send_custom_err(req, statusCodePhrase(StatusCode::PayloadTooLarge), statusCodePhrase(StatusCode::PayloadTooLarge));
+                metrics.setStatus(static_cast<uint16_t>(StatusCode::PayloadTooLarge));
+            } else if (err == HTTPD_SOCK_ERR_TIMEOUT) {
+                httpd_resp_send_408(req);
+                metrics.setStatus(static_cast<uint16_t>(StatusCode::RequestTimeout));
+            } else {
+                // The connection is broken, there is nobody to respond to
+                metrics.setStatus(0);
+            }
+            return err;
+        }
+
+        /**
+         * @brief Get the query parameters from the request uri, without copying or decoding them.
+         * @tparam N_PARAMETERS The number of parameters to get.
+         * @param req Pointer to the request object that was made.
+         * @param keys The keys to get the parameters for, must outlive the request.
+         * @param path The segments captured by the route.
+         * @return The found query parameters, slices of the request uri.
+         */
+        template<std::size_t N_PARAMETERS>
+        static QueryParameters<N_PARAMETERS> getQueryParameters(httpd_req_t* req, const std::array<QueryKey, N_PARAMETERS>& keys, const PathParameters& path) {
+            std::string_view uri(req->uri);
+            const auto       start = uri.find('?');
+            // Without query parameters the query is empty
+            uri = start == std::string_view::npos ? std::string_view{} : uri.substr(start + 1);
+            return QueryParameters<N_PARAMETERS>(uri.substr(0, uri.find('#')), keys, path);
+        }
+
+        /**
+         * @brief Receive the complete body of a request, which may arrive in several parts.
+         * @param req Pointer to the request object that was made.
+         * @param body The string to receive the body in, it is received straight into it.
+         * @return ESP_ERR_NO_MEM if the body does not fit, or the error of the socket.
+         */
+        static esp_err_t receiveBody(httpd_req_t* req, etl::istring& body) {
+            ESP_LOGD(TAG, "Receiving body for %s, of length %zu", req->uri, req->content_len);
+            // Check if the body is too large for the buffer
+            if (body.max_size() < req->content_len) {
+                ESP_LOGE(TAG, "The received body is too large for the buffer: %zu > %zu", req->content_len, body.max_size());
+                return ESP_ERR_NO_MEM;
+            }
+
+            body.uninitialized_resize(req->content_len);
+            BodyReader reader(req);
+            if (auto received = reader.read({body.data(), body.size()}); !received) {
+                return received.error();
+            }
+            return ESP_OK;
         }
     };
 
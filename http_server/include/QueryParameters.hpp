@@ -0,0 +1,283 @@
+#ifndef HTTP_QUERY_PARAMETERS_HPP
+#define HTTP_QUERY_PARAMETERS_HPP
+
+#include <esp_err.h>
+#include <etl/string.h>
+#include <etl/vector.h>
+
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <expected>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace sdk::Http {
+
+    using QueryKey   = etl::string<20>;
+    using QueryValue = etl::string<50>;
+
+    namespace detail {
+        /**
+         * @brief Walk a URL encoded string and hand each decoded character to output.
+         * @return Length of the decoded string.
+         */
+        template<typename Output>
+        size_t urlDecode(std::string_view encoded, const bool plusIsSpace, Output&& output) {
+            size_t length = 0;
+            for (size_t i = 0; i < encoded.size(); i++) {
+                if (plusIsSpace && encoded[i] == '+') {
+                    output(length++, ' ');
+                    continue;
+                }
+                if (encoded[i] == '%' && i + 2 < encoded.size() && std::isxdigit(static_cast<unsigned char>(encoded[i + 1])) &&
+                    std::isxdigit(static_cast<unsigned char>(encoded[i + 2]))) {
+                    unsigned int value{};
+                    // Convert hex string to int
+                    auto [ptr, ec] = std::from_chars(encoded.data() + i + 1, encoded.data() + i + 3, value, 16);
+                    if (ec == std::errc()) {
+                        output(length++, static_cast<char>(value));
+                        i += 2;
+                        continue;
+                    }
+                }
+                output(length++, encoded[i]);
+            }
+            return length;
+        }
+    } // namespace detail
+
+    /**
+     * @brief Decode a URL encoded string, '+' becomes a space and '%XX' the encoded character.
+     *
+     *        Decoding never makes a string longer, so output may be the same as encoded.data() to decode in place.
+     *        Malformed escapes are kept as they are.
+     * @param encoded The string to decode.
+     * @param output Place to store the decoded string, at least urlDecodedLength(encoded) bytes.
+     * @param plusIsSpace Whether '+' is a space, as in a query. In a path it is a '+'.
+     * @return Length of the decoded string.
+     */
+    inline size_t urlDecode(std::string_view encoded, char* output, const bool plusIsSpace = true) {
+        return detail::urlDecode(encoded, plusIsSpace, [output](const size_t index, const char character) { output[index] = character; });
+    }
+
+    /**
+     * @brief Get the length a URL encoded string has once decoded, without decoding it.
+     */
+    inline size_t urlDecodedLength(std::string_view encoded) {
+        return detail::urlDecode(encoded, false, [](size_t, char) {});
+    }
+
+    /**
+     * @brief Decode a URL encoded string into a string of its own.
+     * @tparam N The size of the string to decode into.
+     * @param encoded The string to decode.
+     * @return The decoded string, ESP_ERR_INVALID_SIZE if the decoded string is longer than N.
+     */
+    template<std::size_t N>
+    std::expected<etl::string<N>, esp_err_t> urlDecode(std::string_view encoded) {
+        const size_t length = urlDecodedLength(encoded);
+        if (length > N) {
+            return std::unexpected(ESP_ERR_INVALID_SIZE);
+        }
+        std::expected<etl::string<N>, esp_err_t> decoded;
+        decoded->uninitialized_resize(length);
+        urlDecode(encoded, decoded->data());
+        return decoded;
+    }
+
+    /**
+     * @brief Values captured by the {name} segments of a route, slices of the request URI.
+     */
+    class PathParameters {
+    public:
+        /**
+         * @brief Add a captured value, done while matching the route.
+         * @return False if there are more than CONFIG_HTTP_MAX_PATH_PARAMETERS captures.
+         */
+        bool add(std::string_view name, std::string_view value) {
+            if (m_values.full()) {
+                return false;
+            }
+            m_values.emplace_back(name, value);
+            return true;
+        }
+
+        void clear() {
+            m_values.clear();
+        }
+
+        /**
+         * @brief Get a captured segment as it was sent, still URL encoded.
+         * @param name Name of the segment in the route, without braces.
+         * @return The encoded value, nullopt if the route has no such segment.
+         */
+        [[nodiscard]] std::optional<std::string_view> raw(std::string_view name) const {
+            for (const auto& [key, value]: m_values) {
+                if (key == name) {
+                    return value;
+                }
+            }
+            return std::nullopt;
+        }
+
+        /**
+         * @brief Get a decoded segment.
+         * @tparam N The size of the string to decode into.
+         * @param name Name of the segment in the route, without braces.
+         * @return The decoded value, ESP_ERR_NOT_FOUND if the route has no such segment, ESP_ERR_INVALID_SIZE if it does not fit.
+         */
+        template<std::size_t N = QueryValue::MAX_SIZE>
+        [[nodiscard]] std::expected<etl::string<N>, esp_err_t> value(std::string_view name) const {
+            const auto encoded = raw(name);
+            if (!encoded) {
+                return std::unexpected(ESP_ERR_NOT_FOUND);
+            }
+            return urlDecode<N>(*encoded);
+        }
+
+        /**
+         * @brief Get a segment as a number, such as the id in /items/{id}.
+         * @tparam T An integral type.
+         * @param name Name of the segment in the route, without braces.
+         * @return The number, ESP_ERR_NOT_FOUND if the route has no such segment, ESP_ERR_INVALID_ARG if it is not a number.
+         */
+        template<typename T>
+            requires std::is_integral_v<T>
+        [[nodiscard]] std::expected<T, esp_err_t> as(std::string_view name) const {
+            const auto encoded = raw(name);
+            if (!encoded) {
+                return std::unexpected(ESP_ERR_NOT_FOUND);
+            }
+            T number{};
+            const auto [ptr, ec] = std::from_chars(encoded->data(), encoded->data() + encoded->size(), number);
+            if (ec != std::errc() || ptr != encoded->data() + encoded->size()) {
+                return std::unexpected(ESP_ERR_INVALID_ARG);
+            }
+            return number;
+        }
+
+        [[nodiscard]] std::size_t size() const {
+            return m_values.size();
+        }
+
+        [[nodiscard]] bool empty() const {
+            return m_values.empty();
+        }
+
+    private:
+        etl::vector<std::pair<std::string_view, std::string_view>, CONFIG_HTTP_MAX_PATH_PARAMETERS> m_values;
+    };
+
+    /**
+     * @brief Query parameters of a request, parsed in a single pass without copying.
+     *
+     *        Values are slices of the request URI, only valid while the request is handled. They are decoded when
+     *        asked for with value(), raw() gives the value as it was sent. Only the keys given on registration are
+     *        kept, when a key appears more than once the first value counts. The segments captured by the route
+     *        are available with path().
+     * @tparam N_PARAMETERS The number of parameter keys that are looked for.
+     */
+    template<std::size_t N_PARAMETERS>
+    class QueryParameters {
+    public:
+        QueryParameters() = default;
+
+        /**
+         * @brief Parse a query string.
+         * @param query The query, without the leading '?'.
+         * @param keys The keys to look for, must outlive this object.
+         * @param path The segments captured by the route.
+         */
+        QueryParameters(std::string_view query, const std::array<QueryKey, N_PARAMETERS>& keys, const PathParameters& path = {}) : m_keys(&keys), m_path(path) {
+            while (!query.empty()) {
+                const auto end  = query.find('&');
+                const auto pair = query.substr(0, end);
+                query           = end == std::string_view::npos ? std::string_view{} : query.substr(end + 1);
+
+                const auto separator = pair.find('=');
+                const auto key       = pair.substr(0, separator);
+                // A key without '=' has an empty value, which is still present
+                const auto value = separator == std::string_view::npos ? pair.substr(pair.size()) : pair.substr(separator + 1);
+
+                for (std::size_t i = 0; i < N_PARAMETERS; i++) {
+                    if (!m_found[i] && key == std::string_view(keys[i].data(), keys[i].size())) {
+                        m_values[i] = value;
+                        m_found[i]  = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Whether the parameter was in the query.
+         */
+        [[nodiscard]] bool contains(std::string_view key) const {
+            return raw(key).has_value();
+        }
+
+        /**
+         * @brief Get a parameter as it was sent, still URL encoded.
+         * @param key The parameter key.
+         * @return The encoded value, nullopt if not in the query.
+         */
+        [[nodiscard]] std::optional<std::string_view> raw(std::string_view key) const {
+            if (m_keys == nullptr) {
+                return std::nullopt;
+            }
+            for (std::size_t i = 0; i < N_PARAMETERS; i++) {
+                if (m_found[i] && key == std::string_view((*m_keys)[i].data(), (*m_keys)[i].size())) {
+                    return m_values[i];
+                }
+            }
+            return std::nullopt;
+        }
+
+        /**
+         * @brief Get a decoded parameter.
+         * @tparam N The size of the string to decode into.
+         * @param key The parameter key.
+         * @return The decoded value, ESP_ERR_NOT_FOUND if not in the query, ESP_ERR_INVALID_SIZE if it does not fit.
+         */
+        template<std::size_t N = QueryValue::MAX_SIZE>
+        [[nodiscard]] std::expected<etl::string<N>, esp_err_t> value(std::string_view key) const {
+            const auto encoded = raw(key);
+            if (!encoded) {
+                return std::unexpected(ESP_ERR_NOT_FOUND);
+            }
+            return urlDecode<N>(*encoded);
+        }
+
+        /**
+         * @brief Get the amount of parameters found.
+         */
+        [[nodiscard]] std::size_t size() const {
+            std::size_t count = 0;
+            for (const bool found: m_found) { count += found; }
+            return count;
+        }
+
+        [[nodiscard]] bool empty() const {
+            return size() == 0;
+        }
+
+        /**
+         * @brief Get the segments captured by the {name} parts of the route.
+         */
+        [[nodiscard]] const PathParameters& path() const {
+            return m_path;
+        }
+
+    private:
+        const std::array<QueryKey, N_PARAMETERS>* m_keys = nullptr;
+        std::array<std::string_view, N_PARAMETERS> m_values{};
+        std::array<bool, N_PARAMETERS>             m_found{};
+        PathParameters                             m_path;
+    };
+
+} // namespace sdk::Http
+
+#endif /* HTTP_QUERY_PARAMETERS_HPP */
@@ -0,0 +1,113 @@
+#ifndef HTTP_REQUEST_ARENA_HPP
+#define HTTP_REQUEST_ARENA_HPP
+
+#include <esp_err.h>
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <expected>
+#include <new>
+#include <utility>
+
+namespace sdk::Http {
+
+    /**
+     * @brief Memory for the buffers of a single request, such as its body and response
+     *
+     *        Arenas are blocks of CONFIG_HTTP_ARENA_SIZE bytes from a pool of CONFIG_HTTP_ARENA_COUNT, set aside once.
+     *        Objects are placed one after the other and all released together when the arena goes out of scope,
+     *        so a request neither allocates nor needs room for its buffers on the httpd stack.
+     */
+    class RequestArena {
+    public:
+        static constexpr std::size_t SIZE        = CONFIG_HTTP_ARENA_SIZE;
+        static constexpr std::size_t MAX_OBJECTS = 4;
+
+        /**
+         * @brief Get the bytes an arena needs to hold one object of each of the given types.
+         */
+        template<typename... T>
+        static constexpr std::size_t required() {
+            return (0 + ... + align(sizeof(T)));
+        }
+
+        /**
+         * @brief Take an arena from the pool.
+         * @return The arena, ESP_ERR_NO_MEM if all arenas are in use.
+         */
+        static std::expected<RequestArena, esp_err_t> acquire();
+
+        /**
+         * @brief Get the number of arenas that are not in use.
+         */
+        static std::size_t available();
+
+        RequestArena(RequestArena&& other) noexcept;
+
+        RequestArena(const RequestArena&)            = delete;
+        RequestArena& operator=(const RequestArena&) = delete;
+        RequestArena& operator=(RequestArena&&)      = delete;
+
+        ~RequestArena();
+
+        /**
+         * @brief Construct an object in the arena.
+         * @tparam T Type of the object, the route must account for it with required().
+         * @param args Arguments for the constructor.
+         * @return The object, destroyed with the arena.
+         */
+        template<typename T, typename... ARGS>
+        T& make(ARGS&&... args) {
+            return track(*::new (allocate(sizeof(T))) T(std::forward<ARGS>(args)...));
+        }
+
+        /**
+         * @brief Construct an object in the arena from what a function returns, without copying it.
+         * @tparam T Type of the object, the route must account for it with required().
+         * @param factory Returns the object by value, such as a lambda that calls a route callback.
+         * @return The object, destroyed with the arena.
+         */
+        template<typename T, typename FACTORY>
+        T& emplace(FACTORY&& factory) {
+            return track(*::new (allocate(sizeof(T))) T(std::forward<FACTORY>(factory)()));
+        }
+
+        /**
+         * @brief Get the amount of bytes in use.
+         */
+        [[nodiscard]] std::size_t used() const {
+            return m_used;
+        }
+
+    private:
+        explicit RequestArena(std::byte* memory) : m_memory(memory) {}
+
+        static constexpr std::size_t align(const std::size_t size) {
+            return (size + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+        }
+
+        void* allocate(std::size_t size) {
+            // Routes check at compile time that their objects fit
+            assert(m_memory != nullptr && m_used + align(size) <= SIZE && "Request arena too small for the route");
+            void* memory = m_memory + m_used;
+            m_used += align(size);
+            return memory;
+        }
+
+        template<typename T>
+        T& track(T& object) {
+            assert(m_count < MAX_OBJECTS && "Too many objects in a request arena");
+            m_objects[m_count++] = {&object, [](void* pointer) { static_cast<T*>(pointer)->~T(); }};
+            return object;
+        }
+
+        std::byte*                                                 m_memory = nullptr;
+        std::size_t                                                m_used   = 0;
+        std::array<std::pair<void*, void (*)(void*)>, MAX_OBJECTS> m_objects{};
+        std::size_t                                                m_count = 0;
+    };
+
+} // namespace sdk::Http
+
+#endif /* HTTP_REQUEST_ARENA_HPP */
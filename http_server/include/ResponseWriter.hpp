@@ -0,0 +1,172 @@
+#ifndef HTTP_RESPONSE_WRITER_HPP
+#define HTTP_RESPONSE_WRITER_HPP
+
+#include <esp_err.h>
+#include <esp_http_server.h>
+#include <esp_log.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+namespace sdk::Http {
+
+    /**
+     * @brief Streams a response body to the client using chunked transfer encoding
+     *
+     *        Small writes are gathered in a buffer of CONFIG_HTTP_RESPONSE_CHUNK_SIZE bytes, so every chunk sent
+     *        is a reasonable size. Headers and status go out with the first chunk, set them before writing.
+     */
+    class ResponseWriter {
+    public:
+        explicit ResponseWriter(httpd_req_t* req) : m_req(req) {}
+
+        ResponseWriter(const ResponseWriter&)            = delete;
+        ResponseWriter& operator=(const ResponseWriter&) = delete;
+
+        /**
+         * @brief Append data to the response
+         * @param data Data to append
+         * @return Error code of type esp_err_t, errors are sticky
+         */
+        esp_err_t write(std::string_view data) {
+            while (m_error == ESP_OK && !data.empty()) {
+                const size_t count = std::min(data.size(), chunkSize - m_used);
+                std::memcpy(m_buffer.data() + m_used, data.data(), count);
+                m_used += count;
+                data.remove_prefix(count);
+                if (m_used == chunkSize) {
+                    flush();
+                }
+            }
+            return m_error;
+        }
+
+        /**
+         * @brief Append formatted text to the response, formatted straight into the chunk buffer
+         * @param format printf style format string
+         * @param args Arguments for the format string
+         * @return Error code of type esp_err_t, ESP_ERR_INVALID_SIZE if the result is larger than a chunk
+         */
+        template<typename... ARGS>
+        esp_err_t print(const char* format, ARGS... args) {
+            for (int attempt = 0; attempt < 2 && m_error == ESP_OK; attempt++) {
+                const size_t available = chunkSize - m_used;
+                // snprintf needs room for the terminator, which is not part of the response
+                const int length = snprintf(m_buffer.data() + m_used, available + 1, format, args...);
+                if (length < 0) {
+                    return m_error = ESP_ERR_INVALID_ARG;
+                }
+                if (static_cast<size_t>(length) <= available) {
+                    m_used += length;
+                    return ESP_OK;
+                }
+                if (m_used == 0) {
+                    ESP_LOGE(TAG, "Formatted output of %d bytes does not fit in a chunk", length);
+                    return m_error = ESP_ERR_INVALID_SIZE;
+                }
+                flush();
+            }
+            return m_error;
+        }
+
+        /**
+         * @brief Send the buffered data as a chunk now, instead of when the buffer is full
+         * @return Error code of type esp_err_t
+         */
+        esp_err_t flush() {
+            if (m_error != ESP_OK || m_used == 0) {
+                return m_error;
+            }
+            if (const auto err = httpd_resp_send_chunk(m_req, m_buffer.data(), static_cast<ssize_t>(m_used)); err != ESP_OK) {
+                ESP_LOGE(TAG, "Error sending chunk for %s: %s", m_req->uri, esp_err_to_name(err));
+                m_error = err;
+                return err;
+            }
+            m_sent += m_used;
+            m_used = 0;
+            m_started = true;
+            return ESP_OK;
+        }
+
+        /**
+         * @brief Send the remaining data and end the response
+         * @return Error code of type esp_err_t
+         */
+        esp_err_t finish() {
+            if (flush() != ESP_OK) {
+                return m_error;
+            }
+            // A zero length chunk ends a chunked response
+            if (const auto err = httpd_resp_send_chunk(m_req, nullptr, 0); err != ESP_OK) {
+                m_error = err;
+            }
+            m_started = true;
+            return m_error;
+        }
+
+        /**
+         * @brief Set the Content-Type of the response, only has effect before the first chunk is sent
+         * @param type Content type, must stay valid until the response is finished
+         * @return Error code of type esp_err_t
+         */
+        esp_err_t setContentType(const char* type) {
+            if (m_started) {
+                return ESP_ERR_INVALID_STATE;
+            }
+            return httpd_resp_set_type(m_req, type);
+        }
+
+        /**
+         * @brief Drop the data that was not sent yet
+         */
+        void discard() {
+            m_used = 0;
+        }
+
+        /**
+         * @brief The request the response belongs to, such as to check its headers
+         */
+        [[nodiscard]] httpd_req_t* request() const {
+            return m_req;
+        }
+
+        /**
+         * @brief Whether the status and headers were sent, after which an error can no longer be reported to the client
+         */
+        [[nodiscard]] bool started() const {
+            return m_started;
+        }
+
+        /**
+         * @brief Amount of body bytes sent to the client so far
+         */
+        [[nodiscard]] size_t bytesSent() const {
+            return m_sent;
+        }
+
+        /**
+         * @brief Error that stopped the response, if any
+         */
+        [[nodiscard]] esp_err_t error() const {
+            return m_error;
+        }
+
+    private:
+        static constexpr char   TAG[]     = "HTTP RESPONSE";
+        static constexpr size_t chunkSize = CONFIG_HTTP_RESPONSE_CHUNK_SIZE;
+
+        httpd_req_t* m_req;
+        // One extra byte, so print() can let snprintf terminate a full chunk
+        std::array<char, chunkSize + 1> m_buffer{};
+        size_t                          m_used{0};
+        size_t                          m_sent{0};
+        bool                            m_started{false};
+        esp_err_t                       m_error{ESP_OK};
+    };
+
+} // namespace sdk::Http
+
+#endif /* HTTP_RESPONSE_WRITER_HPP */
@@ -0,0 +1,167 @@
+#ifndef HTTP_ROUTE_METRICS_HPP
+#define HTTP_ROUTE_METRICS_HPP
+
+#include <esp_timer.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace sdk::Http {
+
+    /**
+     * @brief Request counters and latency histograms of a single route
+     *
+     *        Handlers time their stages with a Recorder, which adds everything under one lock when the request ends.
+     *        When CONFIG_HTTP_ROUTE_METRICS is disabled, recording compiles to nothing.
+     */
+    class RouteMetrics {
+    public:
+        /**
+         * @brief Upper bounds of the latency histogram buckets in microseconds, the last bucket has no bound
+         */
+        static constexpr std::array<uint32_t, 11> latencyBounds{500, 1'000, 2'500, 5'000, 10'000, 25'000, 50'000, 100'000, 250'000, 500'000, 1'000'000};
+
+        using Histogram = std::array<uint32_t, latencyBounds.size() + 1>;
+
+        /**
+         * @brief Parts of handling a request that are timed separately
+         */
+        enum class Stage {
+            /**
+             * @brief Receiving the request body
+             */
+            RECEIVE,
+            /**
+             * @brief Running the route callback
+             */
+            CALLBACK,
+            /**
+             * @brief Sending the response, for streamed responses this overlaps with the callback
+             */
+            SEND,
+        };
+
+        static constexpr std::size_t NUM_STAGES = 3;
+
+        struct Latency {
+            uint32_t  count;
+            uint64_t  totalMicroseconds;
+            Histogram buckets;
+        };
+
+        struct Counters {
+            uint32_t requests;
+            /**
+             * @brief Responses per status class, index 0 counts 1xx up to index 4 for 5xx
+             */
+            std::array<uint32_t, 5>         statusClasses;
+            uint64_t                        bytesIn;
+            uint64_t                        bytesOut;
+            std::array<Latency, NUM_STAGES> latency;
+        };
+
+        /**
+         * @brief Collects the metrics of one request, which are added to the route when it goes out of scope
+         */
+        class Recorder {
+        public:
+            explicit Recorder(RouteMetrics& metrics) : m_metrics(metrics) {}
+
+            Recorder(const Recorder&)            = delete;
+            Recorder& operator=(const Recorder&) = delete;
+
+            ~Recorder() {
+#ifdef CONFIG_HTTP_ROUTE_METRICS
+                m_metrics.add(*this);
+#endif
+            }
+
+            /**
+             * @brief Mark the end of a stage, which started where the previous one ended.
+             */
+            void finish(Stage stage) {
+#ifdef CONFIG_HTTP_ROUTE_METRICS
+                const int64_t now                            = esp_timer_get_time();
+                m_durations[static_cast<std::size_t>(stage)] = now - m_start;
+                m_start                                      = now;
+#endif
+            }
+
+            /**
+             * @brief Skip the time since the last stage, such as waiting for a request arena.
+             */
+            void restart() {
+#ifdef CONFIG_HTTP_ROUTE_METRICS
+                m_start = esp_timer_get_time();
+#endif
+            }
+
+            void setStatus(const uint16_t status) {
+                m_status = status;
+            }
+
+            void setBytesIn(const std::size_t bytes) {
+                m_bytesIn = bytes;
+            }
+
+            void setBytesOut(const std::size_t bytes) {
+                m_bytesOut = bytes;
+            }
+
+        private:
+            friend class RouteMetrics;
+
+            RouteMetrics& m_metrics;
+#ifdef CONFIG_HTTP_ROUTE_METRICS
+            int64_t                         m_start = esp_timer_get_time();
+            std::array<int64_t, NUM_STAGES> m_durations{-1, -1, -1};
+#endif
+            uint16_t    m_status   = 200;
+            std::size_t m_bytesIn  = 0;
+            std::size_t m_bytesOut = 0;
+        };
+
+        /**
+         * @brief Get a copy of the counters, so they can be exported without holding the lock.
+         */
+        [[nodiscard]] Counters read() const {
+            std::lock_guard lock(m_mutex);
+            return m_counters;
+        }
+
+    private:
+        static inline std::mutex m_mutex;
+
+        Counters m_counters{};
+
+#ifdef CONFIG_HTTP_ROUTE_METRICS
+        void add(const Recorder& recorder) {
+            std::lock_guard lock(m_mutex);
+            m_counters.requests++;
+            if (recorder.m_status >= 100 && recorder.m_status < 600) {
+                m_counters.statusClasses[recorder.m_status / 100 - 1]++;
+            }
+            m_counters.bytesIn += recorder.m_bytesIn;
+            m_counters.bytesOut += recorder.m_bytesOut;
+            for (std::size_t stage = 0; stage < NUM_STAGES; stage++) {
+                const int64_t microseconds = recorder.m_durations[stage];
+                // Stages that did not happen, such as receiving for a GET request, are not counted
+                if (microseconds < 0) {
+                    continue;
+                }
+                auto& latency = m_counters.latency[stage];
+                latency.count++;
+                latency.totalMicroseconds += microseconds;
+                std::size_t bucket = 0;
+                while (bucket < latencyBounds.size() && microseconds > latencyBounds[bucket]) { bucket++; }
+                latency.buckets[bucket]++;
+            }
+        }
+#endif
+    };
+
+} // namespace sdk::Http
+
+#endif /* HTTP_ROUTE_METRICS_HPP */
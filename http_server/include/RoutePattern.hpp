@@ -0,0 +1,115 @@
+#ifndef HTTP_ROUTE_PATTERN_HPP
+#define HTTP_ROUTE_PATTERN_HPP
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+
+#include "ConfigProvider.hpp"
+#include "QueryParameters.hpp"
+
+namespace sdk::Http {
+
+    /**
+     * @brief A route path, parsed at compile time. Segments written as {name} match any single path segment,
+     *        which is captured under that name, such as /api/items/{id}/name.
+     *
+     *        httpd finds the route by the literal prefix up to the first capture, registered with a trailing
+     *        wildcard. The rest of the path is then checked against the pattern in a single pass. Patterns with
+     *        captures need a wildcard uri_match_fn in the server config. httpd tries handlers in the order they were
+     *        registered, so register them before a catch-all such as registerStaticAssets().
+     * @tparam PATH The route path.
+     */
+    template<StringLiteral PATH>
+    class RoutePattern {
+    public:
+        static constexpr std::string_view path{PATH.value, sizeof(PATH.value) - 1};
+
+        /**
+         * @brief Find a character, string_view::find is not usable on template arguments at compile time on all compilers.
+         */
+        static constexpr std::size_t find(std::string_view text, const char character, std::size_t position = 0) {
+            for (; position < text.size(); position++) {
+                if (text[position] == character) {
+                    return position;
+                }
+            }
+            return std::string_view::npos;
+        }
+
+        /**
+         * @brief Count the captures in a path, or return -1 if a capture is not a complete, named segment.
+         */
+        static constexpr int countCaptures(std::string_view pattern) {
+            int captures = 0;
+            for (std::size_t i = 0; i < pattern.size(); i++) {
+                if (pattern[i] == '}') {
+                    return -1;
+                }
+                if (pattern[i] != '{') {
+                    continue;
+                }
+                const auto close = find(pattern, '}', i);
+                if (i == 0 || pattern[i - 1] != '/' || close == std::string_view::npos || close == i + 1 ||
+                    (close + 1 < pattern.size() && pattern[close + 1] != '/') ||
+                    find(pattern.substr(i + 1, close - i - 1), '{') != std::string_view::npos ||
+                    find(pattern.substr(i + 1, close - i - 1), '/') != std::string_view::npos) {
+                    return -1;
+                }
+                captures++;
+                i = close;
+            }
+            return captures;
+        }
+
+        static_assert(path.starts_with('/'), "A route path starts with '/'");
+        static_assert(countCaptures(path) >= 0, "A capture must be a complete path segment, such as /{name}/");
+        static_assert(countCaptures(path) <= CONFIG_HTTP_MAX_PATH_PARAMETERS, "Too many captures, see HTTP_MAX_PATH_PARAMETERS");
+
+        static constexpr std::size_t N_CAPTURES = countCaptures(path);
+
+        /**
+         * @brief The URI to register with httpd, the path itself or its literal prefix with a wildcard.
+         */
+        static constexpr auto handlerUri = [] {
+            std::array<char, path.size() + 2> uri{};
+            const auto                        prefix = path.substr(0, find(path, '{'));
+            std::copy(prefix.begin(), prefix.end(), uri.begin());
+            if (N_CAPTURES > 0) {
+                uri[prefix.size()] = '*';
+            }
+            return uri;
+        }();
+
+        /**
+         * @brief Match a request path against the pattern.
+         * @param requestPath The path of the request, without query.
+         * @param captures Receives the captured segments.
+         * @return True if the path matches.
+         */
+        static bool match(std::string_view requestPath, PathParameters& captures) {
+            std::size_t position = 0;
+            for (std::size_t i = 0; i < path.size(); i++) {
+                if (path[i] != '{') {
+                    if (position >= requestPath.size() || requestPath[position] != path[i]) {
+                        return false;
+                    }
+                    position++;
+                    continue;
+                }
+                const auto close = find(path, '}', i);
+                const auto value = requestPath.substr(position, requestPath.find('/', position) - position);
+                if (value.empty()) {
+                    return false;
+                }
+                captures.add(path.substr(i + 1, close - i - 1), value);
+                position += value.size();
+                i = close;
+            }
+            return position == requestPath.size();
+        }
+    };
+
+} // namespace sdk::Http
+
+#endif /* HTTP_ROUTE_PATTERN_HPP */
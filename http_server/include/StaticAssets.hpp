@@ -0,0 +1,40 @@
+#ifndef HTTP_STATIC_ASSETS_HPP
+#define HTTP_STATIC_ASSETS_HPP
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace sdk::Http {
+
+    /**
+     * @brief A gzip compressed file embedded in flash, generated by http_server_embed_static_assets()
+     */
+    struct StaticAsset {
+        /**
+         * @brief Path the asset is served at, starting with '/'
+         */
+        const char* path;
+        const char* contentType;
+        /**
+         * @brief Start of the compressed data in memory mapped flash
+         */
+        const uint8_t* start;
+        const uint8_t* end;
+        /**
+         * @brief Quoted checksum of the compressed data
+         */
+        const char* etag;
+
+        [[nodiscard]] std::span<const uint8_t> data() const { return {start, end}; }
+    };
+
+    /**
+     * @brief Index of the embedded assets, sorted by path
+     * @note  Defined by the source generated by http_server_embed_static_assets() in project_include.cmake
+     */
+    std::span<const StaticAsset> staticAssets();
+
+} // namespace sdk::Http
+
+#endif /* HTTP_STATIC_ASSETS_HPP */
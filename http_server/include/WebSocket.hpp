@@ -0,0 +1,138 @@
+#ifndef HTTP_WEB_SOCKET_HPP
+#define HTTP_WEB_SOCKET_HPP
+
+#include <esp_err.h>
+#include <esp_http_server.h>
+#include <etl/circular_buffer.h>
+#include <etl/string.h>
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+
+namespace sdk::Http {
+
+    class Server;
+
+    /**
+     * @brief A WebSocket URI that pushes messages to every connected client
+     *
+     *        A broadcast serializes the message once and queues it for each client. Frames are sent from the httpd
+     *        task, so a slow client never blocks the caller. Each client queues at most CONFIG_HTTP_WS_QUEUE_LENGTH
+     *        frames, when it falls further behind its oldest frames are dropped, as newer state replaces them anyway.
+     *        A client holds one of CONFIG_HTTP_WS_MAX_CLIENTS slots until its session closes, a client that finds
+     *        them all taken is closed with status 1013 Try Again Later.
+     *
+     *        Register with Server::registerWebSocket(), the endpoint must outlive the server.
+     */
+    class WebSocketEndpoint {
+    public:
+        /**
+         * @brief Callback for text frames received from a client.
+         * @param socket Socket of the client that sent the frame, can be passed to send().
+         * @param message The received text.
+         * @param userContext Any user context that was passed when registering the endpoint.
+         */
+        using MessageCallback = std::function<void(int socket, std::string_view message, void* userContext)>;
+
+        WebSocketEndpoint() = default;
+
+        WebSocketEndpoint(const WebSocketEndpoint&)            = delete;
+        WebSocketEndpoint& operator=(const WebSocketEndpoint&) = delete;
+
+        /**
+         * @brief Queue a text frame for every connected client.
+         * @param message The text to send.
+         * @return ESP_ERR_INVALID_STATE if not registered.
+         */
+        esp_err_t broadcast(std::string_view message);
+
+        /**
+         * @brief Queue a text frame for a single client.
+         * @param socket Socket of the client.
+         * @param message The text to send.
+         * @return ESP_ERR_NOT_FOUND if the client is not connected.
+         */
+        esp_err_t send(int socket, std::string_view message);
+
+        /**
+         * @brief Get the amount of connected clients.
+         */
+        [[nodiscard]] size_t clientCount();
+
+        /**
+         * @brief Get the amount of frames dropped because a client was too slow.
+         */
+        [[nodiscard]] uint32_t droppedFrames();
+
+    private:
+        friend class Server;
+
+        using Frame = std::shared_ptr<const std::string>;
+
+        struct Client {
+            WebSocketEndpoint*                                       endpoint = nullptr;
+            int                                                      socket   = -1;
+            bool                                                     sending  = false;
+            etl::circular_buffer<Frame, CONFIG_HTTP_WS_QUEUE_LENGTH> queue;
+        };
+
+        static constexpr char TAG[] = "HTTP WEBSOCKET";
+
+        httpd_handle_t                                 m_server      = nullptr;
+        MessageCallback                                m_onMessage   = nullptr;
+        void*                                          m_userContext = nullptr;
+        std::mutex                                     m_mutex;
+        std::array<Client, CONFIG_HTTP_WS_MAX_CLIENTS> m_clients{};
+        uint32_t                                       m_droppedFrames{0};
+
+        /**
+         * @brief Handler for the handshake and incoming frames, its user context is the endpoint.
+         */
+        static esp_err_t handler(httpd_req_t* req);
+
+        /**
+         * @brief Sends the queued frames of a client, runs on the httpd task.
+         * @param argument The Client to send for.
+         */
+        static void sendQueued(void* argument);
+
+        /**
+         * @brief Queue a frame for a client, call with m_mutex held.
+         */
+        void enqueue(Client& client, const Frame& frame);
+
+        /**
+         * @brief Take a slot for a client that finished the handshake.
+         * @param req The GET request of the handshake, its session is tied to the slot, which is freed when it closes.
+         * @return False if every slot is taken.
+         */
+        bool addClient(httpd_req_t* req);
+
+        /**
+         * @brief Free the slot of a client, called by httpd when the session of the client closes.
+         * @param context The Client.
+         */
+        static void releaseClient(void* context);
+
+        /**
+         * @brief Tell a client there is no room for it, with status 1013 Try Again Later.
+         */
+        static void sendFull(httpd_req_t* req);
+
+        /**
+         * @brief Find a connected client, call with m_mutex held.
+         */
+        Client* findClient(int socket);
+    };
+
+} // namespace sdk::Http
+
+#endif /* CONFIG_HTTPD_WS_SUPPORT */
+
+#endif /* HTTP_WEB_SOCKET_HPP */
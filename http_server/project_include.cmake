@@ -0,0 +1,30 @@
+# Embed a directory of static files, gzipped, for Http::Server::registerStaticAssets()
+#
+# Call from the CMakeLists.txt of the component that serves the files, after idf_component_register():
+#   http_server_embed_static_assets(${COMPONENT_LIB} "${CMAKE_CURRENT_SOURCE_DIR}/www")
+#
+# The files are compressed when CMake configures, and again whenever a file in the directory changes.
+set(HTTP_SERVER_TOOLS_DIR "${CMAKE_CURRENT_LIST_DIR}/tools")
+
+function(http_server_embed_static_assets target directory)
+    set(output "${CMAKE_CURRENT_BINARY_DIR}/static_assets")
+    file(GLOB_RECURSE sources CONFIGURE_DEPENDS "${directory}/*")
+
+    idf_build_get_property(python PYTHON)
+    execute_process(
+            COMMAND ${python} "${HTTP_SERVER_TOOLS_DIR}/embed_static_assets.py" "${directory}" "${output}"
+            OUTPUT_VARIABLE compressed
+            RESULT_VARIABLE result)
+    if (NOT result EQUAL 0)
+        message(FATAL_ERROR "Failed to embed static assets from ${directory}")
+    endif ()
+    set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS ${sources})
+
+    string(REPLACE "\n" ";" compressed "${compressed}")
+    foreach (file ${compressed})
+        if (file)
+            target_add_binary_data(${target} "${file}" BINARY)
+        endif ()
+    endforeach ()
+    target_sources(${target} PRIVATE "${output}/static_assets.cpp")
+endfunction()
@@ -0,0 +1,264 @@
+#include "AdmissionControl.hpp"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <lwip/sockets.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace sdk::Http {
+
+    AdmissionControl::AdmissionControl() {
+        ConfigRegistry::bind({
+                .key    = Config::key(),
+                .owner  = this,
+                .read   = [](void* owner) {
+                    auto&           self = *static_cast<AdmissionControl*>(owner);
+                    std::lock_guard lock(self.m_mutex);
+                    return self.m_config.exposedJson();
+                },
+                .patch  = [](void* owner, const nlohmann::json& patch) { return static_cast<AdmissionControl*>(owner)->patchFromClient(patch); },
+                .reload = [](void* owner) { return static_cast<AdmissionControl*>(owner)->reloadConfig(); },
+        });
+    }
+
+    AdmissionControl::~AdmissionControl() {
+        ConfigRegistry::unbind(Config::key(), this);
+    }
+
+    esp_err_t AdmissionControl::install(httpd_config_t& config) {
+        if (config.open_fn == onOpen && config.global_user_ctx == this) {
+            // Installed before a restart of the server
+            return ESP_OK;
+        }
+        if (config.open_fn != nullptr || config.close_fn != nullptr || config.global_user_ctx != nullptr) {
+            ESP_LOGE(TAG, "The server config already has connection callbacks");
+            return ESP_ERR_INVALID_STATE;
+        }
+        config.open_fn         = onOpen;
+        config.close_fn        = onClose;
+        config.global_user_ctx = this;
+        // httpd frees the global context with free() unless it gets a function for it
+        config.global_user_ctx_free_fn = [](void*) {};
+        config.lru_purge_enable        = true;
+        m_maxSockets                   = config.max_open_sockets;
+        return ESP_OK;
+    }
+
+    bool AdmissionControl::admit(httpd_req_t* req, RouteMetrics* metrics) {
+        const auto address = peerAddress(httpd_req_to_sockfd(req));
+        if (!address) {
+            return true;
+        }
+
+        {
+            std::lock_guard lock(m_mutex);
+            const uint32_t  rate = m_config.rate.value();
+            if (rate == 0) {
+                return true;
+            }
+            const int64_t now    = esp_timer_get_time();
+            Client*       client = findOrAdd(*address, now);
+            if (client == nullptr) {
+                return true;
+            }
+            const uint64_t refill = static_cast<uint64_t>(now - client->lastRefill) * rate * TOKEN / 1'000'000;
+            client->tokens        = static_cast<uint32_t>(std::min<uint64_t>(client->tokens + refill, static_cast<uint64_t>(m_config.burst.value()) * TOKEN));
+            client->lastRefill    = now;
+            client->lastSeen      = now;
+            if (client->tokens >= TOKEN) {
+                client->tokens -= TOKEN;
+                return true;
+            }
+            m_counters.requestsLimited++;
+        }
+
+        ESP_LOGD(TAG, "Rate limited %s", req->uri);
+        // At least one token a second is added, so a second is always long enough
+        httpd_resp_set_status(req, statusCodePhrase(StatusCode::TooManyRequests));
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        httpd_resp_send(req, nullptr, 0);
+        if (metrics != nullptr) {
+            RouteMetrics::Recorder recorder(*metrics);
+            recorder.setStatus(static_cast<uint16_t>(StatusCode::TooManyRequests));
+        }
+        return false;
+    }
+
+    AdmissionControl::Counters AdmissionControl::read() const {
+        std::lock_guard lock(m_mutex);
+        return m_counters;
+    }
+
+    esp_err_t AdmissionControl::onOpen(httpd_handle_t handle, const int socket) {
+        auto& self = *static_cast<AdmissionControl*>(httpd_get_global_user_ctx(handle));
+
+        const auto address = peerAddress(socket);
+
+        std::lock_guard lock(self.m_mutex);
+        // httpd calls close_fn for rejected sockets as well, so every socket is counted
+        self.m_counters.openSockets++;
+        if (!address) {
+            self.m_counters.connectionsAccepted++;
+            return ESP_OK;
+        }
+        const int64_t now    = esp_timer_get_time();
+        Client*       client = self.findOrAdd(*address, now);
+        if (client == nullptr) {
+            ESP_LOGW(TAG, "Client table full, connection %d is not limited", socket);
+            self.m_counters.connectionsAccepted++;
+            return ESP_OK;
+        }
+        client->connections++;
+        client->lastSeen = now;
+
+        const uint8_t limit = self.m_config.connections.value();
+        if (limit != 0 && client->connections > limit) {
+            ESP_LOGW(TAG, "Client has %d connections open, closing %d", client->connections - 1, socket);
+            self.m_counters.connectionsRejected++;
+            return ESP_FAIL;
+        }
+        self.m_counters.connectionsAccepted++;
+        return ESP_OK;
+    }
+
+    void AdmissionControl::onClose(httpd_handle_t handle, const int socket) {
+        auto& self = *static_cast<AdmissionControl*>(httpd_get_global_user_ctx(handle));
+
+        const auto address = peerAddress(socket);
+        {
+            std::lock_guard lock(self.m_mutex);
+            if (self.m_counters.openSockets == self.m_maxSockets) {
+                self.m_counters.socketsClosedAtCapacity++;
+            }
+            if (Client* client = address ? self.find(*address) : nullptr; client != nullptr && client->connections > 0) {
+                client->connections--;
+            }
+            self.m_counters.openSockets--;
+        }
+
+        // With a close_fn, closing the socket is up to the callback
+        close(socket);
+    }
+
+    std::optional<AdmissionControl::Address> AdmissionControl::peerAddress(const int socket) {
+        sockaddr_storage peer{};
+        socklen_t        length = sizeof(peer);
+        if (getpeername(socket, reinterpret_cast<sockaddr*>(&peer), &length) != 0) {
+            return std::nullopt;
+        }
+
+        Address address{};
+        if (peer.ss_family == AF_INET) {
+            const auto& ipv4 = reinterpret_cast<const sockaddr_in&>(peer);
+            address[10]      = 0xff;
+            address[11]      = 0xff;
+            std::memcpy(address.data() + 12, &ipv4.sin_addr.s_addr, 4);
+            return address;
+        }
+#if CONFIG_LWIP_IPV6
+        if (peer.ss_family == AF_INET6) {
+            const auto& ipv6 = reinterpret_cast<const sockaddr_in6&>(peer);
+            std::memcpy(address.data(), ipv6.sin6_addr.s6_addr, address.size());
+            return address;
+        }
+#endif
+        return std::nullopt;
+    }
+
+    AdmissionControl::Client* AdmissionControl::find(const Address& address) {
+        const auto client = std::find_if(m_clients.begin(), m_clients.end(), [&](const Client& entry) { return entry.address == address; });
+        return client == m_clients.end() ? nullptr : &*client;
+    }
+
+    AdmissionControl::Client* AdmissionControl::findOrAdd(const Address& address, const int64_t now) {
+        if (Client* client = find(address); client != nullptr) {
+            return client;
+        }
+
+        const Client fresh{.address = address, .connections = 0, .tokens = m_config.burst.value() * TOKEN, .lastRefill = now, .lastSeen = now};
+        if (!m_clients.full()) {
+            m_clients.push_back(fresh);
+            return &m_clients.back();
+        }
+
+        // Clients with open connections stay, their connections would be forgotten
+        Client* oldest = nullptr;
+        for (auto& client: m_clients) {
+            if (client.connections == 0 && (oldest == nullptr || client.lastSeen < oldest->lastSeen)) {
+                oldest = &client;
+            }
+        }
+        if (oldest == nullptr) {
+            return nullptr;
+        }
+        m_counters.clientsEvicted++;
+        *oldest = fresh;
+        return oldest;
+    }
+
+    void AdmissionControl::setConfig(const nlohmann::json& config, const bool saveConfig) {
+        std::lock_guard lock(m_mutex);
+        const auto      patched = patchConfig(config);
+        if (!patched || patched->changed == 0) {
+            return;
+        }
+        if (saveConfig) {
+            const auto ret = m_config.save();
+            assert(!ret && "Failed to save config");
+        }
+    }
+
+    std::error_code AdmissionControl::setConfig(const nlohmann::json& config, ConfigTransaction& transaction) {
+        std::lock_guard lock(m_mutex);
+        const auto      staged = m_config.stagePatch(config, transaction);
+        if (!staged) {
+            ESP_LOGE(TAG, "Invalid config update: %s", staged.error().message().c_str());
+            return staged.error();
+        } else if (staged->changedKeys.empty()) {
+            return {};
+        }
+        // The fields only change once the staged config is committed
+        return transaction.onCommit([this, config] {
+            std::lock_guard lock(m_mutex);
+            patchConfig(config);
+        });
+    }
+
+    std::expected<ConfigRegistry::PatchSummary, std::error_code> AdmissionControl::patchFromClient(const nlohmann::json& config) {
+        std::lock_guard lock(m_mutex);
+        if (auto err = m_config.validateClientPatch(config)) {
+            return std::unexpected(err);
+        }
+        const auto patched = patchConfig(config);
+        if (!patched || patched->changed == 0) {
+            return patched;
+        }
+        if (auto err = m_config.save()) {
+            return std::unexpected(err);
+        }
+        return patched;
+    }
+
+    std::expected<ConfigRegistry::PatchSummary, std::error_code> AdmissionControl::reloadConfig() {
+        std::lock_guard lock(m_mutex);
+        const auto      reloaded = m_config.reload();
+        if (!reloaded) {
+            ESP_LOGE(TAG, "Error reloading config: %s", reloaded.error().message().c_str());
+            return std::unexpected(reloaded.error());
+        }
+        return ConfigRegistry::PatchSummary{.changed = reloaded->changedKeys.size(), .restartType = reloaded->restartType};
+    }
+
+    std::expected<ConfigRegistry::PatchSummary, std::error_code> AdmissionControl::patchConfig(const nlohmann::json& config) {
+        const auto patched = m_config.applyPatch(config);
+        if (!patched) {
+            ESP_LOGE(TAG, "Invalid config update: %s", patched.error().message().c_str());
+            return std::unexpected(patched.error());
+        }
+        return ConfigRegistry::PatchSummary{.changed = patched->changedKeys.size(), .restartType = patched->restartType};
+    }
+
+} // namespace sdk::Http
@@ -0,0 +1,110 @@
+#include "AsyncWorkers.hpp"
+
+#include <esp_log.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+#include <cassert>
+#include <mutex>
+
+namespace sdk::Http {
+
+    namespace {
+        constexpr char TAG[] = "HTTP ASYNC";
+
+        struct Job {
+            httpd_req_t*          req;
+            AsyncWorkers::Handler handler;
+            void*                 context;
+        };
+
+        // One slot per request in flight, so queueing a job never has to wait
+        uint8_t       queueStorage[CONFIG_HTTP_ASYNC_MAX_IN_FLIGHT * sizeof(Job)]{};
+        StaticQueue_t queueData{};
+        QueueHandle_t queue = nullptr;
+
+        std::mutex  workersMutex;
+        std::size_t workers  = 0;
+        std::size_t requests = 0;
+
+        void release() {
+            std::lock_guard lock(workersMutex);
+            assert(requests > 0 && "Released a request that was not in flight");
+            requests--;
+        }
+
+        void work(void*) {
+            Job job{};
+            while (true) {
+                if (xQueueReceive(queue, &job, portMAX_DELAY) != pdTRUE) {
+                    continue;
+                }
+                if (const auto err = job.handler(job.req, job.context); err != ESP_OK) {
+                    ESP_LOGW(TAG, "Handler for %s failed: %s", job.req->uri, esp_err_to_name(err));
+                }
+                if (const auto err = httpd_req_async_handler_complete(job.req); err != ESP_OK) {
+                    ESP_LOGE(TAG, "Error completing request: %s", esp_err_to_name(err));
+                }
+                release();
+            }
+        }
+    } // namespace
+
+    esp_err_t AsyncWorkers::start() {
+        std::lock_guard lock(workersMutex);
+        if (queue == nullptr) {
+            queue = xQueueCreateStatic(CONFIG_HTTP_ASYNC_MAX_IN_FLIGHT, sizeof(Job), queueStorage, &queueData);
+        }
+        // Picks up where a previous attempt failed
+        for (; workers < CONFIG_HTTP_ASYNC_WORKERS; workers++) {
+            if (xTaskCreate(work, "http async", CONFIG_HTTP_ASYNC_WORKER_STACK_SIZE, nullptr, CONFIG_HTTP_ASYNC_WORKER_PRIORITY, nullptr) != pdPASS) {
+                ESP_LOGE(TAG, "Failed to create worker %zu", workers);
+                return ESP_ERR_NO_MEM;
+            }
+        }
+        return ESP_OK;
+    }
+
+    esp_err_t AsyncWorkers::submit(httpd_req_t* req, const Handler handler, void* context) {
+        {
+            std::lock_guard lock(workersMutex);
+            if (workers == 0) {
+                return ESP_ERR_INVALID_STATE;
+            }
+            if (requests >= CONFIG_HTTP_ASYNC_MAX_IN_FLIGHT) {
+                ESP_LOGW(TAG, "Too many requests in flight for %s", req->uri);
+                return ESP_ERR_NO_MEM;
+            }
+            requests++;
+        }
+
+        httpd_req_t* detached = nullptr;
+        if (const auto err = httpd_req_async_handler_begin(req, &detached); err != ESP_OK) {
+            ESP_LOGE(TAG, "Error detaching %s: %s", req->uri, esp_err_to_name(err));
+            release();
+            return err;
+        }
+
+        const Job job{.req = detached, .handler = handler, .context = context};
+        [[maybe_unused]] const auto queued = xQueueSend(queue, &job, 0);
+        assert(queued == pdTRUE && "The queue has room for every request in flight");
+        return ESP_OK;
+    }
+
+    esp_err_t AsyncWorkers::drain(const TickType_t timeout) {
+        const TickType_t start = xTaskGetTickCount();
+        while (inFlight() > 0) {
+            if (xTaskGetTickCount() - start >= timeout) {
+                return ESP_ERR_TIMEOUT;
+            }
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        return ESP_OK;
+    }
+
+    std::size_t AsyncWorkers::inFlight() {
+        std::lock_guard lock(workersMutex);
+        return requests;
+    }
+
+} // namespace sdk::Http
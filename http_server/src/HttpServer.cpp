@@ -1,14 +1,29 @@
 #include "HttpServer.hpp"
 
+#include "ConfigMetrics.hpp"
+#include "ConfigSnapshot.hpp"
+#include "Manager.hpp"
+
+#include <esp_heap_caps.h>
+#include <esp_system.h>
 #include <esp_system_error.hpp>
 #include <etl/string.h>
 #include <etl/string_stream.h>
+#include <etl/to_string.h>
 #include <etl/unordered_map.h>
 #include <etl/vector.h>
 #include <freertos/FreeRTOS.h>
+#include <http_parser.h>
 #include <lwip/sockets.h>
 
+#include <algorithm>
+#include <cinttypes>
 #include <regex>
+#include <string_view>
+
+// Two steps, so the value of the Kconfig option is stringified instead of its name
+#define HTTP_SERVER_STRINGIFY_VALUE(value) #value
+#define HTTP_SERVER_STRINGIFY(value) HTTP_SERVER_STRINGIFY_VALUE(value)
 
 namespace sdk::Http {
     using Status = Component::Status;
@@ -24,9 +39,16 @@ namespace sdk::Http {
             return Status::STOPPED;
         }
         ESP_LOGD(TAG, "Stopping webserver");
+        // Detached requests use the server and their route, wait for them first
+        if (const auto err = AsyncWorkers::drain(pdMS_TO_TICKS(CONFIG_HTTP_ASYNC_STOP_TIMEOUT)); err != ESP_OK) {
+            ESP_LOGE(TAG, "%zu async requests still in flight", AsyncWorkers::inFlight());
+            return Status::ERROR;
+        }
         if (httpd_stop(m_server) == ESP_OK) {
             // Explicitly clear the server handle
             m_server = nullptr;
+            // httpd forgot the handlers, so the routes have to be registered again after a restart
+            m_routes.clear();
             return Status::STOPPED;
         }
         // Should be impossible, as `httpd_stop` should always return ESP_OK if server is not NULL
@@ -41,6 +63,13 @@ namespace sdk::Http {
 
         ESP_LOGD(TAG, "Initializing webserver");
 
+#ifdef CONFIG_HTTP_ADMISSION_CONTROL
+        m_admitting = m_admission.install(m_config) == ESP_OK;
+        if (!m_admitting) {
+            ESP_LOGW(TAG, "Connections and requests are not limited per client");
+        }
+#endif
+
         if (const auto ret = httpd_start(&m_server, &m_config); ret != ESP_OK) {
             ESP_LOGE(TAG, "Error starting webserver: %s", esp_err_to_name(ret));
             return Status::ERROR;
@@ -76,4 +105,531 @@ namespace sdk::Http {
         return {};
     }
 
+    std::error_code Server::registerRoute(std::unique_ptr<Route> route) {
+        if (m_server == nullptr) {
+            ESP_LOGE(TAG, "Webserver not initialized");
+            return std::make_error_code(ESP_ERR_INVALID_STATE);
+        }
+        if (route->match != nullptr && m_config.uri_match_fn == nullptr) {
+            ESP_LOGE(TAG, "Route %s requires a wildcard uri_match_fn", route->handlerUri);
+            return std::make_error_code(ESP_ERR_INVALID_ARG);
+        }
+        if (m_routes.full()) {
+            ESP_LOGE(TAG, "No room for route %s, increase HTTP_MAX_ROUTES", route->handlerUri);
+            return std::make_error_code(ESP_ERR_NO_MEM);
+        }
+        route->admission = m_admitting ? &m_admission : nullptr;
+        if (route->async) {
+            if (const auto err = AsyncWorkers::start(); err != ESP_OK) {
+                ESP_LOGE(TAG, "Error starting async workers for %s: %s", route->handlerUri, esp_err_to_name(err));
+                return std::make_error_code(err);
+            }
+        }
+
+        // Patterns with the same literal prefix share a handler, chain the route behind the last of them
+        Route* last = nullptr;
+        for (const auto& existing: m_routes) {
+            if (existing->method != route->method || std::string_view(existing->handlerUri) != route->handlerUri) {
+                continue;
+            }
+            if (existing->match == nullptr || route->match == nullptr || existing->pattern == route->pattern) {
+                assert(false && "Don't register the same URI twice");
+                ESP_LOGE(TAG, "Route %s is already registered", route->handlerUri);
+                return std::make_error_code(ESP_ERR_HTTPD_HANDLER_EXISTS);
+            }
+            if (existing->next == nullptr) {
+                last = existing.get();
+            }
+        }
+        if (last != nullptr) {
+            last->next = route.get();
+            m_routes.push_back(std::move(route));
+            return {};
+        }
+
+        const httpd_uri uri = {
+                .uri      = route->handlerUri,
+                .method   = route->method,
+                .handler  = routeHandler,
+                .user_ctx = route.get(),
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+                .is_websocket             = false,
+                .handle_ws_control_frames = false,
+                .supported_subprotocol    = nullptr,
+#endif
+        };
+        if (const auto ret = httpd_register_uri_handler(m_server, &uri); ret != ESP_OK) {
+            assert(ret == ESP_ERR_HTTPD_HANDLER_EXISTS && "Don't register the same URI twice");
+            ESP_LOGE(TAG, "Error registering route %s: %s", route->handlerUri, esp_err_to_name(ret));
+            return std::make_error_code(ret);
+        }
+        ESP_LOGD(TAG, "Registered route %s", route->handlerUri);
+        m_routes.push_back(std::move(route));
+        return {};
+    }
+
+    esp_err_t Server::routeHandler(httpd_req_t* req) {
+        assert(req->user_ctx != nullptr && "User context is null");
+
+        // Every route of a chain belongs to the same server
+        AdmissionControl* admission = static_cast<Route*>(req->user_ctx)->admission;
+
+        std::string_view path(req->uri);
+        path = path.substr(0, path.find_first_of("?#"));
+
+        // Matching is a string compare, so the route is found first and a 429 is counted against it
+        PathParameters captures;
+        for (auto* route = static_cast<Route*>(req->user_ctx); route != nullptr; route = route->next) {
+            captures.clear();
+            if (route->match != nullptr && !route->match(path, captures)) {
+                continue;
+            }
+            if (admission != nullptr && !admission->admit(req, &route->metrics)) {
+                return ESP_OK;
+            }
+            if (!route->async) {
+                return route->handle(req, captures);
+            }
+            const auto err = AsyncWorkers::submit(req, asyncRouteHandler, route);
+            if (err == ESP_ERR_NO_MEM) {
+                RouteMetrics::Recorder metrics(route->metrics);
+                return sendUnavailable(req, metrics);
+            }
+            if (err != ESP_OK) {
+                return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, nullptr);
+            }
+            return ESP_OK;
+        }
+        if (admission != nullptr && !admission->admit(req, nullptr)) {
+            return ESP_OK;
+        }
+        ESP_LOGD(TAG, "No route matches %s", req->uri);
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, nullptr);
+    }
+
+    esp_err_t Server::asyncRouteHandler(httpd_req_t* req, void* route) {
+        auto& matched = *static_cast<Route*>(route);
+
+        std::string_view path(req->uri);
+        path = path.substr(0, path.find_first_of("?#"));
+
+        PathParameters captures;
+        if (matched.match != nullptr && !matched.match(path, captures)) {
+            // The URI is copied when the request is detached, so this can't happen
+            return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, nullptr);
+        }
+        return matched.handle(req, captures);
+    }
+
+    namespace {
+        const char* componentStatusName(const Component::Status status) {
+            switch (status) {
+                case Component::Status::UNINITIALIZED: return "uninitialized";
+                case Component::Status::INITIALIZING: return "initializing";
+                case Component::Status::RUNNING: return "running";
+                case Component::Status::ERROR: return "error";
+                case Component::Status::STOPPING: return "stopping";
+                case Component::Status::STOPPED: return "stopped";
+            }
+            return "unknown";
+        }
+
+        constexpr std::array<const char*, RouteMetrics::NUM_STAGES> stageNames{"receive", "callback", "send"};
+
+        /**
+         * @brief Check whether the client takes a gzip encoded response.
+         * @param req Pointer to the request object that was made.
+         * @return True if Accept-Encoding is missing or lists gzip or '*' without q=0.
+         */
+        bool acceptsGzip(httpd_req_t* req) {
+            etl::string<128> header;
+            const size_t     length = httpd_req_get_hdr_value_len(req, "Accept-Encoding");
+            if (length == 0) {
+                // Without the header any encoding is acceptable
+                return true;
+            }
+            if (length > header.max_size()) {
+                // Too long to check, a list that long lists gzip
+                return true;
+            }
+            header.uninitialized_resize(length);
+            if (httpd_req_get_hdr_value_str(req, "Accept-Encoding", header.data(), length + 1) != ESP_OK) {
+                return true;
+            }
+
+            const auto trim = [](std::string_view value) {
+                const auto start = value.find_first_not_of(" \t");
+                if (start == std::string_view::npos) {
+                    return std::string_view{};
+                }
+                return value.substr(start, value.find_last_not_of(" \t") - start + 1);
+            };
+            std::string_view list(header.data(), header.size());
+            while (!list.empty()) {
+                const auto end    = list.find(',');
+                const auto coding = list.substr(0, end);
+                list              = end == std::string_view::npos ? std::string_view{} : list.substr(end + 1);
+
+                const auto parameters = coding.find(';');
+                const auto name       = trim(coding.substr(0, parameters));
+                if (name != "gzip" && name != "x-gzip" && name != "*") {
+                    continue;
+                }
+                // Only q=0 with any amount of zero decimals refuses the coding
+                auto weight = parameters == std::string_view::npos ? std::string_view{} : trim(coding.substr(parameters + 1));
+                if (!weight.starts_with("q=") && !weight.starts_with("Q=")) {
+                    return true;
+                }
+                weight = weight.substr(2);
+                return weight.empty() || weight[0] != '0' || weight.find_first_not_of("0.", 1) != std::string_view::npos;
+            }
+            return false;
+        }
+    } // namespace
+
+    std::expected<void, Server::Error> Server::writeMetrics(ResponseWriter& writer) const {
+        writer.setContentType("text/plain; version=0.0.4");
+
+        // Prometheus wants the samples of a metric together, so the routes are walked once per metric
+        const auto forEachRoute = [this](auto&& visitor) {
+            for (const auto& route: m_routes) {
+                visitor(http_method_str(static_cast<http_method>(route->method)), static_cast<int>(route->pattern.size()), route->pattern.data(), route->metrics.read());
+            }
+            if (!m_staticAssets.empty()) {
+                visitor(http_method_str(HTTP_GET), static_cast<int>(m_staticUri.size()), m_staticUri.data(), m_staticMetrics.read());
+            }
+        };
+
+        writer.write("# HELP http_requests_total Requests handled per route.\n# TYPE http_requests_total counter\n");
+        forEachRoute([&](const char* method, int length, const char* route, const RouteMetrics::Counters& counters) {
+            writer.print("http_requests_total{method=\"%s\",route=\"%.*s\"} %" PRIu32 "\n", method, length, route, counters.requests);
+        });
+        writer.write("# HELP http_responses_total Responses per route and status class.\n# TYPE http_responses_total counter\n");
+        forEachRoute([&](const char* method, int length, const char* route, const RouteMetrics::Counters& counters) {
+            for (size_t i = 0; i < counters.statusClasses.size(); i++) {
+                if (counters.statusClasses[i] > 0) {
+                    writer.print("http_responses_total{method=\"%s\",route=\"%.*s\",code=\"%zuxx\"} %" PRIu32 "\n", method, length, route, i + 1, counters.statusClasses[i]);
+                }
+            }
+        });
+        writer.write("# HELP http_request_bytes_total Request body bytes received per route.\n# TYPE http_request_bytes_total counter\n");
+        forEachRoute([&](const char* method, int length, const char* route, const RouteMetrics::Counters& counters) {
+            writer.print("http_request_bytes_total{method=\"%s\",route=\"%.*s\"} %" PRIu64 "\n", method, length, route, counters.bytesIn);
+        });
+        writer.write("# HELP http_response_bytes_total Response body bytes sent per route.\n# TYPE http_response_bytes_total counter\n");
+        forEachRoute([&](const char* method, int length, const char* route, const RouteMetrics::Counters& counters) {
+            writer.print("http_response_bytes_total{method=\"%s\",route=\"%.*s\"} %" PRIu64 "\n", method, length, route, counters.bytesOut);
+        });
+        writer.write("# HELP http_request_duration_seconds Time spent per stage of handling a request.\n# TYPE http_request_duration_seconds histogram\n");
+        forEachRoute([&](const char* method, int length, const char* route, const RouteMetrics::Counters& counters) {
+            for (size_t stage = 0; stage < RouteMetrics::NUM_STAGES; stage++) {
+                const auto& latency = counters.latency[stage];
+                if (latency.count == 0) {
+                    continue;
+                }
+                uint32_t cumulative = 0;
+                for (size_t bucket = 0; bucket < RouteMetrics::latencyBounds.size(); bucket++) {
+                    cumulative += latency.buckets[bucket];
+                    writer.print("http_request_duration_seconds_bucket{method=\"%s\",route=\"%.*s\",stage=\"%s\",le=\"%g\"} %" PRIu32 "\n",
+                                 method, length, route, stageNames[stage], RouteMetrics::latencyBounds[bucket] / 1e6, cumulative);
+                }
+                writer.print("http_request_duration_seconds_bucket{method=\"%s\",route=\"%.*s\",stage=\"%s\",le=\"+Inf\"} %" PRIu32 "\n", method, length, route, stageNames[stage], latency.count);
+                writer.print("http_request_duration_seconds_sum{method=\"%s\",route=\"%.*s\",stage=\"%s\"} %.6f\n", method, length, route, stageNames[stage], latency.totalMicroseconds / 1e6);
+                writer.print("http_request_duration_seconds_count{method=\"%s\",route=\"%.*s\",stage=\"%s\"} %" PRIu32 "\n", method, length, route, stageNames[stage], latency.count);
+            }
+        });
+        writer.print("# HELP http_request_arenas_available Request arenas not in use.\n# TYPE http_request_arenas_available gauge\nhttp_request_arenas_available %zu\n", RequestArena::available());
+        writer.print("# HELP http_async_requests_in_flight Requests queued or running on the async workers.\n# TYPE http_async_requests_in_flight gauge\nhttp_async_requests_in_flight %zu\n", AsyncWorkers::inFlight());
+
+        if (m_admitting) {
+            const auto admission = m_admission.read();
+            writer.print("# HELP http_connections_accepted_total Connections accepted.\n# TYPE http_connections_accepted_total counter\nhttp_connections_accepted_total %" PRIu32 "\n", admission.connectionsAccepted);
+            writer.print("# HELP http_connections_rejected_total Connections closed as their client had too many open.\n# TYPE http_connections_rejected_total counter\nhttp_connections_rejected_total %" PRIu32 "\n", admission.connectionsRejected);
+            writer.print("# HELP http_requests_rate_limited_total Requests answered with 429.\n# TYPE http_requests_rate_limited_total counter\nhttp_requests_rate_limited_total %" PRIu32 "\n", admission.requestsLimited);
+            writer.print("# HELP http_clients_evicted_total Clients dropped from the admission table.\n# TYPE http_clients_evicted_total counter\nhttp_clients_evicted_total %" PRIu32 "\n", admission.clientsEvicted);
+            writer.print("# HELP http_sockets_closed_at_capacity_total Sockets closed while all sockets were in use, including LRU purges.\n# TYPE http_sockets_closed_at_capacity_total counter\nhttp_sockets_closed_at_capacity_total %" PRIu32 "\n", admission.socketsClosedAtCapacity);
+            writer.print("# HELP http_open_sockets Sockets open.\n# TYPE http_open_sockets gauge\nhttp_open_sockets %u\n", admission.openSockets);
+        }
+
+        writer.write("# HELP manager_component_status Current status of each component.\n# TYPE manager_component_status gauge\n");
+        Manager::forEachComponent([&](Component& component, bool active) {
+            writer.print("manager_component_status{component=\"%s\",status=\"%s\",active=\"%s\"} 1\n", component.getTag().c_str(), componentStatusName(component.getStatus()), active ? "true" : "false");
+        });
+
+        writer.print("# HELP heap_free_bytes Free heap.\n# TYPE heap_free_bytes gauge\nheap_free_bytes %" PRIu32 "\n", esp_get_free_heap_size());
+        writer.print("# HELP heap_minimum_free_bytes Lowest free heap since boot.\n# TYPE heap_minimum_free_bytes gauge\nheap_minimum_free_bytes %" PRIu32 "\n", esp_get_minimum_free_heap_size());
+        writer.print("# HELP heap_largest_free_block_bytes Largest block that can be allocated.\n# TYPE heap_largest_free_block_bytes gauge\nheap_largest_free_block_bytes %zu\n",
+                     heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+
+#ifdef CONFIG_NVS_WRITE_METRICS
+        // Copied first, ConfigMetrics must not be locked while the response is sent
+        etl::vector<ConfigMetrics::KeyMetrics, CONFIG_NVS_WRITE_METRICS_MAX_KEYS> keys;
+        ConfigMetrics::forEachKey([&](const ConfigMetrics::KeyMetrics& metrics) { keys.push_back(metrics); });
+        writer.write("# HELP nvs_writes_total Writes per NVS key.\n# TYPE nvs_writes_total counter\n");
+        for (const auto& key: keys) {
+            writer.print("nvs_writes_total{namespace=\"%s\",key=\"%s\"} %" PRIu32 "\n", key.nvsNamespace.c_str(), key.key.c_str(), key.writes);
+        }
+        writer.write("# HELP nvs_entries_written_total Estimated NVS entries written per key.\n# TYPE nvs_entries_written_total counter\n");
+        for (const auto& key: keys) {
+            writer.print("nvs_entries_written_total{namespace=\"%s\",key=\"%s\"} %" PRIu64 "\n", key.nvsNamespace.c_str(), key.key.c_str(), key.entriesWritten);
+        }
+#endif
+
+        if (writer.error() != ESP_OK) {
+            return std::unexpected(Error{.code = StatusCode::InternalServerError, .message = "Failed to write metrics"});
+        }
+        return {};
+    }
+
+    namespace {
+        /**
+         * @brief Lets nlohmann::json serialize into a response, the writer gathers the characters into chunks
+         */
+        class WriterOutput final : public nlohmann::detail::output_adapter_protocol<char> {
+        public:
+            explicit WriterOutput(ResponseWriter& writer) : m_writer(writer) {}
+
+            void write_character(const char c) override {
+                m_writer.write(std::string_view(&c, 1));
+            }
+
+            void write_characters(const char* s, const std::size_t length) override {
+                m_writer.write(std::string_view(s, length));
+            }
+
+        private:
+            ResponseWriter& m_writer;
+        };
+
+        const char* restartTypeName(const RestartType type) {
+            switch (type) {
+                case RestartType::NONE: return "none";
+                case RestartType::COMPONENT: return "component";
+                case RestartType::DEVICE: return "device";
+            }
+            return "unknown";
+        }
+
+        std::expected<QueryValue, Server::Error> configKey(const PathParameters& path) {
+            const auto key = path.value("key");
+            if (!key) {
+                return std::unexpected(Server::Error{.code = StatusCode::BadRequest, .message = "Invalid config key"});
+            }
+            return *key;
+        }
+    } // namespace
+
+    std::expected<void, Server::Error> Server::writeConfig(const PathParameters& path, ResponseWriter& writer) {
+        const auto key = configKey(path);
+        if (!key) {
+            return std::unexpected(key.error());
+        }
+        // A copy, so the owner is not held up while the response goes out
+        const auto config = ConfigRegistry::read(std::string_view(key->data(), key->size()));
+        if (!config) {
+            return std::unexpected(Error{.code = StatusCode::NotFound, .message = "Unknown config"});
+        }
+
+        writer.setContentType("application/json");
+        // Invalid UTF-8 is replaced instead of thrown on, a half sent response can't be taken back
+        nlohmann::detail::serializer<nlohmann::json> serializer(std::make_shared<WriterOutput>(writer), ' ', nlohmann::json::error_handler_t::replace);
+        serializer.dump(*config, false, false, 0);
+
+        if (writer.error() != ESP_OK) {
+            return std::unexpected(Error{.code = StatusCode::InternalServerError, .message = "Failed to write config"});
+        }
+        return {};
+    }
+
+    Server::Result<64> Server::patchConfig(const PathParameters& path, const etl::string<CONFIG_HTTP_CONFIG_PATCH_SIZE>& body) {
+        const auto key = configKey(path);
+        if (!key) {
+            return std::unexpected(key.error());
+        }
+
+        const auto patch = nlohmann::json::parse(body.begin(), body.end(), nullptr, false);
+        if (patch.is_discarded()) {
+            return std::unexpected(Error{.code = StatusCode::BadRequest, .message = "Malformed json"});
+        }
+
+        const auto patched = ConfigRegistry::patch(std::string_view(key->data(), key->size()), patch);
+        if (!patched) {
+            if (patched.error().value() == ESP_ERR_NOT_FOUND) {
+                return std::unexpected(Error{.code = StatusCode::NotFound, .message = "Unknown config"});
+            } else if (patched.error().value() == ESP_ERR_INVALID_ARG) {
+                return std::unexpected(Error{.code = StatusCode::UnprocessableEntity, .message = "Invalid config"});
+            }
+            ESP_LOGE(TAG, "Error saving config %s: %s", key->c_str(), patched.error().message().c_str());
+            return std::unexpected(Error{.code = StatusCode::InternalServerError, .message = "Failed to save config"});
+        }
+        if (patched->restartType != RestartType::NONE) {
+            ESP_LOGI(TAG, "Config %s changed, needs a %s restart", key->c_str(), restartTypeName(patched->restartType));
+        }
+
+        etl::string<64> response(R"({"changed":)");
+        etl::to_string(patched->changed, response, true);
+        response.append(R"(,"restart":")").append(restartTypeName(patched->restartType)).append(R"("})");
+        return response;
+    }
+
+    std::expected<void, Server::Error> Server::exportConfig(const Authorize authorize, ResponseWriter& writer) {
+        if (!authorize(writer.request())) {
+            ESP_LOGW(TAG, "Unauthorized config export refused");
+            return std::unexpected(Error{.code = StatusCode::Unauthorized, .message = "Not authorized"});
+        }
+
+        writer.setContentType("application/octet-stream");
+        const auto err = ConfigSnapshot::exportTo([&writer](const std::span<const uint8_t> data) {
+            return std::make_error_code(writer.write({reinterpret_cast<const char*>(data.data()), data.size()}));
+        });
+        if (err) {
+            ESP_LOGE(TAG, "Error exporting config: %s", err.message().c_str());
+            return std::unexpected(Error{.code = StatusCode::InternalServerError, .message = "Failed to export config"});
+        }
+        return {};
+    }
+
+    Server::Result<64> Server::importConfig(const Authorize authorize, BodyReader& body) {
+        if (!authorize(body.request())) {
+            ESP_LOGW(TAG, "Unauthorized config import refused");
+            return std::unexpected(Error{.code = StatusCode::Unauthorized, .message = "Not authorized"});
+        }
+        if (body.contentLength() == 0) {
+            return std::unexpected(Error{.code = StatusCode::LengthRequired, .message = "Snapshot missing"});
+        }
+
+        // Holds a chunk buffer, too large for the worker stack
+        const auto            importer = std::make_unique<ConfigSnapshot::Importer>();
+        std::array<char, 128> buffer{};
+        std::error_code       err;
+        while (!err) {
+            const auto received = body.read(buffer);
+            if (!received) {
+                return std::unexpected(Error{.code = StatusCode::BadRequest, .message = "Upload interrupted"});
+            }
+            if (*received == 0) {
+                break;
+            }
+            err = importer->write({reinterpret_cast<const uint8_t*>(buffer.data()), *received});
+        }
+
+        switch (err ? err.value() : importer->finish().value()) {
+            case ESP_OK:
+                break;
+            case ESP_ERR_INVALID_SIZE:
+                return std::unexpected(Error{.code = StatusCode::BadRequest, .message = "Snapshot incomplete"});
+            case ESP_ERR_INVALID_CRC:
+            case ESP_ERR_INVALID_VERSION:
+            case ESP_ERR_INVALID_ARG:
+            case ESP_ERR_NOT_FOUND:
+                return std::unexpected(Error{.code = StatusCode::UnprocessableEntity, .message = "Invalid snapshot"});
+            default:
+                return std::unexpected(Error{.code = StatusCode::InternalServerError, .message = "Failed to import config"});
+        }
+
+        // Bound owners reloaded the imported objects, anything else needs the device to restart
+        const auto restartType = importer->restartType();
+        ESP_LOGI(TAG, "Config snapshot imported, needs a %s restart", restartTypeName(restartType));
+        etl::string<64> response(R"({"restart":")");
+        response.append(restartTypeName(restartType)).append(R"("})");
+        return response;
+    }
+
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    std::error_code Server::registerWebSocket(const Uri& path, WebSocketEndpoint& endpoint, WebSocketEndpoint::MessageCallback onMessage, void* userContext) const {
+        ESP_LOGD(TAG, "Registering WebSocket for %s", path.c_str());
+
+        if (m_server == nullptr) {
+            ESP_LOGE(TAG, "Webserver not initialized");
+            return std::make_error_code(ESP_ERR_INVALID_STATE);
+        }
+
+        endpoint.m_server      = m_server;
+        endpoint.m_onMessage   = std::move(onMessage);
+        endpoint.m_userContext = userContext;
+
+        const httpd_uri uri = {
+                .uri                      = path.c_str(),
+                .method                   = HTTP_GET,
+                .handler                  = WebSocketEndpoint::handler,
+                .user_ctx                 = &endpoint,
+                .is_websocket             = true,
+                .handle_ws_control_frames = false,
+                .supported_subprotocol    = nullptr,
+        };
+        if (const auto ret = httpd_register_uri_handler(m_server, &uri); ret != ESP_OK) {
+            assert(ret == ESP_ERR_HTTPD_HANDLER_EXISTS && "Don't register the same URI twice");
+            ESP_LOGE(TAG, "Error registering WebSocket: %s", esp_err_to_name(ret));
+            return std::make_error_code(ret);
+        }
+        return {};
+    }
+#endif
+
+    std::error_code Server::registerStaticAssets(const Uri& uri, const std::span<const StaticAsset> assets) {
+        if (uri.find('*') != Uri::npos && m_config.uri_match_fn == nullptr) {
+            ESP_LOGE(TAG, "Serving static assets under %s requires a wildcard uri_match_fn", uri.c_str());
+            return std::make_error_code(ESP_ERR_INVALID_ARG);
+        }
+        ESP_LOGD(TAG, "Serving %zu static assets under %s", assets.size(), uri.c_str());
+        m_staticAssets = assets;
+        m_staticUri    = uri;
+        return registerRawUri(uri, HTTP_GET, staticAssetHandler, this);
+    }
+
+    esp_err_t Server::staticAssetHandler(httpd_req_t* req) {
+        assert(req->user_ctx != nullptr && "User context is null");
+        auto& server = *static_cast<Server*>(req->user_ctx);
+        if (server.m_admitting && !server.m_admission.admit(req, &server.m_staticMetrics)) {
+            return ESP_OK;
+        }
+        const auto&            assets = server.m_staticAssets;
+        RouteMetrics::Recorder metrics(server.m_staticMetrics);
+
+        etl::string<CONFIG_HTTPD_MAX_URI_LEN + sizeof("index.html")> path(req->uri);
+        if (const auto query = path.find_first_of("?#"); query != decltype(path)::npos) {
+            path.resize(query);
+        }
+        // Asset paths are stored decoded, so /my%20file.js finds "/my file.js"
+        path.uninitialized_resize(urlDecode(std::string_view(path.data(), path.size()), path.data(), false));
+        if (path.empty() || path.back() == '/') {
+            path.append("index.html");
+        }
+
+        const std::string_view wanted(path.data(), path.size());
+        const auto             asset = std::lower_bound(assets.begin(), assets.end(), wanted, [](const StaticAsset& asset, std::string_view value) {
+            return std::string_view(asset.path) < value;
+        });
+        if (asset == assets.end() || wanted != asset->path) {
+            ESP_LOGD(TAG, "No static asset for %s", req->uri);
+            metrics.setStatus(static_cast<uint16_t>(StatusCode::NotFound));
+            return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, nullptr);
+        }
+
+        // The page itself is revalidated every time, so a firmware update shows up at once. What it loads can be cached
+        const bool isPage = std::string_view(asset->contentType) == "text/html";
+        // Caches must not hand the gzip encoded asset to clients that did not ask for it
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+        httpd_resp_set_hdr(req, "ETag", asset->etag);
+        httpd_resp_set_hdr(req, "Cache-Control", isPage ? "no-cache" : "max-age=" HTTP_SERVER_STRINGIFY(CONFIG_HTTP_STATIC_ASSET_MAX_AGE));
+        if (etagMatches(req, asset->etag)) {
+            return sendNotModified(req, metrics);
+        }
+        // Assets are only stored compressed, there is no other representation to fall back to
+        if (!acceptsGzip(req)) {
+            ESP_LOGD(TAG, "Client does not accept gzip for %s", req->uri);
+            metrics.setStatus(static_cast<uint16_t>(StatusCode::NotAcceptable));
+            return httpd_resp_send_custom_err(req, statusCodePhrase(StatusCode::NotAcceptable), "Only available gzip encoded");
+        }
+
+        httpd_resp_set_type(req, asset->contentType);
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+        // Straight from memory mapped flash, the data is only copied into the socket buffers
+        const auto data = asset->data();
+        const auto err = httpd_resp_send(req, reinterpret_cast<const char*>(data.data()), static_cast<ssize_t>(data.size()));
+        metrics.finish(RouteMetrics::Stage::SEND);
+        metrics.setBytesOut(data.size());
+        return err;
+    }
+
 } // namespace sdk::Http
@@ -0,0 +1,55 @@
+#include "RequestArena.hpp"
+
+#include <algorithm>
+#include <mutex>
+
+namespace sdk::Http {
+
+    namespace {
+        struct Block {
+            alignas(std::max_align_t) std::array<std::byte, RequestArena::SIZE> memory;
+            bool inUse = false;
+        };
+
+        std::array<Block, CONFIG_HTTP_ARENA_COUNT> blocks;
+        std::mutex                                 blocksMutex;
+    } // namespace
+
+    std::expected<RequestArena, esp_err_t> RequestArena::acquire() {
+        std::lock_guard lock(blocksMutex);
+        for (auto& block: blocks) {
+            if (!block.inUse) {
+                block.inUse = true;
+                return RequestArena(block.memory.data());
+            }
+        }
+        return std::unexpected(ESP_ERR_NO_MEM);
+    }
+
+    std::size_t RequestArena::available() {
+        std::lock_guard lock(blocksMutex);
+        return std::count_if(blocks.begin(), blocks.end(), [](const Block& block) { return !block.inUse; });
+    }
+
+    RequestArena::RequestArena(RequestArena&& other) noexcept
+        : m_memory(std::exchange(other.m_memory, nullptr)), m_used(std::exchange(other.m_used, 0)), m_objects(other.m_objects), m_count(std::exchange(other.m_count, 0)) {}
+
+    RequestArena::~RequestArena() {
+        if (m_memory == nullptr) {
+            return;
+        }
+        // Objects may refer to the ones made before them
+        while (m_count > 0) {
+            const auto& [object, destroy] = m_objects[--m_count];
+            destroy(object);
+        }
+        std::lock_guard lock(blocksMutex);
+        for (auto& block: blocks) {
+            if (block.memory.data() == m_memory) {
+                block.inUse = false;
+                break;
+            }
+        }
+    }
+
+} // namespace sdk::Http
@@ -0,0 +1,196 @@
+#include "WebSocket.hpp"
+
+#include <esp_log.h>
+
+#include <algorithm>
+
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+
+namespace sdk::Http {
+
+    esp_err_t WebSocketEndpoint::broadcast(const std::string_view message) {
+        if (m_server == nullptr) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        // Serialized once, every client queue shares the same frame
+        const Frame frame = std::make_shared<const std::string>(message);
+
+        std::lock_guard lock(m_mutex);
+        for (auto& client: m_clients) {
+            if (client.socket >= 0) {
+                enqueue(client, frame);
+            }
+        }
+        return ESP_OK;
+    }
+
+    esp_err_t WebSocketEndpoint::send(const int socket, const std::string_view message) {
+        if (m_server == nullptr) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        const Frame frame = std::make_shared<const std::string>(message);
+
+        std::lock_guard lock(m_mutex);
+        auto*           client = findClient(socket);
+        if (client == nullptr) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        enqueue(*client, frame);
+        return ESP_OK;
+    }
+
+    size_t WebSocketEndpoint::clientCount() {
+        std::lock_guard lock(m_mutex);
+        return std::count_if(m_clients.begin(), m_clients.end(), [](const Client& client) { return client.socket >= 0; });
+    }
+
+    uint32_t WebSocketEndpoint::droppedFrames() {
+        std::lock_guard lock(m_mutex);
+        return m_droppedFrames;
+    }
+
+    void WebSocketEndpoint::enqueue(Client& client, const Frame& frame) {
+        if (client.queue.full()) {
+            // The circular buffer overwrites the oldest frame
+            m_droppedFrames++;
+        }
+        client.queue.push(frame);
+        if (!client.sending) {
+            client.sending = httpd_queue_work(m_server, sendQueued, &client) == ESP_OK;
+        }
+    }
+
+    void WebSocketEndpoint::sendQueued(void* argument) {
+        auto& client   = *static_cast<Client*>(argument);
+        auto& endpoint = *client.endpoint;
+
+        while (true) {
+            Frame frame;
+            int   socket;
+            {
+                std::lock_guard lock(endpoint.m_mutex);
+                if (client.socket < 0 || client.queue.empty()) {
+                    client.sending = false;
+                    return;
+                }
+                frame  = client.queue.front();
+                socket = client.socket;
+                client.queue.pop();
+            }
+
+            httpd_ws_frame_t packet = {
+                    .final      = true,
+                    .fragmented = false,
+                    .type       = HTTPD_WS_TYPE_TEXT,
+                    .payload    = reinterpret_cast<uint8_t*>(const_cast<char*>(frame->data())),
+                    .len        = frame->size(),
+            };
+            if (httpd_ws_get_fd_info(endpoint.m_server, socket) != HTTPD_WS_CLIENT_WEBSOCKET ||
+                httpd_ws_send_frame_async(endpoint.m_server, socket, &packet) != ESP_OK) {
+                ESP_LOGD(TAG, "Sending to client %d failed, closing it", socket);
+                {
+                    std::lock_guard lock(endpoint.m_mutex);
+                    client.sending = false;
+                    client.queue.clear();
+                }
+                // The slot stays taken until the session is gone and httpd calls releaseClient()
+                httpd_sess_trigger_close(endpoint.m_server, socket);
+                return;
+            }
+        }
+    }
+
+    bool WebSocketEndpoint::addClient(httpd_req_t* req) {
+        const int       socket = httpd_req_to_sockfd(req);
+        std::lock_guard lock(m_mutex);
+        if (findClient(socket) != nullptr) {
+            return true;
+        }
+        for (auto& client: m_clients) {
+            if (client.socket < 0 && !client.sending) {
+                client.endpoint = this;
+                client.socket   = socket;
+                // httpd frees the session context when the connection closes, however it closes
+                req->sess_ctx = &client;
+                req->free_ctx = releaseClient;
+                ESP_LOGD(TAG, "Client %d connected", socket);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void WebSocketEndpoint::releaseClient(void* context) {
+        auto& client = *static_cast<Client*>(context);
+        if (client.endpoint == nullptr) {
+            return;
+        }
+        std::lock_guard lock(client.endpoint->m_mutex);
+        ESP_LOGD(TAG, "Client %d disconnected", client.socket);
+        // A pending sendQueued() sees the socket is gone and frees the slot by clearing sending
+        client.socket = -1;
+        client.queue.clear();
+    }
+
+    void WebSocketEndpoint::sendFull(httpd_req_t* req) {
+        // Close frames start with the status code in network byte order
+        std::array<uint8_t, 2> status{1013 >> 8, 1013 & 0xff};
+        httpd_ws_frame_t       packet{};
+        packet.final   = true;
+        packet.type    = HTTPD_WS_TYPE_CLOSE;
+        packet.payload = status.data();
+        packet.len     = status.size();
+        httpd_ws_send_frame(req, &packet);
+    }
+
+    WebSocketEndpoint::Client* WebSocketEndpoint::findClient(const int socket) {
+        for (auto& client: m_clients) {
+            if (client.socket == socket) {
+                return &client;
+            }
+        }
+        return nullptr;
+    }
+
+    esp_err_t WebSocketEndpoint::handler(httpd_req_t* req) {
+        assert(req->user_ctx != nullptr && "User context is null");
+        auto& endpoint = *static_cast<WebSocketEndpoint*>(req->user_ctx);
+
+        // The handshake is done by httpd, after which the handler is called once with the GET request
+        if (req->method == HTTP_GET) {
+            if (!endpoint.addClient(req)) {
+                ESP_LOGW(TAG, "Too many clients, closing %d", httpd_req_to_sockfd(req));
+                sendFull(req);
+                // httpd closes the session when the handler fails
+                return ESP_FAIL;
+            }
+            return ESP_OK;
+        }
+
+        // Get the length first, the payload is received straight into the message
+        httpd_ws_frame_t packet{};
+        if (const auto err = httpd_ws_recv_frame(req, &packet, 0); err != ESP_OK) {
+            return err;
+        }
+        if (packet.len > CONFIG_HTTP_WS_MAX_FRAME_SIZE) {
+            ESP_LOGW(TAG, "Frame of %zu bytes is too large", packet.len);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        etl::string<CONFIG_HTTP_WS_MAX_FRAME_SIZE> message;
+        message.uninitialized_resize(packet.len);
+        packet.payload = reinterpret_cast<uint8_t*>(message.data());
+        if (packet.len > 0) {
+            if (const auto err = httpd_ws_recv_frame(req, &packet, packet.len); err != ESP_OK) {
+                return err;
+            }
+        }
+
+        if (packet.type == HTTPD_WS_TYPE_TEXT && endpoint.m_onMessage) {
+            endpoint.m_onMessage(httpd_req_to_sockfd(req), std::string_view(message.data(), message.size()), endpoint.m_userContext);
+        }
+        return ESP_OK;
+    }
+
+} // namespace sdk::Http
+
+#endif /* CONFIG_HTTPD_WS_SUPPORT */
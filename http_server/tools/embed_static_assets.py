@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""
+Compress a directory of static files and generate the index for sdk::Http::staticAssets().
+
+Every file is gzipped into <output>/static_asset_<n>.gz, which the build embeds with target_add_binary_data().
+The generated source refers to the resulting _binary_..._start/_end symbols, so the data is served straight from flash.
+The list of compressed files is printed, one per line, for CMake to pick up.
+"""
+
+import argparse
+import gzip
+import mimetypes
+import zlib
+from pathlib import Path
+
+# Types that mimetypes does not know, or gets wrong, on some hosts
+CONTENT_TYPES = {
+    ".html": "text/html",
+    ".js": "application/javascript",
+    ".mjs": "application/javascript",
+    ".css": "text/css",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".ico": "image/x-icon",
+    ".woff2": "font/woff2",
+    ".webmanifest": "application/manifest+json",
+}
+
+
+def content_type(path: Path) -> str:
+    if path.suffix in CONTENT_TYPES:
+        return CONTENT_TYPES[path.suffix]
+    guessed, _ = mimetypes.guess_type(path.name)
+    return guessed or "application/octet-stream"
+
+
+def c_string(value: str) -> str:
+    return '"' + value.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("directory", type=Path, help="Directory with the files to serve")
+    parser.add_argument("output", type=Path, help="Directory for the compressed files and generated source")
+    args = parser.parse_args()
+
+    args.output.mkdir(parents=True, exist_ok=True)
+    files = sorted(path for path in args.directory.rglob("*") if path.is_file())
+
+    assets = []
+    for index, path in enumerate(files):
+        # mtime=0 keeps the output, and with it the ETag, identical between builds
+        compressed = gzip.compress(path.read_bytes(), compresslevel=9, mtime=0)
+        gz_path = args.output / f"static_asset_{index}.gz"
+        if not gz_path.exists() or gz_path.read_bytes() != compressed:
+            gz_path.write_bytes(compressed)
+        assets.append({
+            "path": "/" + path.relative_to(args.directory).as_posix(),
+            "type": content_type(path),
+            "symbol": f"static_asset_{index}_gz",
+            "etag": f'"{zlib.crc32(compressed):08x}"',
+            "file": gz_path,
+        })
+    # The server looks paths up with a binary search
+    assets.sort(key=lambda asset: asset["path"])
+
+    lines = ['#include "StaticAssets.hpp"', ""]
+    for asset in assets:
+        lines.append(f'extern const uint8_t {asset["symbol"]}_start[] asm("_binary_{asset["symbol"]}_start");')
+        lines.append(f'extern const uint8_t {asset["symbol"]}_end[] asm("_binary_{asset["symbol"]}_end");')
+    lines += ["", "namespace sdk::Http {", ""]
+    if assets:
+        lines.append("    static const StaticAsset assets[] = {")
+        for asset in assets:
+            lines.append(f'            {{{c_string(asset["path"])}, {c_string(asset["type"])}, '
+                         f'{asset["symbol"]}_start, {asset["symbol"]}_end, {c_string(asset["etag"])}}},')
+        lines += ["    };", "", "    std::span<const StaticAsset> staticAssets() {", "        return assets;", "    }"]
+    else:
+        lines += ["    std::span<const StaticAsset> staticAssets() {", "        return {};", "    }"]
+    lines += ["", "} // namespace sdk::Http", ""]
+
+    source = "\n".join(lines)
+    source_path = args.output / "static_assets.cpp"
+    if not source_path.exists() or source_path.read_text() != source:
+        source_path.write_text(source)
+
+    for asset in assets:
+        print(asset["file"].as_posix())
+
+
+if __name__ == "__main__":
+    main()
@@ -9,6 +9,7 @@
 #include <etl/vector.h>
 #include <result.h>
 
+#include <functional>
 #include <thread>
 
 #include "Component.hpp"
@@ -55,6 +56,12 @@ namespace sdk {
          */
         static std::expected<bool, esp_err_t> isComponentInitialized(const char* tag);
 
+        /**
+         * @brief Visit every added component, in the order they were added
+         * @param visitor Called with the component and whether the manager considers it active
+         */
+        static void forEachComponent(const std::function<void(Component& component, bool active)>& visitor);
+
         /**
          * @brief   Handler for rebooting the device. Attempts to gracefully stop all components before shutdown/reboot
          */
@@ -1,5 +1,7 @@
 #include "../include/Manager.hpp"
 
+#include <mutex>
+
 #include "esp_log.h"
 #include "esp_system_error.hpp"
 #include "freertos/FreeRTOS.h"
@@ -9,8 +11,28 @@ namespace sdk {
 
     static etl::vector<componentEntry, CONFIG_NUM_COMPONENTS> m_components{};
     static bool                                               m_running{false};
+    // Guards m_components, the manager task updates the active flags while other tasks visit the components.
+    // Entries are never removed and etl::vector doesn't reallocate, so a Component reference stays valid without it.
+    static std::mutex m_mutex;
+
+    /**
+     * @brief Copy of the components, so they can be called without holding m_mutex
+     */
+    static etl::vector<componentEntry, CONFIG_NUM_COMPONENTS> components() {
+        std::lock_guard lock(m_mutex);
+        return m_components;
+    }
+
+    /**
+     * @brief Set whether the manager considers a component active
+     */
+    static void setActive(componentEntry& entry, const bool active) {
+        std::lock_guard lock(m_mutex);
+        entry.first = active;
+    }
 
     void Manager::addComponent(Component& ref) {
+        std::lock_guard lock(m_mutex);
         assert(!m_components.full());
         m_components.emplace_back(etl::pair{false, std::reference_wrapper<Component>(ref)});
     }
@@ -46,7 +68,7 @@ namespace sdk {
     }
 
     void Manager::stopAll() {
-        for (auto& entry: m_components) {
+        for (auto& entry: components()) {
             // entry.first is a bool that describes whether the component is active
             const bool& componentActive = entry.first;
             Component&  component       = entry.second;
@@ -65,6 +87,7 @@ namespace sdk {
     }
 
     bool Manager::isInitialized() {
+        std::lock_guard lock(m_mutex);
         return std::ranges::all_of(m_components.begin(), m_components.end(),
                                    [&](const componentEntry& entry) {
                                        return entry.first;
@@ -72,7 +95,8 @@ namespace sdk {
     }
 
     std::expected<bool, esp_err_t> Manager::isComponentInitialized(const char* tag) {
-        auto it = std::find_if(m_components.begin(), m_components.end(), [&](componentEntry& entry) {
+        std::lock_guard lock(m_mutex);
+        auto            it = std::find_if(m_components.begin(), m_components.end(), [&](componentEntry& entry) {
             return entry.second.get().getTag() == tag;
         });
 
@@ -83,14 +107,27 @@ namespace sdk {
         }
     }
 
+    void Manager::forEachComponent(const std::function<void(Component& component, bool active)>& visitor) {
+        for (auto& entry: components()) {
+            // entry.first is a bool that describes whether the component is active
+            visitor(entry.second.get(), entry.first);
+        }
+    }
+
     void Manager::run(void*) {
         ESP_LOGD(TAG, "Starting Manager::run()");
 
         while (m_running) {
-            for (auto& entry: m_components) {
-                // entry.first is a bool that describes whether the component is active
-                bool&      componentActive = entry.first;
-                Component& component       = entry.second;
+            std::size_t count;
+            {
+                std::lock_guard lock(m_mutex);
+                count = m_components.size();
+            }
+            for (std::size_t i = 0; i < count; ++i) {
+                // Only this task writes the active flags, so they are read without m_mutex
+                componentEntry& entry           = m_components[i];
+                const bool      componentActive = entry.first;
+                Component&      component       = entry.second;
                 if (componentActive) {
                     if (component.run() == Component::Status::ERROR) {
                         ESP_LOGW(TAG, "Component %s reported an error: %s, attempting to restart",
@@ -113,15 +150,16 @@ namespace sdk {
     }
 
     bool Manager::initComponent(componentEntry& entry) {
-        auto& component        = entry.second.get();
-        bool& componentRunning = entry.first;
-        auto  status           = component.initialize();
+        auto& component = entry.second.get();
+        auto  status    = component.initialize();
         if (status == Component::Status::RUNNING) {
             ESP_LOGI(TAG, "Initialized component: %s", component.getTag().c_str());
-            return componentRunning = true;
+            setActive(entry, true);
+            return true;
         } else {
             ESP_LOGE(TAG, "Component %s failed to start", component.getTag().c_str());
-            return componentRunning = false;
+            setActive(entry, false);
+            return false;
         }
     }
 
@@ -132,7 +170,7 @@ namespace sdk {
         if (stopStatus == Component::Status::ERROR) {
             ESP_LOGE(TAG, "Failed to stop component %s: %s",
                      component.getTag().c_str(), component.getError()->c_str());
-            entry.first = false;
+            setActive(entry, false);
             return;
         }
 
@@ -140,11 +178,11 @@ namespace sdk {
         if (initStatus == Component::Status::ERROR) {
             ESP_LOGE(TAG, "Failed to re-initialize component %s: %s",
                      component.getTag().c_str(), component.getError()->c_str());
-            entry.first = false;
+            setActive(entry, false);
             return;
         }
 
-        entry.first = true;
+        setActive(entry, true);
     }
 
     void Manager::shutdownHandler() {
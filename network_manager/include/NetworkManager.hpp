@@ -7,6 +7,7 @@
 #include <esp_err.h>
 #include <esp_log.h>
 
+#include <mutex>
 #include <string>
 
 namespace sdk {
@@ -46,7 +47,14 @@ namespace sdk {
             }
         };
 
-        NetworkManager() = default;
+        /**
+         * @brief Binds the config in the ConfigRegistry, only to reload it after a snapshot import, it is not exposed to clients
+         */
+        NetworkManager();
+        ~NetworkManager();
+
+        NetworkManager(const NetworkManager&)            = delete;
+        NetworkManager& operator=(const NetworkManager&) = delete;
 
         /* Component override functions */
         etl::string<50> getTag() override { return TAG; };
@@ -54,13 +62,24 @@ namespace sdk {
         Status          run() override;
         Status          stop() override;
 
-        /* state = true for DHCP, false for static IP */
+        /* state = true for DHCP, false for static IP
+         * DHCP only skips the DISCOVER/OFFER exchange after a reboot with CONFIG_LWIP_DHCP_RESTORE_LAST_IP,
+         * which CONFIG_NETWORK_MANAGER_DHCP_RESTORE_LAST_IP selects */
         res  setIpMode(bool state);
         res  setStationState(bool state);
         void setStationConfig(const nlohmann::json& config);
         res  setAccessPointState(bool state);
         void setAccessPointConfig(const nlohmann::json& config);
 
+        /**
+         * @brief Updates the station, access point and network configs and saves them in a single transaction
+         * @param stationConfig Json merge patch for the station config
+         * @param accessPointConfig Json merge patch for the access point config
+         * @param networkConfig Json merge patch for the network manager config
+         * @return Error code of type esp_err_t, on error none of the configs are saved or changed
+         */
+        std::error_code provision(const nlohmann::json& stationConfig, const nlohmann::json& accessPointConfig, const nlohmann::json& networkConfig);
+
         void initSNTP();
 
         static bool validateIP(etl::string<50> ip_addr);
@@ -69,10 +88,17 @@ namespace sdk {
     private:
         static const inline char TAG[] = "Network Manager";
 
-        Config m_config;
+        // Guards m_config, provision() updates it from the calling task while the component task reads it
+        std::mutex m_configMutex;
+        Config     m_config;
 
         wifi::AccessPoint m_accessPoint;
         wifi::Station     m_station;
+
+        /**
+         * @brief Loads the config again after a snapshot import replaced it
+         */
+        std::expected<ConfigRegistry::PatchSummary, std::error_code> reloadConfig();
     };
 
 } // namespace sdk
@@ -12,6 +12,18 @@ namespace sdk {
     using Status = Component::Status;
     using res    = Component::res;
 
+    NetworkManager::NetworkManager() {
+        ConfigRegistry::bind({
+                .key    = Config::key(),
+                .owner  = this,
+                .reload = [](void* owner) { return static_cast<NetworkManager*>(owner)->reloadConfig(); },
+        });
+    }
+
+    NetworkManager::~NetworkManager() {
+        ConfigRegistry::unbind(Config::key(), this);
+    }
+
     Status NetworkManager::run() {
         return Status::RUNNING;
     }
@@ -62,7 +74,12 @@ namespace sdk {
                     ESP_LOGE(TAG, "Error connecting to WiFi");
                     return Status::ERROR;
                 }
-                return setIpMode(m_config.dhcpEnable);
+                bool dhcpEnable = true;
+                {
+                    std::lock_guard lock(m_configMutex);
+                    dhcpEnable = m_config.dhcpEnable;
+                }
+                return setIpMode(dhcpEnable);
             }
             return ret;
         } else
@@ -73,8 +90,44 @@ namespace sdk {
         m_station.setConfig(config);
     }
 
+    std::error_code NetworkManager::provision(const nlohmann::json& stationConfig, const nlohmann::json& accessPointConfig, const nlohmann::json& networkConfig) {
+        ConfigTransaction transaction;
+
+        if (auto err = m_station.setConfig(stationConfig, transaction)) {
+            return err;
+        }
+        if (auto err = m_accessPoint.setConfig(accessPointConfig, transaction)) {
+            return err;
+        }
+
+        std::unique_lock lock(m_configMutex);
+        const auto       staged = m_config.stagePatch(networkConfig, transaction);
+        lock.unlock();
+        if (!staged) {
+            ESP_LOGE(TAG, "Invalid network config: %s", staged.error().message().c_str());
+            return staged.error();
+        }
+        if (!staged->changedKeys.empty()) {
+            // Nothing changes in memory unless every component's config was committed
+            if (auto err = transaction.onCommit([this, networkConfig] {
+                    std::lock_guard lock(m_configMutex);
+                    m_config.applyPatch(networkConfig);
+                })) {
+                return err;
+            }
+        }
+
+        if (auto err = transaction.commit()) {
+            ESP_LOGE(TAG, "Error saving provisioned config: %s", err.message().c_str());
+            return err;
+        }
+        return {};
+    }
+
     res NetworkManager::setIpMode(bool state) {
         if (state) {
+            // With CONFIG_LWIP_DHCP_RESTORE_LAST_IP the client first requests the address it had before the reboot,
+            // which the server confirms in one exchange instead of a full DISCOVER/OFFER/REQUEST/ACK
             auto ret = esp_netif_dhcpc_start(m_station.getNetif());
             if (ret != ESP_OK && ret != ESP_ERR_ESP_NETIF_DHCP_ALREADY_STARTED) {
                 ESP_LOGE(TAG, "Error starting DHCP client: %s", esp_err_to_name(ret));
@@ -88,6 +141,7 @@ namespace sdk {
                 ESP_LOGE(TAG, "Error stopping DHCP client: %s", esp_err_to_name(ret));
                 return std::unexpected(std::make_error_code(ret));
             } else {
+                std::lock_guard     lock(m_configMutex);
                 esp_netif_ip_info_t ip4Conf;
                 inet_pton(AF_INET, m_config.ipv4Address.value().c_str(), &ip4Conf.ip);
                 inet_pton(AF_INET, m_config.ipv4Gateway.value().c_str(), &ip4Conf.gw);
@@ -121,7 +175,18 @@ namespace sdk {
         return Status::RUNNING;
     }
 
+    std::expected<ConfigRegistry::PatchSummary, std::error_code> NetworkManager::reloadConfig() {
+        std::lock_guard lock(m_configMutex);
+        const auto      reloaded = m_config.reload();
+        if (!reloaded) {
+            ESP_LOGE(TAG, "Error reloading config: %s", reloaded.error().message().c_str());
+            return std::unexpected(reloaded.error());
+        }
+        return ConfigRegistry::PatchSummary{.changed = reloaded->changedKeys.size(), .restartType = reloaded->restartType};
+    }
+
     void NetworkManager::initSNTP() {
+        std::lock_guard lock(m_configMutex);
         esp_sntp_setservername(0, m_config.sntpHost.value().c_str());
         esp_sntp_init();
     }
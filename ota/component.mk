@@ -0,0 +1,2 @@
+COMPONENT_SRCDIRS:=src
+COMPONENT_ADD_INCLUDEDIRS:=include
\ No newline at end of file
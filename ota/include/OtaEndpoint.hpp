@@ -0,0 +1,89 @@
+#ifndef OTA_ENDPOINT_HPP
+#define OTA_ENDPOINT_HPP
+
+#include <esp_ota_ops.h>
+
+#include "HttpServer.hpp"
+#include "OtaUpdate.hpp"
+
+namespace sdk::Ota {
+
+    /**
+     * @brief Writes updates to the next OTA partition of the device
+     */
+    class PartitionTarget final : public Target {
+    public:
+        esp_err_t begin(size_t size) override;
+        esp_err_t write(std::span<const uint8_t> data) override;
+        esp_err_t end() override;
+        esp_err_t activate() override;
+        void      abort() override;
+
+    private:
+        static constexpr char TAG[] = "OTA PARTITION";
+
+        const esp_partition_t* m_partition = nullptr;
+        esp_ota_handle_t       m_handle    = 0;
+    };
+
+    /**
+     * @brief Firmware upload over HTTP
+     *
+     *        The image is the raw body of a POST request, its SHA-256 is passed as the sha256 query parameter:
+     *        @code
+     *        curl --data-binary @firmware.bin "http://device/api/ota?sha256=$(sha256sum firmware.bin | cut -d' ' -f1)"
+     *        @endcode
+     *        The body is written to flash in chunks of CONFIG_OTA_CHUNK_SIZE bytes as it arrives, on an async worker so
+     *        the httpd task keeps serving other clients. Once the image is verified, the response is sent, the
+     *        components are stopped with Manager::stopAll() and the device restarts.
+     *
+     *        The SHA-256 only shows the image arrived intact, not who built it. Either the bootloader checks the
+     *        signature of the image (CONFIG_SECURE_SIGNED_ON_UPDATE), or the endpoint needs an Authorize hook.
+     */
+    class Endpoint {
+    public:
+        /**
+         * @brief Decides whether a request may install firmware, such as by checking its Authorization header.
+         * @param req The upload request, before any of the image is written.
+         * @return True if the request may install firmware.
+         */
+        using Authorize = bool (*)(httpd_req_t* req);
+
+        /**
+         * @brief Register the upload route.
+         * @tparam PATH The path to accept images on.
+         * @param server The server to register the route with.
+         * @param authorize Check run for every upload, required unless signed images are enforced.
+         * @return An error code if the route could not be registered, ESP_ERR_NOT_SUPPORTED if an unsigned image
+         *         could be installed by anyone.
+         */
+        template<StringLiteral PATH = "/api/ota">
+        static std::error_code registerEndpoint(Http::Server& server, Authorize authorize = nullptr) {
+#ifndef CONFIG_SECURE_SIGNED_ON_UPDATE
+            if (authorize == nullptr) {
+                ESP_LOGE(TAG, "Refusing to accept unsigned images without an Authorize hook");
+                return std::make_error_code(ESP_ERR_NOT_SUPPORTED);
+            }
+#endif
+            m_authorize = authorize;
+            return server.registerUpload<PATH, 1, 1, 64>(&upload, {"sha256"}, {}, nullptr, true);
+        }
+
+    private:
+        static constexpr char TAG[] = "OTA";
+
+        static inline Authorize m_authorize = nullptr;
+
+        using Result = std::expected<etl::string<64>, Http::Server::Error>;
+
+        static Result upload(const Http::Server::Uri& uri, Http::BodyReader& body, const Http::QueryParameters<1>& parameters, void* userContext);
+
+        /**
+         * @brief Stop the components and restart after CONFIG_OTA_RESTART_DELAY, so the response reaches the client first.
+         */
+        static void scheduleRestart();
+    };
+
+} // namespace sdk::Ota
+
+#endif /* OTA_ENDPOINT_HPP */
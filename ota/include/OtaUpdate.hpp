@@ -0,0 +1,239 @@
+#ifndef OTA_UPDATE_HPP
+#define OTA_UPDATE_HPP
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <mbedtls/sha256.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace sdk::Ota {
+
+    /**
+     * @brief SHA-256 of a firmware image
+     */
+    using Digest = std::array<uint8_t, 32>;
+
+    /**
+     * @brief Parse a SHA-256 written as 64 hex digits, like sha256sum prints it.
+     * @param hex The digits, upper or lower case.
+     * @return The digest, std::nullopt if hex is not a SHA-256.
+     */
+    inline std::optional<Digest> parseDigest(const std::string_view hex) {
+        const auto nibble = [](const char c) -> int {
+            if (c >= '0' && c <= '9') {
+                return c - '0';
+            }
+            if (c >= 'a' && c <= 'f') {
+                return c - 'a' + 10;
+            }
+            if (c >= 'A' && c <= 'F') {
+                return c - 'A' + 10;
+            }
+            return -1;
+        };
+
+        if (hex.size() != std::tuple_size_v<Digest> * 2) {
+            return std::nullopt;
+        }
+        Digest digest{};
+        for (size_t i = 0; i < digest.size(); i++) {
+            const int high = nibble(hex[2 * i]);
+            const int low  = nibble(hex[2 * i + 1]);
+            if (high < 0 || low < 0) {
+                return std::nullopt;
+            }
+            digest[i] = static_cast<uint8_t>(high << 4 | low);
+        }
+        return digest;
+    }
+
+    /**
+     * @brief Where an update is written to, the next OTA partition on a device, see PartitionTarget
+     */
+    class Target {
+    public:
+        virtual ~Target() = default;
+
+        /**
+         * @brief Prepare for an image.
+         * @param size Size of the image in bytes.
+         * @return Error code of type esp_err_t, ESP_ERR_INVALID_SIZE if the image does not fit.
+         */
+        virtual esp_err_t begin(size_t size) = 0;
+
+        /**
+         * @brief Write the next part of the image.
+         */
+        virtual esp_err_t write(std::span<const uint8_t> data) = 0;
+
+        /**
+         * @brief Finish writing and validate the image, including its signature when signed apps are enabled.
+         */
+        virtual esp_err_t end() = 0;
+
+        /**
+         * @brief Boot the image on the next restart.
+         */
+        virtual esp_err_t activate() = 0;
+
+        /**
+         * @brief Drop an image that was begun but not ended.
+         */
+        virtual void abort() = 0;
+    };
+
+    /**
+     * @brief Writes a firmware image to a Target as it arrives, hashing it along the way
+     *
+     *        Only the chunk passed to write() is in memory at any time. The image is activated by finish(), once
+     *        its size and SHA-256 match what was announced and the Target validated it. An update that is destroyed
+     *        before that is aborted, so the running firmware stays in place.
+     */
+    class Update {
+    public:
+        /**
+         * @param target Where to write the image, must outlive the update.
+         * @param size Size of the image in bytes, as announced by the sender.
+         * @param expected SHA-256 of the image, as announced by the sender.
+         */
+        Update(Target& target, const size_t size, const Digest& expected) : m_target(target), m_size(size), m_expected(expected) {
+            mbedtls_sha256_init(&m_hash);
+        }
+
+        Update(const Update&)            = delete;
+        Update& operator=(const Update&) = delete;
+
+        ~Update() {
+            if (m_state == State::WRITING) {
+                ESP_LOGW(TAG, "Update aborted after %zu of %zu bytes", m_written, m_size);
+                m_target.abort();
+            }
+            mbedtls_sha256_free(&m_hash);
+        }
+
+        /**
+         * @brief Start the update.
+         * @return Error code of type esp_err_t, ESP_ERR_INVALID_SIZE for an empty image or one that does not fit.
+         */
+        esp_err_t begin() {
+            if (m_state != State::IDLE) {
+                return ESP_ERR_INVALID_STATE;
+            }
+            if (m_size == 0) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            if (const auto err = m_target.begin(m_size); err != ESP_OK) {
+                ESP_LOGE(TAG, "Can't start an update of %zu bytes: %s", m_size, esp_err_to_name(err));
+                return fail(err);
+            }
+            if (mbedtls_sha256_starts(&m_hash, 0) != 0) {
+                m_target.abort();
+                return fail(ESP_FAIL);
+            }
+            m_state = State::WRITING;
+            return ESP_OK;
+        }
+
+        /**
+         * @brief Write the next part of the image.
+         * @param data Any amount of bytes, chunks the size of a flash sector are the most efficient.
+         * @return Error code of type esp_err_t, ESP_ERR_INVALID_SIZE if the image grows beyond its announced size.
+         */
+        esp_err_t write(const std::span<const uint8_t> data) {
+            if (m_state != State::WRITING) {
+                return m_state == State::FAILED ? m_error : ESP_ERR_INVALID_STATE;
+            }
+            if (data.size() > m_size - m_written) {
+                ESP_LOGE(TAG, "Image is larger than the announced %zu bytes", m_size);
+                return abort(ESP_ERR_INVALID_SIZE);
+            }
+            if (mbedtls_sha256_update(&m_hash, data.data(), data.size()) != 0) {
+                return abort(ESP_FAIL);
+            }
+            if (const auto err = m_target.write(data); err != ESP_OK) {
+                ESP_LOGE(TAG, "Error writing at %zu: %s", m_written, esp_err_to_name(err));
+                return abort(err);
+            }
+            m_written += data.size();
+            return ESP_OK;
+        }
+
+        /**
+         * @brief Verify the image and boot it on the next restart.
+         * @return Error code of type esp_err_t, ESP_ERR_INVALID_SIZE if bytes are missing, ESP_ERR_INVALID_CRC if
+         *         the SHA-256 does not match, or the error of the Target when the image itself is invalid.
+         */
+        esp_err_t finish() {
+            if (m_state != State::WRITING) {
+                return m_state == State::FAILED ? m_error : ESP_ERR_INVALID_STATE;
+            }
+            if (m_written != m_size) {
+                ESP_LOGE(TAG, "Image incomplete, %zu of %zu bytes", m_written, m_size);
+                return abort(ESP_ERR_INVALID_SIZE);
+            }
+            Digest digest{};
+            if (mbedtls_sha256_finish(&m_hash, digest.data()) != 0) {
+                return abort(ESP_FAIL);
+            }
+            if (digest != m_expected) {
+                ESP_LOGE(TAG, "SHA-256 of the image does not match");
+                return abort(ESP_ERR_INVALID_CRC);
+            }
+            // Ending the target frees it, so it must not be aborted anymore from here on
+            m_state = State::FAILED;
+            if (const auto err = m_target.end(); err != ESP_OK) {
+                ESP_LOGE(TAG, "Image rejected: %s", esp_err_to_name(err));
+                return m_error = err;
+            }
+            if (const auto err = m_target.activate(); err != ESP_OK) {
+                ESP_LOGE(TAG, "Error activating the image: %s", esp_err_to_name(err));
+                return m_error = err;
+            }
+            m_state = State::DONE;
+            ESP_LOGI(TAG, "Update of %zu bytes verified, boots on the next restart", m_size);
+            return ESP_OK;
+        }
+
+        /**
+         * @brief Get the amount of bytes written so far.
+         */
+        [[nodiscard]] size_t written() const { return m_written; }
+
+    private:
+        static constexpr char TAG[] = "OTA";
+
+        enum class State {
+            IDLE,
+            WRITING,
+            DONE,
+            FAILED,
+        };
+
+        Target&                m_target;
+        const size_t           m_size;
+        const Digest           m_expected;
+        mbedtls_sha256_context m_hash{};
+        size_t                 m_written = 0;
+        State                  m_state   = State::IDLE;
+        esp_err_t              m_error   = ESP_OK;
+
+        esp_err_t fail(const esp_err_t err) {
+            m_state = State::FAILED;
+            return m_error = err;
+        }
+
+        esp_err_t abort(const esp_err_t err) {
+            m_target.abort();
+            return fail(err);
+        }
+    };
+
+} // namespace sdk::Ota
+
+#endif /* OTA_UPDATE_HPP */
@@ -0,0 +1,131 @@
+#include "OtaEndpoint.hpp"
+
+#include <esp_log.h>
+#include <esp_system.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <array>
+#include <cinttypes>
+#include <mutex>
+
+#include "Manager.hpp"
+
+namespace sdk::Ota {
+
+    namespace {
+        // One update at a time, which also guards the chunk buffer
+        std::mutex updateMutex;
+
+        std::array<char, CONFIG_OTA_CHUNK_SIZE> chunk;
+    } // namespace
+
+    esp_err_t PartitionTarget::begin(const size_t size) {
+        m_partition = esp_ota_get_next_update_partition(nullptr);
+        if (m_partition == nullptr) {
+            ESP_LOGE(TAG, "No OTA partition to update");
+            return ESP_ERR_NOT_FOUND;
+        }
+        if (size > m_partition->size) {
+            ESP_LOGE(TAG, "Image of %zu bytes does not fit in partition %s of %" PRIu32 " bytes", size, m_partition->label, m_partition->size);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        // Sectors are erased as they are reached, instead of the whole partition before the first byte is taken
+        return esp_ota_begin(m_partition, OTA_WITH_SEQUENTIAL_WRITES, &m_handle);
+    }
+
+    esp_err_t PartitionTarget::write(const std::span<const uint8_t> data) {
+        return esp_ota_write(m_handle, data.data(), data.size());
+    }
+
+    esp_err_t PartitionTarget::end() {
+        // Frees the handle, whether or not the image is valid
+        const auto err = esp_ota_end(m_handle);
+        m_handle       = 0;
+        return err;
+    }
+
+    esp_err_t PartitionTarget::activate() {
+        return esp_ota_set_boot_partition(m_partition);
+    }
+
+    void PartitionTarget::abort() {
+        if (m_handle != 0) {
+            esp_ota_abort(m_handle);
+            m_handle = 0;
+        }
+    }
+
+    Endpoint::Result Endpoint::upload(const Http::Server::Uri&, Http::BodyReader& body, const Http::QueryParameters<1>& parameters, void*) {
+        using Http::StatusCode;
+
+        if (m_authorize != nullptr && !m_authorize(body.request())) {
+            ESP_LOGW(TAG, "Unauthorized update refused");
+            return std::unexpected(Http::Server::Error{StatusCode::Unauthorized, "Not authorized"});
+        }
+
+        std::unique_lock lock(updateMutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return std::unexpected(Http::Server::Error{StatusCode::Conflict, "Update in progress"});
+        }
+
+        const auto sha256   = parameters.raw("sha256");
+        const auto expected = sha256 ? parseDigest(*sha256) : std::nullopt;
+        if (!expected) {
+            return std::unexpected(Http::Server::Error{StatusCode::BadRequest, "sha256 missing or invalid"});
+        }
+        if (body.contentLength() == 0) {
+            return std::unexpected(Http::Server::Error{StatusCode::LengthRequired, "Image missing"});
+        }
+
+        PartitionTarget target;
+        Update          update(target, body.contentLength(), *expected);
+        if (const auto err = update.begin(); err != ESP_OK) {
+            if (err == ESP_ERR_INVALID_SIZE) {
+                return std::unexpected(Http::Server::Error{StatusCode::PayloadTooLarge, "Image too large"});
+            }
+            return std::unexpected(Http::Server::Error{StatusCode::InternalServerError, "Can't start update"});
+        }
+
+        while (true) {
+            const auto received = body.read(chunk);
+            if (!received) {
+                return std::unexpected(Http::Server::Error{StatusCode::BadRequest, "Upload interrupted"});
+            }
+            if (*received == 0) {
+                break;
+            }
+            if (const auto err = update.write(std::span(reinterpret_cast<const uint8_t*>(chunk.data()), *received)); err != ESP_OK) {
+                return std::unexpected(Http::Server::Error{StatusCode::InternalServerError, "Error writing image"});
+            }
+        }
+
+        switch (update.finish()) {
+            case ESP_OK:
+                break;
+            case ESP_ERR_INVALID_SIZE:
+                return std::unexpected(Http::Server::Error{StatusCode::BadRequest, "Image incomplete"});
+            case ESP_ERR_INVALID_CRC:
+                return std::unexpected(Http::Server::Error{StatusCode::UnprocessableEntity, "sha256 mismatch"});
+            default:
+                return std::unexpected(Http::Server::Error{StatusCode::UnprocessableEntity, "Invalid image"});
+        }
+
+        scheduleRestart();
+        return "Update installed, restarting";
+    }
+
+    void Endpoint::scheduleRestart() {
+        const auto restart = [](void*) {
+            vTaskDelay(pdMS_TO_TICKS(CONFIG_OTA_RESTART_DELAY));
+            ESP_LOGI(TAG, "Restarting into the new firmware");
+            Manager::stopAll();
+            esp_restart();
+        };
+        if (xTaskCreate(restart, "ota restart", CONFIG_OTA_RESTART_TASK_STACK_SIZE, nullptr, 1, nullptr) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create restart task, restarting now");
+            esp_restart();
+        }
+    }
+
+} // namespace sdk::Ota
@@ -0,0 +1,115 @@
+#ifndef NVS_EMULATOR_HPP
+#define NVS_EMULATOR_HPP
+
+#include <esp_log.h>
+#include <esp_private/partition_linux.h>
+#include <esp_timer.h>
+#include <etl/string.h>
+
+#include <cstring>
+
+#include "esp_err.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+
+namespace sdk::test {
+
+    /**
+     * @brief Host side NVS partition, backed by a memory mapped flash image on the Linux target
+     *
+     *        The ESP-IDF Linux target emulates flash by mmap-ing a file, this class points that emulation
+     *        at a known image so tests and benchmarks run against a real NVS layout that survives between runs.
+     */
+    class NvsEmulator {
+    public:
+        /**
+         * @brief Write statistics of the emulated flash, counted since the last call to clearStats()
+         */
+        struct FlashStats {
+            size_t writeOps;
+            size_t writeBytes;
+            size_t eraseOps;
+            size_t readOps;
+            size_t readBytes;
+        };
+
+        /**
+         * @brief Select the flash image to use, call this before anything touches NVS
+         * @param imagePath Path to the flash image, will be created if it does not exist
+         * @param keepImage Keep the image on disk after the test run, so it can be inspected or reused
+         */
+        static void mount(const char* imagePath, bool keepImage = false) {
+            esp_partition_file_mmap_ctrl_t* control = esp_partition_get_file_mmap_ctrl_input();
+            std::strncpy(control->flash_file_name, imagePath, sizeof(control->flash_file_name) - 1);
+            control->remove_dump = !keepImage;
+        }
+
+        /**
+         * @brief Erase the NVS partition and initialize it again, giving each test a clean slate
+         * @return Error code of type esp_err_t
+         */
+        static esp_err_t reset() {
+            nvs_flash_deinit();
+            if (const auto err = nvs_flash_erase(); err != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to erase emulated NVS: %s", esp_err_to_name(err));
+                return err;
+            }
+            return nvs_flash_init();
+        }
+
+        /**
+         * @brief Get the entry statistics of the default NVS partition
+         * @return Used entry count, or 0 on error
+         */
+        static size_t usedEntries() {
+            nvs_stats_t stats{};
+            if (nvs_get_stats(nullptr, &stats) != ESP_OK) {
+                return 0;
+            }
+            return stats.used_entries;
+        }
+
+        /**
+         * @brief Get flash operation statistics of the emulated partition
+         * @note  Requires CONFIG_ESP_PARTITION_ENABLE_STATS, otherwise the byte counts are derived from NVS entry usage
+         */
+        static FlashStats flashStats() {
+#ifdef CONFIG_ESP_PARTITION_ENABLE_STATS
+            return {.writeOps   = esp_partition_get_write_ops(),
+                    .writeBytes = esp_partition_get_write_bytes(),
+                    .eraseOps   = esp_partition_get_erase_ops(),
+                    .readOps    = esp_partition_get_read_ops(),
+                    .readBytes  = esp_partition_get_read_bytes()};
+#else
+            // Every NVS entry is 32 bytes, this misses rewrites of existing entries but gives an estimate
+            const size_t used = usedEntries();
+            return {.writeOps   = 0,
+                    .writeBytes = used > m_baselineEntries ? (used - m_baselineEntries) * NVS_ENTRY_SIZE : 0,
+                    .eraseOps   = 0,
+                    .readOps    = 0,
+                    .readBytes  = 0};
+#endif
+        }
+
+        /**
+         * @brief Reset the flash operation statistics
+         */
+        static void clearStats() {
+#ifdef CONFIG_ESP_PARTITION_ENABLE_STATS
+            esp_partition_clear_stats();
+#else
+            m_baselineEntries = usedEntries();
+#endif
+        }
+
+    private:
+        static constexpr char TAG[] = "NVS EMULATOR";
+
+        static constexpr size_t NVS_ENTRY_SIZE = 32;
+
+        static inline size_t m_baselineEntries = 0;
+    };
+
+} // namespace sdk::test
+
+#endif // NVS_EMULATOR_HPP
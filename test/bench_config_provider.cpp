@@ -0,0 +1,114 @@
+#include "../../config_provider/include/ConfigProvider.hpp"
+#include "NvsEmulator.hpp"
+
+#include <esp_timer.h>
+
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <cstdio>
+
+using namespace sdk;
+
+namespace {
+    constexpr char NAMESPACE[] = "bench";
+    constexpr char KEY[]       = "object";
+    constexpr int  ITERATIONS  = 100;
+
+    /**
+     * @brief Timing results of a single measured operation, in microseconds
+     */
+    struct Measurement {
+        int64_t min;
+        int64_t median;
+        int64_t max;
+    };
+
+    template<size_t N>
+    Measurement summarize(std::array<int64_t, N>& samples) {
+        std::sort(samples.begin(), samples.end());
+        return {.min = samples.front(), .median = samples[N / 2], .max = samples.back()};
+    }
+
+    /**
+     * @brief Build a json object that serializes to roughly the requested size
+     */
+    nlohmann::json makeObject(size_t targetSize) {
+        nlohmann::json json;
+        for (size_t i = 0; json.dump().size() < targetSize; i++) {
+            json["field_" + std::to_string(i)] = std::string(16, static_cast<char>('a' + i % 26));
+        }
+        json[CONFIG_VERSION_KEY] = "1.0.0";
+        return json;
+    }
+
+    void printMeasurement(const char* name, const Measurement& measurement, bool last = false) {
+        printf("\"%s\":{\"min_us\":%" PRId64 ",\"median_us\":%" PRId64 ",\"max_us\":%" PRId64 "}%s", name,
+               measurement.min, measurement.median, measurement.max, last ? "" : ",");
+    }
+
+    template<size_t BUFFER_SIZE>
+    void benchmarkObjectSize(size_t targetSize, bool last) {
+        std::array<int64_t, ITERATIONS> save{}, commit{}, load{}, parse{};
+        size_t                          bytesWritten = 0;
+
+        test::NvsEmulator::reset();
+        ConfigProvider provider(NAMESPACE, false);
+        provider.initialize();
+
+        auto object = makeObject(targetSize);
+        auto dumped = object.dump();
+
+        for (int i = 0; i < ITERATIONS; i++) {
+            // Change a value every iteration, so NVS can't skip the write
+            object["iteration"] = i;
+
+            test::NvsEmulator::clearStats();
+            int64_t start = esp_timer_get_time();
+            provider.saveJson(KEY, object, false);
+            save[i] = esp_timer_get_time() - start;
+
+            start = esp_timer_get_time();
+            provider.commit();
+            commit[i] = esp_timer_get_time() - start;
+            bytesWritten += test::NvsEmulator::flashStats().writeBytes;
+
+            nlohmann::json loaded;
+            start = esp_timer_get_time();
+            provider.loadJson<BUFFER_SIZE>(KEY, loaded);
+            load[i] = esp_timer_get_time() - start;
+
+            start             = esp_timer_get_time();
+            const auto parsed = nlohmann::json::parse(dumped);
+            parse[i]          = esp_timer_get_time() - start;
+            assert(!parsed.empty());
+        }
+
+        printf("{\"size\":%zu,\"buffer_size\":%zu,\"bytes_written_per_save\":%zu,",
+               dumped.size(), BUFFER_SIZE, bytesWritten / ITERATIONS);
+        printMeasurement("save", summarize(save));
+        printMeasurement("commit", summarize(commit));
+        printMeasurement("load", summarize(load));
+        printMeasurement("parse", summarize(parse), true);
+        printf("}%s\n", last ? "" : ",");
+    }
+} // namespace
+
+extern "C" {
+
+auto app_main(void) -> int {
+    test::NvsEmulator::mount("/tmp/bench_config_provider.bin");
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    printf("[\n");
+    benchmarkObjectSize<128>(64, false);
+    benchmarkObjectSize<512>(384, false);
+    benchmarkObjectSize<1024>(900, false);
+    benchmarkObjectSize<2048>(1800, false);
+    benchmarkObjectSize<4096>(3800, true);
+    printf("]\n");
+
+    return 0;
+}
+
+} /* Extern "C" */
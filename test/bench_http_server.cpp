@@ -0,0 +1,344 @@
+#include "../../http_server/include/HttpServer.hpp"
+
+#include <arpa/inet.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sdk;
+
+namespace {
+    constexpr uint16_t PORT                = 8099;
+    constexpr int      REQUESTS_PER_CLIENT = 200;
+    constexpr size_t   MAX_CONCURRENCY     = 8;
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief A request that the load generator sends over and over
+     */
+    struct Scenario {
+        const char* name;
+        std::string request;
+        // Size of the response or request body the scenario is about, for the output only
+        size_t payload;
+    };
+
+    /**
+     * @brief What one client connection measured
+     */
+    struct ClientResult {
+        std::vector<int64_t> latencies;
+        size_t               errors = 0;
+    };
+
+    /**
+     * @brief Minimal HTTP/1.1 client on a keep-alive connection, enough to read what Http::Server sends
+     *
+     *        Runs on a plain thread instead of a FreeRTOS task, so it only uses the host socket API.
+     */
+    class Connection {
+    public:
+        Connection() : m_socket(socket(AF_INET, SOCK_STREAM, 0)) {
+            sockaddr_in address{};
+            address.sin_family      = AF_INET;
+            address.sin_port        = htons(PORT);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            m_connected             = connect(m_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+            const int noDelay       = 1;
+            setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        }
+
+        Connection(const Connection&)            = delete;
+        Connection& operator=(const Connection&) = delete;
+
+        ~Connection() { close(m_socket); }
+
+        /**
+         * @brief Send a request and read the whole response.
+         * @return The status code, 0 if the connection failed.
+         */
+        int exchange(const std::string& request) {
+            if (!m_connected || !sendAll(request)) {
+                return 0;
+            }
+            return readResponse();
+        }
+
+    private:
+        int         m_socket;
+        bool        m_connected = false;
+        std::string m_buffer;
+
+        bool sendAll(std::string_view data) {
+            while (!data.empty()) {
+                const auto sent = send(m_socket, data.data(), data.size(), MSG_NOSIGNAL);
+                if (sent <= 0) {
+                    return false;
+                }
+                data.remove_prefix(sent);
+            }
+            return true;
+        }
+
+        bool receive() {
+            char       chunk[4096];
+            const auto received = recv(m_socket, chunk, sizeof(chunk), 0);
+            if (received <= 0) {
+                m_connected = false;
+                return false;
+            }
+            m_buffer.append(chunk, received);
+            return true;
+        }
+
+        /**
+         * @brief Wait until the buffer holds a whole line, and take it out without the line ending.
+         */
+        bool takeLine(std::string& line) {
+            size_t end;
+            while ((end = m_buffer.find("\r\n")) == std::string::npos) {
+                if (!receive()) {
+                    return false;
+                }
+            }
+            line = m_buffer.substr(0, end);
+            m_buffer.erase(0, end + 2);
+            return true;
+        }
+
+        bool skip(size_t count) {
+            while (m_buffer.size() < count) {
+                if (!receive()) {
+                    return false;
+                }
+            }
+            m_buffer.erase(0, count);
+            return true;
+        }
+
+        int readResponse() {
+            std::string line;
+            if (!takeLine(line) || line.size() < 12) {
+                return 0;
+            }
+            int status = 0;
+            std::from_chars(line.data() + 9, line.data() + 12, status);
+
+            size_t contentLength = 0;
+            bool   chunked       = false;
+            while (takeLine(line) && !line.empty()) {
+                std::ranges::transform(line, line.begin(), [](const unsigned char c) { return std::tolower(c); });
+                if (line.starts_with("content-length:")) {
+                    contentLength = std::strtoul(line.c_str() + 15, nullptr, 10);
+                } else if (line.starts_with("transfer-encoding:") && line.find("chunked") != std::string::npos) {
+                    chunked = true;
+                }
+            }
+            if (!m_connected) {
+                return 0;
+            }
+
+            if (!chunked) {
+                return skip(contentLength) ? status : 0;
+            }
+            while (takeLine(line)) {
+                const size_t size = std::strtoul(line.c_str(), nullptr, 16);
+                // Every chunk, the last one included, ends with an empty line
+                if (!skip(size + 2)) {
+                    return 0;
+                }
+                if (size == 0) {
+                    return status;
+                }
+            }
+            return 0;
+        }
+    };
+
+    int64_t percentile(const std::vector<int64_t>& sorted, const double fraction) {
+        if (sorted.empty()) {
+            return 0;
+        }
+        return sorted[std::min(sorted.size() - 1, static_cast<size_t>(fraction * static_cast<double>(sorted.size())))];
+    }
+
+    long maxResidentKilobytes() {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+
+    void runScenario(const Scenario& scenario, const size_t concurrency, const bool last) {
+        std::vector<ClientResult> results(concurrency);
+        std::atomic<size_t>       ready{0};
+        std::atomic<bool>         go{false};
+        std::atomic<size_t>       finished{0};
+
+        std::vector<std::thread> clients;
+        for (size_t i = 0; i < concurrency; i++) {
+            clients.emplace_back([&, i] {
+                auto&      result = results[i];
+                Connection connection;
+                result.latencies.reserve(REQUESTS_PER_CLIENT);
+                ready++;
+                while (!go) { std::this_thread::yield(); }
+
+                for (int request = 0; request < REQUESTS_PER_CLIENT; request++) {
+                    const auto start  = Clock::now();
+                    const int  status = connection.exchange(scenario.request);
+                    result.latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+                    if (status < 200 || status >= 300) {
+                        result.errors++;
+                    }
+                }
+                finished++;
+            });
+        }
+
+        // The httpd task only runs while this one waits through FreeRTOS, not while it blocks on the host
+        while (ready < concurrency) { vTaskDelay(1); }
+        const auto start = Clock::now();
+        go               = true;
+        while (finished < concurrency) { vTaskDelay(1); }
+        const auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        for (auto& client: clients) { client.join(); }
+
+        std::vector<int64_t> latencies;
+        size_t               errors = 0;
+        for (const auto& result: results) {
+            latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+            errors += result.errors;
+        }
+        std::ranges::sort(latencies);
+
+        printf("{\"scenario\":\"%s\",\"payload\":%zu,\"concurrency\":%zu,\"requests\":%zu,\"errors\":%zu,\"error_rate\":%.4f,"
+               "\"requests_per_second\":%.1f,\"p50_us\":%" PRId64 ",\"p99_us\":%" PRId64 ",\"max_us\":%" PRId64 ",\"max_rss_kb\":%ld}%s\n",
+               scenario.name, scenario.payload, concurrency, latencies.size(), errors, static_cast<double>(errors) / static_cast<double>(latencies.size()),
+               static_cast<double>(latencies.size()) / elapsed, percentile(latencies, 0.5), percentile(latencies, 0.99), latencies.back(), maxResidentKilobytes(),
+               last ? "" : ",");
+    }
+
+    std::string get(const std::string& path) {
+        return "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    }
+
+    std::string post(const std::string& path, const size_t size) {
+        return "POST " + path + " HTTP/1.1\r\nHost: localhost\r\nContent-Length: " + std::to_string(size) + "\r\n\r\n" + std::string(size, 'x');
+    }
+
+    void registerRoutes(Http::Server& server) {
+        using Error = Http::Server::Error;
+
+        server.registerGet<"/bench/small", 1, 0, 32>(
+                [](const Http::Server::Uri&, const Http::QueryParameters<0>&, void*) -> std::expected<etl::string<32>, Error> { return etl::string<32>("{\"ok\":true}"); },
+                {},
+                {});
+
+        server.registerGet<"/bench/items/{id}", 1, 0, 32>(
+                [](const Http::Server::Uri&, const Http::QueryParameters<0>& parameters, void*) -> std::expected<etl::string<32>, Error> {
+                    const auto id = parameters.path().as<uint32_t>("id");
+                    if (!id) {
+                        return std::unexpected(Error{.code = Http::StatusCode::BadRequest, .message = "Invalid id"});
+                    }
+                    etl::string<32> body;
+                    body.uninitialized_resize(snprintf(body.data(), body.max_size() + 1, "{\"id\":%" PRIu32 "}", *id));
+                    return body;
+                },
+                {},
+                {});
+
+        server.registerStreamingGet<"/bench/payload", 1, 1>(
+                [](const Http::Server::Uri&, const Http::QueryParameters<1>& parameters, Http::ResponseWriter& writer, void*) -> std::expected<void, Error> {
+                    size_t size = 0;
+                    if (const auto raw = parameters.raw("size")) {
+                        std::from_chars(raw->data(), raw->data() + raw->size(), size);
+                    }
+                    static const std::string block(256, 'x');
+                    for (size_t written = 0; written < size; written += block.size()) { writer.write(std::string_view(block).substr(0, size - written)); }
+                    return {};
+                },
+                {"size"},
+                {});
+
+        server.registerPost<"/bench/echo", 1, 0, 32, 2048>(
+                [](const Http::Server::Uri&, const etl::string<2048>& body, const Http::QueryParameters<0>&, void*) -> std::expected<etl::string<32>, Error> {
+                    etl::string<32> response;
+                    response.uninitialized_resize(snprintf(response.data(), response.max_size() + 1, "{\"received\":%zu}", body.size()));
+                    return response;
+                },
+                {},
+                {});
+
+        server.registerGet<"/bench/async", 1, 0, 32>(
+                [](const Http::Server::Uri&, const Http::QueryParameters<0>&, void*) -> std::expected<etl::string<32>, Error> { return etl::string<32>("{\"ok\":true}"); },
+                {},
+                {},
+                nullptr,
+                std::nullopt,
+                true);
+    }
+} // namespace
+
+extern "C" {
+
+auto app_main(void) -> int {
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    httpd_config_t config   = HTTPD_DEFAULT_CONFIG();
+    config.server_port      = PORT;
+    config.uri_match_fn     = httpd_uri_match_wildcard;
+    config.max_open_sockets = MAX_CONCURRENCY + 2;
+    config.backlog_conn     = MAX_CONCURRENCY;
+    config.max_uri_handlers = 16;
+
+    Http::Server server(config);
+    if (server.initialize() != Component::Status::RUNNING) {
+        return 1;
+    }
+    // All clients share the loopback address, the benchmark measures the server and not the limits
+    server.admission().setConfig({{"rate", 0}, {"connections", 0}}, false);
+    registerRoutes(server);
+
+    const Scenario scenarios[] = {
+            {.name = "GET /bench/small", .request = get("/bench/small"), .payload = 11},
+            {.name = "GET /bench/items/{id}", .request = get("/bench/items/42"), .payload = 9},
+            {.name = "GET /bench/async", .request = get("/bench/async"), .payload = 11},
+            {.name = "GET /bench/payload", .request = get("/bench/payload?size=512"), .payload = 512},
+            {.name = "GET /bench/payload", .request = get("/bench/payload?size=16384"), .payload = 16384},
+            {.name = "POST /bench/echo", .request = post("/bench/echo", 64), .payload = 64},
+            {.name = "POST /bench/echo", .request = post("/bench/echo", 2048), .payload = 2048},
+    };
+    constexpr size_t concurrencies[] = {1, 2, 4, MAX_CONCURRENCY};
+
+    printf("[\n");
+    for (const auto& scenario: scenarios) {
+        for (const size_t concurrency: concurrencies) {
+            const bool last = &scenario == &std::end(scenarios)[-1] && concurrency == std::end(concurrencies)[-1];
+            runScenario(scenario, concurrency, last);
+        }
+    }
+    printf("]\n");
+
+    server.stop();
+    return 0;
+}
+
+} /* Extern "C" */
@@ -0,0 +1,987 @@
+#include "../../config_provider/include/ConfigProvider.hpp"
+#include "../../config_provider/include/ConfigSnapshot.hpp"
+#include "NvsEmulator.hpp"
+#include "unity.h"
+
+#include <esp_rom_crc.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace sdk;
+
+namespace {
+    constexpr char NAMESPACE[]  = "test";
+    constexpr int  ROUND_TRIPS  = 200;
+    constexpr auto RANDOM_SEED  = 0x5eed;
+
+    std::mt19937 generator{RANDOM_SEED};
+
+    template<size_t LENGTH>
+    etl::string<LENGTH> randomString(size_t maxLength) {
+        std::uniform_int_distribution<size_t> lengthDistribution(0, std::min(maxLength, LENGTH));
+        // Printable ASCII, NVS strings are zero terminated so '\0' is not allowed
+        std::uniform_int_distribution<int> charDistribution(0x20, 0x7e);
+
+        etl::string<LENGTH> string;
+        const size_t        length = lengthDistribution(generator);
+        for (size_t i = 0; i < length; i++) { string.push_back(static_cast<char>(charDistribution(generator))); }
+        return string;
+    }
+
+    nlohmann::json randomJson(size_t maxFields) {
+        std::uniform_int_distribution<size_t> fieldDistribution(1, maxFields);
+        std::uniform_int_distribution<int>    typeDistribution(0, 3);
+        std::uniform_int_distribution<int>    intDistribution(INT32_MIN, INT32_MAX);
+
+        nlohmann::json json;
+        const size_t   fields = fieldDistribution(generator);
+        for (size_t i = 0; i < fields; i++) {
+            const std::string key = "f" + std::to_string(i);
+            switch (typeDistribution(generator)) {
+                case 0:
+                    json[key] = intDistribution(generator);
+                    break;
+                case 1:
+                    json[key] = static_cast<bool>(intDistribution(generator) & 1);
+                    break;
+                case 2:
+                    json[key] = randomString<32>(32);
+                    break;
+                default:
+                    json[key] = nlohmann::json::array({intDistribution(generator), randomString<8>(8)});
+                    break;
+            }
+        }
+        return json;
+    }
+
+    class SmallConfig final : public ConfigObject<2, 128, "small"> {
+        using Base = ConfigObject<2, 128, "small">;
+
+    public:
+        ConfigField<int32_t>          number{42, "number", RestartType::NONE};
+        ConfigField<etl::string<32>>  text{"default", "text", RestartType::COMPONENT};
+
+        void allocateFields() {
+            number = allocate(number);
+            text   = allocate(text);
+        }
+
+        SmallConfig() : Base() { allocateFields(); }
+    };
+
+    enum class Mode : uint8_t {
+        OFF,
+        ON
+    };
+
+    class RangeConfig final : public ConfigObject<3, 128, "range"> {
+        using Base = ConfigObject<3, 128, "range">;
+
+    public:
+        ConfigField<uint8_t> channel{1, "channel", RestartType::NONE};
+        ConfigField<int8_t>  offset{0, "offset", RestartType::NONE};
+        ConfigField<Mode>    mode{Mode::OFF, "mode", RestartType::NONE};
+
+        void allocateFields() {
+            channel = allocate(channel);
+            offset  = allocate(offset);
+            mode    = allocate(mode);
+        }
+
+        RangeConfig() : Base() { allocateFields(); }
+    };
+
+    class SecretConfig final : public ConfigObject<3, 128, "secret"> {
+        using Base = ConfigObject<3, 128, "secret">;
+
+    public:
+        ConfigField<etl::string<32>> name{"device", "name", RestartType::NONE};
+        ConfigField<etl::string<32>> token{"hidden", "token", RestartType::DEVICE};
+        ConfigField<int32_t>         cache{0, "cache", RestartType::NONE};
+
+        void allocateFields() {
+            name  = allocate(name);
+            token = allocate(token, FieldVisibility::SECRET);
+            cache = allocate(cache, FieldVisibility::INTERNAL);
+        }
+
+        SecretConfig() : Base() { allocateFields(); }
+    };
+
+    // Binds its config the way a component does, hooks go through its own lock
+    struct SecretOwner {
+        std::mutex   mutex;
+        SecretConfig config;
+
+        SecretOwner() {
+            ConfigRegistry::bind({
+                    .key   = SecretConfig::key(),
+                    .owner = this,
+                    .read  = [](void* owner) {
+                        auto&           self = *static_cast<SecretOwner*>(owner);
+                        std::lock_guard lock(self.mutex);
+                        return self.config.exposedJson();
+                    },
+                    .patch = [](void* owner, const nlohmann::json& patch) -> std::expected<ConfigRegistry::PatchSummary, std::error_code> {
+                        auto&           self = *static_cast<SecretOwner*>(owner);
+                        std::lock_guard lock(self.mutex);
+                        if (auto err = self.config.validateClientPatch(patch)) {
+                            return std::unexpected(err);
+                        }
+                        const auto patched = self.config.applyPatch(patch);
+                        if (auto err = self.config.save()) {
+                            return std::unexpected(err);
+                        }
+                        return ConfigRegistry::PatchSummary{.changed = patched->changedKeys.size(), .restartType = patched->restartType};
+                    },
+                    .reload = [](void* owner) -> std::expected<ConfigRegistry::PatchSummary, std::error_code> {
+                        auto&           self = *static_cast<SecretOwner*>(owner);
+                        std::lock_guard lock(self.mutex);
+                        const auto      reloaded = self.config.reload();
+                        if (!reloaded) {
+                            return std::unexpected(reloaded.error());
+                        }
+                        return ConfigRegistry::PatchSummary{.changed = reloaded->changedKeys.size(), .restartType = reloaded->restartType};
+                    },
+            });
+        }
+
+        ~SecretOwner() {
+            ConfigRegistry::unbind(SecretConfig::key(), this);
+        }
+    };
+
+    int migrationsRun = 0;
+
+    // 0.1.0 stored "velocity" in m/s, 0.2.0 renamed it to "speed", 0.3.0 changed the unit to dm/s
+    constexpr ConfigMigration migrations[] = {
+            {.from  = semver::version{0, 1, 0},
+             .to    = semver::version{0, 2, 0},
+             .apply = [](nlohmann::json& json) {
+                 json["speed"] = json.at("velocity");
+                 json.erase("velocity");
+                 migrationsRun++;
+             }},
+            {.from  = semver::version{0, 2, 0},
+             .to    = semver::version{0, 3, 0},
+             .apply = [](nlohmann::json& json) {
+                 json["speed"] = json.at("speed").get<int32_t>() * 10;
+                 migrationsRun++;
+             }},
+    };
+
+    class MigratedConfig final : public ConfigObject<1, 128, "migrated"> {
+        using Base = ConfigObject<1, 128, "migrated">;
+
+    public:
+        ConfigField<int32_t> speed{0, "speed", RestartType::NONE};
+
+        void allocateFields() {
+            speed = allocate(speed);
+        }
+
+        explicit MigratedConfig(const semver::version& firmware) : Base() {
+            migrate(migrations, firmware);
+            allocateFields();
+        }
+    };
+
+    void storeRaw(const char* key, const nlohmann::json& json) {
+        ConfigProvider provider(CONFIG_NAMESPACE, false);
+        TEST_ASSERT_FALSE(provider.initialize());
+        TEST_ASSERT_FALSE(provider.saveJson(key, json));
+    }
+
+    // Builds a snapshot by hand, so it can hold what exportTo() never writes
+    std::vector<uint8_t> makeSnapshot(const std::vector<std::pair<const char*, std::string_view>>& entries) {
+        std::vector<uint8_t> snapshot;
+        const auto           append = [&snapshot](const void* data, size_t size) {
+            const auto* bytes = static_cast<const uint8_t*>(data);
+            snapshot.insert(snapshot.end(), bytes, bytes + size);
+        };
+
+        const ConfigSnapshot::Header header{.magic           = ConfigSnapshot::snapshotMagic,
+                                            .formatVersion   = ConfigSnapshot::formatVersion,
+                                            .count           = static_cast<uint16_t>(entries.size()),
+                                            .firmwareVersion = "0.3.0"};
+        append(&header, sizeof(header));
+        for (const auto& [key, value]: entries) {
+            ConfigSnapshot::EntryHeader entry{.key = {}, .length = static_cast<uint32_t>(value.size())};
+            std::strncpy(entry.key, key, sizeof(entry.key) - 1);
+            append(&entry, sizeof(entry));
+            append(value.data(), value.size());
+        }
+        const uint32_t crc = esp_rom_crc32_le(0, snapshot.data(), snapshot.size());
+        append(&crc, sizeof(crc));
+        return snapshot;
+    }
+
+    nlohmann::json loadRaw(const char* key) {
+        ConfigProvider provider(CONFIG_NAMESPACE, true);
+        nlohmann::json json;
+        TEST_ASSERT_FALSE(provider.initialize());
+        TEST_ASSERT_FALSE(provider.loadJson<128>(key, json));
+        return json;
+    }
+} // namespace
+
+// Repeated for each test
+void setUp() {
+    TEST_ASSERT_EQUAL(ESP_OK, test::NvsEmulator::reset());
+}
+
+// Repeated after each test
+void tearDown() {}
+
+void testLoadingMissingItemShouldReturnNotFound() {
+    ConfigProvider provider(NAMESPACE, false);
+    TEST_ASSERT_FALSE(provider.initialize());
+
+    etl::string<16> string{"untouched"};
+    TEST_ASSERT_EQUAL(ESP_ERR_NVS_NOT_FOUND, provider.loadItem("missing", string).value());
+    TEST_ASSERT_EQUAL_STRING("untouched", string.c_str());
+}
+
+void testIntegerRoundTrip() {
+    ConfigProvider                     provider(NAMESPACE, false);
+    std::uniform_int_distribution<int> distribution(INT32_MIN, INT32_MAX);
+    TEST_ASSERT_FALSE(provider.initialize());
+
+    for (int i = 0; i < ROUND_TRIPS; i++) {
+        int32_t value = distribution(generator);
+        TEST_ASSERT_FALSE(provider.saveItem("int", value, false));
+
+        int32_t loaded = 0;
+        TEST_ASSERT_FALSE(provider.loadItem("int", loaded));
+        TEST_ASSERT_EQUAL_INT32(value, loaded);
+    }
+    TEST_ASSERT_FALSE(provider.commit());
+}
+
+void testStringRoundTrip() {
+    ConfigProvider provider(NAMESPACE, false);
+    TEST_ASSERT_FALSE(provider.initialize());
+
+    for (int i = 0; i < ROUND_TRIPS; i++) {
+        const auto value = randomString<255>(254);
+        TEST_ASSERT_FALSE(provider.saveItem("string", value, false));
+
+        etl::string<255> loaded;
+        TEST_ASSERT_FALSE(provider.loadItem("string", loaded));
+        TEST_ASSERT_EQUAL_UINT(value.size(), loaded.size());
+        TEST_ASSERT_EQUAL_STRING(value.c_str(), loaded.c_str());
+    }
+    TEST_ASSERT_FALSE(provider.commit());
+}
+
+void testJsonRoundTrip() {
+    ConfigProvider provider(NAMESPACE, false);
+    TEST_ASSERT_FALSE(provider.initialize());
+
+    for (int i = 0; i < ROUND_TRIPS; i++) {
+        const auto value = randomJson(16);
+        TEST_ASSERT_FALSE(provider.saveJson("json", value, false));
+
+        nlohmann::json loaded;
+        TEST_ASSERT_FALSE(provider.loadJson<2048>("json", loaded));
+        TEST_ASSERT_TRUE_MESSAGE(value == loaded, value.dump().c_str());
+    }
+    TEST_ASSERT_FALSE(provider.commit());
+}
+
+void testBlobRoundTrip() {
+    ConfigProvider                     provider(NAMESPACE, false);
+    std::uniform_int_distribution<int> byteDistribution(0, UINT8_MAX);
+    std::uniform_int_distribution<int> sizeDistribution(1, 1024);
+    TEST_ASSERT_FALSE(provider.initialize());
+
+    std::array<uint8_t, 1024> value{}, loaded{};
+    for (int i = 0; i < ROUND_TRIPS; i++) {
+        const size_t size = sizeDistribution(generator);
+        std::generate_n(value.begin(), size, [&]() { return static_cast<uint8_t>(byteDistribution(generator)); });
+        TEST_ASSERT_FALSE(provider.saveBlob("blob", {value.data(), size}, false));
+
+        size_t loadedSize = 0;
+        TEST_ASSERT_FALSE(provider.loadBlob("blob", loaded, loadedSize));
+        TEST_ASSERT_EQUAL_UINT(size, loadedSize);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(value.data(), loaded.data(), size);
+    }
+    size_t unused = 0;
+    TEST_ASSERT_EQUAL(ESP_ERR_NVS_INVALID_LENGTH, provider.loadBlob("blob", std::span(loaded).first(0), unused).value());
+    TEST_ASSERT_FALSE(provider.commit());
+}
+
+void testStringTooLongShouldNotLoad() {
+    ConfigProvider provider(NAMESPACE, false);
+    TEST_ASSERT_FALSE(provider.initialize());
+    TEST_ASSERT_FALSE(provider.saveItem("string", etl::string<32>("longer than eight"), false));
+
+    etl::string<8> loaded{"kept"};
+    TEST_ASSERT_EQUAL(ESP_ERR_NVS_INVALID_LENGTH, provider.loadItem("string", loaded).value());
+    TEST_ASSERT_EQUAL_STRING("kept", loaded.c_str());
+}
+
+void testLargeJsonShouldBeStoredInChunks() {
+    ConfigProvider provider(NAMESPACE, false);
+    TEST_ASSERT_FALSE(provider.initialize());
+
+    nlohmann::json value;
+    for (int i = 0; value.dump().size() < ConfigProvider::maxStringSize + 1000; i++) { value["field_" + std::to_string(i)] = randomString<64>(64); }
+    TEST_ASSERT_FALSE(provider.saveJson("large", value));
+
+    size_t size = 0;
+    TEST_ASSERT_EQUAL(ESP_ERR_NVS_NOT_FOUND, provider.getStringSize("large", size).value());
+
+    nlohmann::json loaded;
+    TEST_ASSERT_FALSE(provider.loadJson<16>("large", loaded));
+    TEST_ASSERT_TRUE(value == loaded);
+
+    // Shrinking the value should go back to a single string entry
+    TEST_ASSERT_FALSE(provider.saveJson("large", {{"small", true}}));
+    TEST_ASSERT_FALSE(provider.loadJson<64>("large", loaded));
+    TEST_ASSERT_TRUE(loaded.at("small").get<bool>());
+    TEST_ASSERT_FALSE(provider.eraseItem("large"));
+    TEST_ASSERT_EQUAL(ESP_ERR_NVS_NOT_FOUND, provider.loadJson<64>("large", loaded).value());
+}
+
+void testJsonAtStringLimitShouldSwitchToChunks() {
+    ConfigProvider provider(NAMESPACE, false);
+    TEST_ASSERT_FALSE(provider.initialize());
+
+    // {"v":"..."} takes 8 characters besides the value
+    const nlohmann::json largest = {{"v", std::string(ConfigProvider::maxStringSize - 9, 'x')}};
+    TEST_ASSERT_FALSE(provider.saveJson("limit", largest));
+    size_t size = 0;
+    TEST_ASSERT_FALSE(provider.getStringSize("limit", size));
+    TEST_ASSERT_EQUAL(ConfigProvider::maxStringSize, size);
+
+    const nlohmann::json chunked = {{"v", std::string(ConfigProvider::maxStringSize - 8, 'x')}};
+    TEST_ASSERT_FALSE(provider.saveJson("limit", chunked));
+    TEST_ASSERT_EQUAL(ESP_ERR_NVS_NOT_FOUND, provider.getStringSize("limit", size).value());
+
+    nlohmann::json loaded;
+    TEST_ASSERT_FALSE(provider.loadJson<16>("limit", loaded));
+    TEST_ASSERT_TRUE(chunked == loaded);
+}
+
+void testChunkedStreamRoundTrip() {
+    ConfigProvider                     provider(NAMESPACE, false);
+    std::uniform_int_distribution<int> byteDistribution(0, UINT8_MAX);
+    TEST_ASSERT_FALSE(provider.initialize());
+
+    std::vector<uint8_t> value(5 * chunked::chunkSize + 17);
+    std::generate(value.begin(), value.end(), [&]() { return static_cast<uint8_t>(byteDistribution(generator)); });
+    {
+        auto writer = provider.openWriter("stream");
+        // Write in odd sized pieces, so chunk boundaries don't line up with the writes
+        for (size_t offset = 0; offset < value.size(); offset += 77) {
+            TEST_ASSERT_FALSE(writer.write(std::span(value).subspan(offset, std::min<size_t>(77, value.size() - offset))));
+        }
+        TEST_ASSERT_FALSE(writer.finish());
+    }
+
+    auto reader = provider.openReader("stream");
+    TEST_ASSERT_FALSE(reader.open());
+    TEST_ASSERT_EQUAL_UINT(value.size(), reader.size());
+
+    std::vector<uint8_t> loaded(value.size());
+    size_t               offset = 0;
+    while (offset < loaded.size()) {
+        auto read = reader.read(std::span(loaded).subspan(offset, std::min<size_t>(100, loaded.size() - offset)));
+        TEST_ASSERT_TRUE(read.has_value());
+        TEST_ASSERT_NOT_EQUAL(0, read.value());
+        offset += read.value();
+    }
+    TEST_ASSERT_FALSE(reader.error());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(value.data(), loaded.data(), value.size());
+}
+
+void testUnfinishedChunkedWriteShouldNotBeVisible() {
+    ConfigProvider provider(NAMESPACE, false);
+    TEST_ASSERT_FALSE(provider.initialize());
+
+    const std::array<uint8_t, 4> original{1, 2, 3, 4};
+    {
+        auto writer = provider.openWriter("atomic");
+        TEST_ASSERT_FALSE(writer.write(original));
+        TEST_ASSERT_FALSE(writer.finish());
+    }
+    {
+        // Simulates a power loss halfway through: chunks are written, but the header never is
+        std::vector<uint8_t> replacement(3 * chunked::chunkSize, 0xff);
+        auto                 writer = provider.openWriter("atomic");
+        TEST_ASSERT_FALSE(writer.write(replacement));
+    }
+
+    auto                   reader = provider.openReader("atomic");
+    std::array<uint8_t, 4> loaded{};
+    TEST_ASSERT_FALSE(reader.open());
+    TEST_ASSERT_EQUAL_UINT(original.size(), reader.size());
+    TEST_ASSERT_EQUAL_UINT(original.size(), reader.read(loaded).value_or(0));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(original.data(), loaded.data(), original.size());
+}
+
+void testChunkKeyCollisionShouldNotAlias() {
+    ConfigProvider provider(NAMESPACE, false);
+    TEST_ASSERT_FALSE(provider.initialize());
+
+    // Two keys with the same CRC32, so their chunks share entry keys
+    constexpr char first[]  = "rgr351t";
+    constexpr char second[] = "ulzwzuko";
+    TEST_ASSERT_EQUAL_HEX32(chunked::keyId(first), chunked::keyId(second));
+
+    const std::array<uint8_t, 4> original{1, 2, 3, 4};
+    {
+        auto writer = provider.openWriter(first);
+        TEST_ASSERT_FALSE(writer.write(original));
+        TEST_ASSERT_FALSE(writer.finish());
+    }
+
+    // The other key has no value, and writing or erasing it leaves the first one alone
+    auto other = provider.openReader(second);
+    TEST_ASSERT_EQUAL(ESP_ERR_NVS_NOT_FOUND, other.open().value());
+    {
+        auto writer = provider.openWriter(second);
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, writer.write(original).value());
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, writer.finish().value());
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_NVS_NOT_FOUND, provider.eraseItem(second).value());
+
+    auto                   reader = provider.openReader(first);
+    std::array<uint8_t, 4> loaded{};
+    TEST_ASSERT_FALSE(reader.open());
+    TEST_ASSERT_EQUAL_UINT(original.size(), reader.read(loaded).value_or(0));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(original.data(), loaded.data(), original.size());
+}
+
+void testRoundTripShouldSurviveReinitialization() {
+    const auto value = randomString<64>(63);
+    {
+        ConfigProvider provider(NAMESPACE, false);
+        TEST_ASSERT_FALSE(provider.initialize());
+        TEST_ASSERT_FALSE(provider.saveItem("persist", value));
+    }
+    nvs_flash_deinit();
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_flash_init());
+
+    ConfigProvider  provider(NAMESPACE, true);
+    etl::string<64> loaded;
+    TEST_ASSERT_FALSE(provider.initialize());
+    TEST_ASSERT_FALSE(provider.loadItem("persist", loaded));
+    TEST_ASSERT_EQUAL_STRING(value.c_str(), loaded.c_str());
+}
+
+void testConfigObjectShouldLoadSavedFields() {
+    {
+        SmallConfig config;
+        TEST_ASSERT_TRUE(config.isDefault());
+        config.updateField(config.number, 1337);
+        config.updateField(config.text, etl::string<32>("changed"));
+        TEST_ASSERT_FALSE(config.save());
+    }
+
+    SmallConfig config;
+    TEST_ASSERT_FALSE(config.isDefault());
+    TEST_ASSERT_EQUAL_INT32(1337, config.number.value());
+    TEST_ASSERT_EQUAL_STRING("changed", config.text.value().c_str());
+}
+
+void testConfigObjectResetShouldRestoreDefaults() {
+    {
+        SmallConfig config;
+        config.updateField(config.number, 7);
+        TEST_ASSERT_FALSE(config.save());
+        TEST_ASSERT_FALSE(config.reset());
+    }
+
+    SmallConfig config;
+    TEST_ASSERT_TRUE(config.isDefault());
+    TEST_ASSERT_EQUAL_INT32(42, config.number.value());
+}
+
+void testMergePatchShouldOnlyReportChangedFields() {
+    SmallConfig config;
+
+    auto result = config.applyPatch({{"number", 42}, {"text", "patched"}});
+    TEST_ASSERT_TRUE(result.has_value());
+    TEST_ASSERT_EQUAL_UINT(1, result->changedKeys.size());
+    TEST_ASSERT_EQUAL_STRING("text", result->changedKeys.front().c_str());
+    TEST_ASSERT_TRUE(result->restartType == RestartType::COMPONENT);
+    TEST_ASSERT_EQUAL_STRING("patched", config.text.value().c_str());
+
+    result = config.applyPatch({{"number", 1}});
+    TEST_ASSERT_TRUE(result.has_value());
+    TEST_ASSERT_TRUE(result->restartType == RestartType::NONE);
+    TEST_ASSERT_EQUAL_INT32(1, config.number.value());
+    TEST_ASSERT_FALSE(config.isDefault());
+}
+
+void testInvalidMergePatchShouldLeaveObjectUntouched() {
+    SmallConfig config;
+
+    TEST_ASSERT_FALSE(config.applyPatch({{"number", 5}, {"text", 5}}).has_value());
+    TEST_ASSERT_FALSE(config.applyPatch({{"number", 5}, {"unknown", 5}}).has_value());
+    TEST_ASSERT_FALSE(config.applyPatch({{"text", nullptr}}).has_value());
+    TEST_ASSERT_FALSE(config.applyPatch(nlohmann::json::array({1, 2})).has_value());
+    TEST_ASSERT_EQUAL_INT32(42, config.number.value());
+    TEST_ASSERT_TRUE(config.isDefault());
+}
+
+void testOutOfRangePatchShouldBeRejected() {
+    RangeConfig config;
+
+    for (const auto* patch: {R"({"channel":300})", R"({"channel":-1})", R"({"offset":128})", R"({"offset":-129})", R"({"mode":256})", R"({"mode":-1})"}) {
+        const auto patched = config.applyPatch(nlohmann::json::parse(patch));
+        TEST_ASSERT_FALSE(patched.has_value());
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, patched.error().value());
+    }
+    TEST_ASSERT_EQUAL_UINT8(1, config.channel.value());
+    TEST_ASSERT_TRUE(config.isDefault());
+
+    // Bounds themselves fit, whether the json was parsed or built in code
+    TEST_ASSERT_TRUE(config.applyPatch(nlohmann::json::parse(R"({"channel":255,"offset":-128,"mode":1})")).has_value());
+    TEST_ASSERT_TRUE(config.applyPatch({{"channel", 0}, {"offset", 127}}).has_value());
+    TEST_ASSERT_EQUAL_UINT8(0, config.channel.value());
+    TEST_ASSERT_EQUAL_INT8(127, config.offset.value());
+    TEST_ASSERT_TRUE(config.mode.value() == Mode::ON);
+}
+
+void testUnboundConfigShouldNotBeReachable() {
+    SecretConfig config;
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, ConfigRegistry::read("secret").error().value());
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, ConfigRegistry::patch("secret", {{"name", "renamed"}}).error().value());
+}
+
+void testBoundInstanceShouldReadWithoutHiddenFields() {
+    {
+        SecretOwner owner;
+        const auto  json = ConfigRegistry::read("secret");
+        TEST_ASSERT_TRUE(json.has_value());
+        TEST_ASSERT_EQUAL_STRING("device", json->at("name").get<std::string>().c_str());
+        TEST_ASSERT_FALSE(json->contains("token"));
+        TEST_ASSERT_FALSE(json->contains("cache"));
+    }
+    TEST_ASSERT_FALSE(ConfigRegistry::read("secret").has_value());
+}
+
+void testPatchThroughRegistryShouldSaveBoundInstance() {
+    {
+        SecretOwner owner;
+
+        const auto patched = ConfigRegistry::patch("secret", {{"name", "renamed"}, {"token", "changed"}});
+        TEST_ASSERT_TRUE(patched.has_value());
+        TEST_ASSERT_EQUAL_UINT(2, patched->changed);
+        TEST_ASSERT_TRUE(patched->restartType == RestartType::DEVICE);
+        TEST_ASSERT_EQUAL_STRING("renamed", owner.config.name.value().c_str());
+
+        const auto invalid = ConfigRegistry::patch("secret", {{"name", 5}});
+        TEST_ASSERT_FALSE(invalid.has_value());
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, invalid.error().value());
+
+        // Internal fields are only changed by the owner
+        const auto internal = ConfigRegistry::patch("secret", {{"name", "again"}, {"cache", 5}});
+        TEST_ASSERT_FALSE(internal.has_value());
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, internal.error().value());
+        TEST_ASSERT_EQUAL_STRING("renamed", owner.config.name.value().c_str());
+        TEST_ASSERT_EQUAL_INT32(0, owner.config.cache.value());
+    }
+
+    SecretConfig config;
+    TEST_ASSERT_EQUAL_STRING("renamed", config.name.value().c_str());
+    TEST_ASSERT_EQUAL_STRING("changed", config.token.value().c_str());
+}
+
+void testTransactionShouldSaveAllObjectsOnCommit() {
+    uint32_t generation = 0;
+    {
+        ConfigTransaction transaction;
+        SmallConfig       config;
+        config.updateField(config.number, 11);
+        TEST_ASSERT_FALSE(config.save(transaction));
+        TEST_ASSERT_FALSE(transaction.stage(NAMESPACE, "other", {{"value", 12}}));
+        generation = transaction.generation();
+
+        // Nothing is visible before the commit
+        TEST_ASSERT_EQUAL_INT32(42, SmallConfig().number.value());
+        TEST_ASSERT_FALSE(transaction.commit());
+    }
+    TEST_ASSERT_EQUAL_INT32(11, SmallConfig().number.value());
+
+    ConfigProvider provider(NAMESPACE, true);
+    nlohmann::json other;
+    TEST_ASSERT_FALSE(provider.initialize());
+    TEST_ASSERT_FALSE(provider.loadJson<64>("other", other));
+    TEST_ASSERT_EQUAL_INT(12, other.at("value").get<int>());
+
+    ConfigTransaction next;
+    TEST_ASSERT_FALSE(next.stage(NAMESPACE, "other", {{"value", 13}}));
+    TEST_ASSERT_EQUAL_UINT32(generation + 1, next.generation());
+}
+
+void testOverlappingTransactionsShouldKeepTheirValues() {
+    std::atomic<bool> otherCommitted{false};
+    std::thread       other;
+    {
+        ConfigTransaction transaction;
+        TEST_ASSERT_FALSE(transaction.stage(NAMESPACE, "first", {{"value", 1}}));
+
+        other = std::thread([&otherCommitted] {
+            ConfigTransaction overlapping;
+            TEST_ASSERT_FALSE(overlapping.stage(NAMESPACE, "second", {{"value", 2}}));
+            TEST_ASSERT_FALSE(overlapping.commit());
+            otherCommitted = true;
+        });
+        // The other transaction waits for this one instead of clearing what it staged
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        TEST_ASSERT_FALSE(otherCommitted);
+        TEST_ASSERT_FALSE(transaction.stage(NAMESPACE, "third", {{"value", 3}}));
+        TEST_ASSERT_FALSE(transaction.commit());
+    }
+    other.join();
+    TEST_ASSERT_TRUE(otherCommitted);
+
+    ConfigProvider provider(NAMESPACE, true);
+    TEST_ASSERT_FALSE(provider.initialize());
+    int expected = 1;
+    for (const char* key: {"first", "second", "third"}) {
+        nlohmann::json json;
+        TEST_ASSERT_FALSE(provider.loadJson<64>(key, json));
+        TEST_ASSERT_EQUAL_INT(expected++, json.at("value").get<int>());
+    }
+}
+
+void testDroppedTransactionShouldRollBack() {
+    {
+        ConfigTransaction transaction;
+        SmallConfig       config;
+        config.updateField(config.number, 11);
+        TEST_ASSERT_FALSE(config.save(transaction));
+    }
+    TEST_ASSERT_EQUAL_INT32(42, SmallConfig().number.value());
+
+    // Recovering without a committed marker must not publish anything
+    TEST_ASSERT_FALSE(ConfigTransaction::recover());
+    TEST_ASSERT_EQUAL_INT32(42, SmallConfig().number.value());
+}
+
+void testStagedPatchShouldOnlyApplyOnCommit() {
+    SmallConfig config;
+    const auto  applyToConfig = [&config] { config.applyPatch({{"number", 5}}); };
+    {
+        ConfigTransaction transaction;
+        const auto        staged = config.stagePatch({{"number", 5}, {"text", "default"}}, transaction);
+        TEST_ASSERT_TRUE(staged.has_value());
+        TEST_ASSERT_EQUAL_UINT(1, staged->changedKeys.size());
+        TEST_ASSERT_FALSE(transaction.onCommit(applyToConfig));
+    }
+    // A dropped transaction changes neither memory nor NVS
+    TEST_ASSERT_EQUAL_INT32(42, config.number.value());
+    TEST_ASSERT_EQUAL_INT32(42, SmallConfig().number.value());
+
+    ConfigTransaction transaction;
+    TEST_ASSERT_TRUE(config.stagePatch({{"number", 5}}, transaction).has_value());
+    TEST_ASSERT_FALSE(transaction.onCommit(applyToConfig));
+    TEST_ASSERT_EQUAL_INT32(42, config.number.value());
+    TEST_ASSERT_FALSE(transaction.commit());
+    TEST_ASSERT_EQUAL_INT32(5, config.number.value());
+    TEST_ASSERT_EQUAL_INT32(5, SmallConfig().number.value());
+
+    TEST_ASSERT_FALSE(config.stagePatch({{"number", "five"}}, transaction).has_value());
+}
+
+void testMigrationShouldUpgradeInMultipleSteps() {
+    storeRaw("migrated", {{CONFIG_VERSION_KEY, "0.1.0"}, {"velocity", 3}});
+    migrationsRun = 0;
+
+    MigratedConfig config({0, 3, 0});
+    TEST_ASSERT_EQUAL_INT(2, migrationsRun);
+    TEST_ASSERT_EQUAL_INT32(30, config.speed.value());
+
+    const auto stored = loadRaw("migrated");
+    TEST_ASSERT_EQUAL_STRING("0.3.0", stored.at(CONFIG_VERSION_KEY).get<std::string>().c_str());
+    TEST_ASSERT_FALSE(stored.contains("velocity"));
+    TEST_ASSERT_EQUAL_INT(30, stored.at("speed").get<int>());
+
+    // The next boot on the same firmware must not migrate again
+    MigratedConfig again({0, 3, 0});
+    TEST_ASSERT_EQUAL_INT(2, migrationsRun);
+    TEST_ASSERT_EQUAL_INT32(30, again.speed.value());
+}
+
+void testMigrationShouldStartAtStoredVersion() {
+    storeRaw("migrated", {{CONFIG_VERSION_KEY, "0.2.0"}, {"speed", 4}});
+    migrationsRun = 0;
+
+    MigratedConfig config({0, 3, 0});
+    TEST_ASSERT_EQUAL_INT(1, migrationsRun);
+    TEST_ASSERT_EQUAL_INT32(40, config.speed.value());
+}
+
+void testMigrationShouldStopAtFirmwareVersion() {
+    storeRaw("migrated", {{CONFIG_VERSION_KEY, "0.1.0"}, {"velocity", 5}});
+    migrationsRun = 0;
+
+    MigratedConfig config({0, 2, 0});
+    TEST_ASSERT_EQUAL_INT(1, migrationsRun);
+    TEST_ASSERT_EQUAL_INT32(5, config.speed.value());
+    TEST_ASSERT_EQUAL_STRING("0.2.0", loadRaw("migrated").at(CONFIG_VERSION_KEY).get<std::string>().c_str());
+}
+
+void testMigrationShouldSkipObjectsThatWereNeverStored() {
+    migrationsRun = 0;
+
+    MigratedConfig config({0, 3, 0});
+    TEST_ASSERT_EQUAL_INT(0, migrationsRun);
+    TEST_ASSERT_EQUAL_INT32(0, config.speed.value());
+}
+
+void testSnapshotShouldRestoreAllObjects() {
+    {
+        SmallConfig config;
+        config.updateField(config.number, 7);
+        config.updateField(config.text, etl::string<32>{"snapshot"});
+        TEST_ASSERT_FALSE(config.save());
+    }
+    storeRaw("migrated", {{CONFIG_VERSION_KEY, "0.3.0"}, {"speed", 30}});
+
+    std::vector<uint8_t> snapshot;
+    TEST_ASSERT_FALSE(ConfigSnapshot::exportTo([&snapshot](std::span<const uint8_t> data) {
+        snapshot.insert(snapshot.end(), data.begin(), data.end());
+        return std::error_code{};
+    }));
+
+    TEST_ASSERT_EQUAL(ESP_OK, test::NvsEmulator::reset());
+    TEST_ASSERT_EQUAL_INT32(42, SmallConfig().number.value());
+
+    // Feed odd sized pieces, like an HTTP body arriving in fragments
+    ConfigSnapshot::Importer importer;
+    for (size_t offset = 0; offset < snapshot.size(); offset += 7) {
+        const size_t count = std::min<size_t>(7, snapshot.size() - offset);
+        TEST_ASSERT_FALSE(importer.write({snapshot.data() + offset, count}));
+    }
+    TEST_ASSERT_FALSE(importer.finish());
+
+    const SmallConfig restored;
+    TEST_ASSERT_EQUAL_INT32(7, restored.number.value());
+    TEST_ASSERT_EQUAL_STRING("snapshot", restored.text.value().c_str());
+    TEST_ASSERT_EQUAL_INT32(30, loadRaw("migrated").at("speed").get<int32_t>());
+}
+
+void testCorruptedSnapshotShouldNotImport() {
+    {
+        SmallConfig config;
+        config.updateField(config.number, 7);
+        TEST_ASSERT_FALSE(config.save());
+    }
+
+    std::vector<uint8_t> snapshot;
+    TEST_ASSERT_FALSE(ConfigSnapshot::exportTo([&snapshot](std::span<const uint8_t> data) {
+        snapshot.insert(snapshot.end(), data.begin(), data.end());
+        return std::error_code{};
+    }));
+    TEST_ASSERT_EQUAL(ESP_OK, test::NvsEmulator::reset());
+
+    // Turn the stored 7 into a 6, the value stays valid json so only the checksum can tell
+    constexpr std::array<uint8_t, 2> number{':', '7'};
+    const auto                       digit = std::search(snapshot.begin(), snapshot.end(), number.begin(), number.end());
+    TEST_ASSERT_TRUE(digit != snapshot.end());
+    *(digit + 1) ^= 0x01;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_CRC, ConfigSnapshot::import(snapshot).value());
+    TEST_ASSERT_EQUAL_INT32(42, SmallConfig().number.value());
+
+    const std::span<const uint8_t> truncated{snapshot.data(), snapshot.size() / 2};
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, ConfigSnapshot::import(truncated).value());
+    TEST_ASSERT_EQUAL_INT32(42, SmallConfig().number.value());
+}
+
+void testSnapshotWithUnknownObjectShouldNotImport() {
+    static_cast<void>(SmallConfig());
+    const auto snapshot = makeSnapshot({{"small", R"({"number":7})"}, {"unknown", R"({"number":8})"}});
+
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, ConfigSnapshot::import(snapshot).value());
+    TEST_ASSERT_EQUAL_INT32(42, SmallConfig().number.value());
+}
+
+void testSnapshotWithInvalidJsonShouldNotImport() {
+    static_cast<void>(SmallConfig());
+    const auto snapshot = makeSnapshot({{"small", R"({"number":7})"}, {"migrated", R"({"speed":)"}});
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, ConfigSnapshot::import(snapshot).value());
+    TEST_ASSERT_EQUAL_INT32(42, SmallConfig().number.value());
+}
+
+void testImportShouldReloadBoundOwners() {
+    SecretOwner owner;
+    {
+        ConfigSnapshot::Importer importer;
+        TEST_ASSERT_FALSE(importer.write(makeSnapshot({{"secret", R"({"name":"imported","token":"hidden","cache":3,"gone":1})"}})));
+        TEST_ASSERT_FALSE(importer.finish());
+        TEST_ASSERT_TRUE(importer.restartType() == RestartType::NONE);
+    }
+    TEST_ASSERT_EQUAL_STRING("imported", owner.config.name.value().c_str());
+    TEST_ASSERT_EQUAL_INT32(3, owner.config.cache.value());
+
+    // The owner saving afterwards keeps the import instead of writing its old values back
+    TEST_ASSERT_FALSE(owner.config.save());
+    TEST_ASSERT_EQUAL_STRING("imported", SecretConfig().name.value().c_str());
+
+    // Nobody reloads an object without a bound owner, whoever holds it needs a restart
+    ConfigSnapshot::Importer unbound;
+    TEST_ASSERT_FALSE(unbound.write(makeSnapshot({{"small", R"({"number":7})"}})));
+    TEST_ASSERT_FALSE(unbound.finish());
+    TEST_ASSERT_TRUE(unbound.restartType() == RestartType::DEVICE);
+}
+
+void testRecoverShouldSkipUnreadableEntries() {
+    // The layout ConfigTransaction writes, a reset after the marker leaves it like this
+    struct Marker {
+        uint32_t magic;
+        uint32_t generation;
+        uint16_t count;
+        uint16_t reserved;
+    };
+    struct Target {
+        char nvsNamespace[NVS_NS_NAME_MAX_SIZE];
+        char key[NVS_KEY_NAME_MAX_SIZE];
+    };
+    const auto asBytes = [](const auto& value) { return std::span(reinterpret_cast<const uint8_t*>(&value), sizeof(value)); };
+    {
+        ConfigProvider staging(ConfigTransaction::stagingNamespace, false);
+        TEST_ASSERT_FALSE(staging.initialize());
+        for (const auto& [index, value]: {std::pair{'0', std::string_view(R"({"number":)")}, std::pair{'1', std::string_view(R"({"value":12})")}}) {
+            const Target target{.nvsNamespace = "test", .key = {'v', index, '\0'}};
+            const char   stagedKey[]{'s', index, '\0'};
+            const char   targetKey[]{'t', index, '\0'};
+            auto         writer = staging.openWriter(stagedKey);
+            TEST_ASSERT_FALSE(writer.write({reinterpret_cast<const uint8_t*>(value.data()), value.size()}));
+            TEST_ASSERT_FALSE(writer.finish());
+            TEST_ASSERT_FALSE(staging.saveBlob(targetKey, asBytes(target)));
+        }
+        const Marker marker{.magic = 0x4e584e54, .generation = 1, .count = 2, .reserved = 0};
+        TEST_ASSERT_FALSE(staging.saveBlob("marker", asBytes(marker)));
+    }
+
+    TEST_ASSERT_FALSE(ConfigTransaction::recover());
+
+    ConfigProvider provider(NAMESPACE, true);
+    nlohmann::json json;
+    TEST_ASSERT_FALSE(provider.initialize());
+    TEST_ASSERT_EQUAL(ESP_ERR_NVS_NOT_FOUND, provider.loadJson<64>("v0", json).value());
+    TEST_ASSERT_FALSE(provider.loadJson<64>("v1", json));
+    TEST_ASSERT_EQUAL_INT(12, json.at("value").get<int>());
+
+    // The marker is gone, so the next boot has nothing left to do
+    ConfigTransaction next;
+    TEST_ASSERT_FALSE(next.stage(NAMESPACE, "other", {{"value", 13}}));
+    TEST_ASSERT_EQUAL_UINT32(2, next.generation());
+}
+
+#ifdef CONFIG_NVS_WRITE_METRICS
+void testMetricsShouldCountWritesPerKey() {
+    ConfigProvider provider(NAMESPACE, false);
+    TEST_ASSERT_FALSE(provider.initialize());
+    ConfigMetrics::reset();
+
+    for (int32_t i = 0; i < 3; i++) { TEST_ASSERT_FALSE(provider.saveItem("int", i, false)); }
+    TEST_ASSERT_FALSE(provider.saveItem("text", etl::string<64>(40, 'x'), false));
+    TEST_ASSERT_FALSE(provider.eraseItem("int", false));
+    TEST_ASSERT_FALSE(provider.commit());
+
+    ConfigMetrics::forEachKey([](const ConfigMetrics::KeyMetrics& metrics) {
+        TEST_ASSERT_EQUAL_STRING(NAMESPACE, metrics.nvsNamespace.c_str());
+        if (metrics.key == "int") {
+            TEST_ASSERT_EQUAL_UINT32(3, metrics.writes);
+            TEST_ASSERT_EQUAL_UINT32(1, metrics.erases);
+            TEST_ASSERT_EQUAL_UINT64(3 * sizeof(int32_t), metrics.bytesWritten);
+        } else {
+            TEST_ASSERT_EQUAL_STRING("text", metrics.key.c_str());
+            TEST_ASSERT_EQUAL_UINT64(41, metrics.bytesWritten);
+            // Header entry plus two data entries
+            TEST_ASSERT_EQUAL_UINT64(3, metrics.entriesWritten);
+        }
+    });
+
+    size_t namespaces = 0;
+    ConfigMetrics::forEachNamespace([&namespaces](const ConfigMetrics::NamespaceMetrics& metrics) {
+        namespaces++;
+        TEST_ASSERT_EQUAL_UINT32(1, metrics.commits);
+        uint32_t histogramTotal = 0;
+        for (const auto count: metrics.commitLatency) { histogramTotal += count; }
+        TEST_ASSERT_EQUAL_UINT32(1, histogramTotal);
+    });
+    TEST_ASSERT_EQUAL(1, namespaces);
+
+    const auto stats = ConfigMetrics::nvsStats();
+    TEST_ASSERT_TRUE(stats.has_value());
+    TEST_ASSERT_GREATER_THAN(0, stats->used_entries);
+}
+
+void testRecoverShouldNotCommitWithoutTransaction() {
+    ConfigMetrics::reset();
+    TEST_ASSERT_FALSE(ConfigTransaction::recover());
+
+    size_t namespaces = 0;
+    ConfigMetrics::forEachNamespace([&namespaces](const ConfigMetrics::NamespaceMetrics&) { namespaces++; });
+    TEST_ASSERT_EQUAL(0, namespaces);
+}
+#endif
+
+extern "C" {
+
+auto app_main(void) -> int {
+    test::NvsEmulator::mount("/tmp/test_config_provider.bin");
+
+    UNITY_BEGIN();
+
+    RUN_TEST(testLoadingMissingItemShouldReturnNotFound);
+    RUN_TEST(testIntegerRoundTrip);
+    RUN_TEST(testStringRoundTrip);
+    RUN_TEST(testJsonRoundTrip);
+    RUN_TEST(testBlobRoundTrip);
+    RUN_TEST(testStringTooLongShouldNotLoad);
+    RUN_TEST(testLargeJsonShouldBeStoredInChunks);
+    RUN_TEST(testJsonAtStringLimitShouldSwitchToChunks);
+    RUN_TEST(testChunkedStreamRoundTrip);
+    RUN_TEST(testUnfinishedChunkedWriteShouldNotBeVisible);
+    RUN_TEST(testChunkKeyCollisionShouldNotAlias);
+    RUN_TEST(testRoundTripShouldSurviveReinitialization);
+    RUN_TEST(testConfigObjectShouldLoadSavedFields);
+    RUN_TEST(testConfigObjectResetShouldRestoreDefaults);
+    RUN_TEST(testMergePatchShouldOnlyReportChangedFields);
+    RUN_TEST(testInvalidMergePatchShouldLeaveObjectUntouched);
+    RUN_TEST(testOutOfRangePatchShouldBeRejected);
+    RUN_TEST(testUnboundConfigShouldNotBeReachable);
+    RUN_TEST(testBoundInstanceShouldReadWithoutHiddenFields);
+    RUN_TEST(testPatchThroughRegistryShouldSaveBoundInstance);
+    RUN_TEST(testTransactionShouldSaveAllObjectsOnCommit);
+    RUN_TEST(testOverlappingTransactionsShouldKeepTheirValues);
+    RUN_TEST(testDroppedTransactionShouldRollBack);
+    RUN_TEST(testStagedPatchShouldOnlyApplyOnCommit);
+    RUN_TEST(testMigrationShouldUpgradeInMultipleSteps);
+    RUN_TEST(testMigrationShouldStartAtStoredVersion);
+    RUN_TEST(testMigrationShouldStopAtFirmwareVersion);
+    RUN_TEST(testMigrationShouldSkipObjectsThatWereNeverStored);
+    RUN_TEST(testSnapshotShouldRestoreAllObjects);
+    RUN_TEST(testCorruptedSnapshotShouldNotImport);
+    RUN_TEST(testSnapshotWithUnknownObjectShouldNotImport);
+    RUN_TEST(testSnapshotWithInvalidJsonShouldNotImport);
+    RUN_TEST(testImportShouldReloadBoundOwners);
+    RUN_TEST(testRecoverShouldSkipUnreadableEntries);
+#ifdef CONFIG_NVS_WRITE_METRICS
+    RUN_TEST(testMetricsShouldCountWritesPerKey);
+    RUN_TEST(testRecoverShouldNotCommitWithoutTransaction);
+#endif
+
+    return UNITY_END();
+}
+
+} /* Extern "C" */
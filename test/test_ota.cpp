@@ -0,0 +1,230 @@
+#include "../../ota/include/OtaUpdate.hpp"
+#include "unity.h"
+
+#include <mbedtls/sha256.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace sdk;
+
+namespace {
+    constexpr auto   RANDOM_SEED    = 0x07a;
+    constexpr size_t PARTITION_SIZE = 64 * 1024;
+    // ESP_ERR_OTA_VALIDATE_FAILED, esp_ota_ops.h is not available on the Linux target
+    constexpr esp_err_t VALIDATE_FAILED = 0x1503;
+
+    std::mt19937 generator{RANDOM_SEED};
+
+    /**
+     * @brief OTA partition in memory, records what the update did with it
+     */
+    class MockPartition final : public Ota::Target {
+    public:
+        std::vector<uint8_t> flash;
+        size_t               writes    = 0;
+        bool                 begun     = false;
+        bool                 ended     = false;
+        bool                 activated = false;
+        bool                 aborted   = false;
+        // Returned by end(), like esp_ota_end() does for an image that fails validation
+        esp_err_t            endResult = ESP_OK;
+
+        esp_err_t begin(const size_t size) override {
+            if (size > PARTITION_SIZE) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            begun = true;
+            flash.clear();
+            return ESP_OK;
+        }
+
+        esp_err_t write(const std::span<const uint8_t> data) override {
+            TEST_ASSERT_TRUE(begun && !ended && !aborted);
+            flash.insert(flash.end(), data.begin(), data.end());
+            writes++;
+            return ESP_OK;
+        }
+
+        esp_err_t end() override {
+            ended = true;
+            return endResult;
+        }
+
+        esp_err_t activate() override {
+            TEST_ASSERT_TRUE(ended);
+            activated = true;
+            return ESP_OK;
+        }
+
+        void abort() override {
+            TEST_ASSERT_FALSE(ended);
+            aborted = true;
+        }
+    };
+
+    std::vector<uint8_t> randomImage(const size_t size) {
+        std::uniform_int_distribution<int> byteDistribution(0, 255);
+        std::vector<uint8_t>               image(size);
+        std::ranges::generate(image, [&] { return static_cast<uint8_t>(byteDistribution(generator)); });
+        return image;
+    }
+
+    Ota::Digest sha256(const std::vector<uint8_t>& image) {
+        Ota::Digest digest{};
+        TEST_ASSERT_EQUAL(0, mbedtls_sha256(image.data(), image.size(), digest.data(), 0));
+        return digest;
+    }
+
+    /**
+     * @brief Write the image in chunks of random size, like they arrive from a socket
+     */
+    esp_err_t writeInChunks(Ota::Update& update, const std::vector<uint8_t>& image) {
+        std::uniform_int_distribution<size_t> chunkDistribution(1, 4096);
+        for (size_t offset = 0; offset < image.size();) {
+            const size_t length = std::min(chunkDistribution(generator), image.size() - offset);
+            if (const auto err = update.write(std::span(image).subspan(offset, length)); err != ESP_OK) {
+                return err;
+            }
+            offset += length;
+        }
+        return ESP_OK;
+    }
+} // namespace
+
+// Repeated for each test
+void setUp() {}
+
+// Repeated after each test
+void tearDown() {}
+
+void testImageShouldBeStreamedAndActivated() {
+    const auto    image = randomImage(40 * 1024 + 123);
+    MockPartition partition;
+    {
+        Ota::Update update(partition, image.size(), sha256(image));
+        TEST_ASSERT_EQUAL(ESP_OK, update.begin());
+        TEST_ASSERT_EQUAL(ESP_OK, writeInChunks(update, image));
+        TEST_ASSERT_EQUAL(image.size(), update.written());
+        TEST_ASSERT_EQUAL(ESP_OK, update.finish());
+    }
+
+    TEST_ASSERT_GREATER_THAN(1, partition.writes);
+    TEST_ASSERT_TRUE(partition.flash == image);
+    TEST_ASSERT_TRUE(partition.activated);
+    TEST_ASSERT_FALSE(partition.aborted);
+}
+
+void testHashMismatchShouldNotActivate() {
+    const auto image    = randomImage(8 * 1024);
+    auto       expected = sha256(image);
+    expected[0] ^= 1;
+
+    MockPartition partition;
+    {
+        Ota::Update update(partition, image.size(), expected);
+        TEST_ASSERT_EQUAL(ESP_OK, update.begin());
+        TEST_ASSERT_EQUAL(ESP_OK, writeInChunks(update, image));
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_CRC, update.finish());
+    }
+
+    TEST_ASSERT_FALSE(partition.ended);
+    TEST_ASSERT_FALSE(partition.activated);
+    TEST_ASSERT_TRUE(partition.aborted);
+}
+
+void testImageLargerThanPartitionShouldNotStart() {
+    MockPartition partition;
+    Ota::Update   update(partition, PARTITION_SIZE + 1, Ota::Digest{});
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, update.begin());
+    TEST_ASSERT_FALSE(partition.begun);
+}
+
+void testMoreDataThanAnnouncedShouldAbort() {
+    const auto    image = randomImage(4 * 1024);
+    MockPartition partition;
+    {
+        Ota::Update update(partition, image.size() - 1, sha256(image));
+        TEST_ASSERT_EQUAL(ESP_OK, update.begin());
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, update.write(image));
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, update.finish());
+    }
+
+    TEST_ASSERT_TRUE(partition.flash.empty());
+    TEST_ASSERT_TRUE(partition.aborted);
+    TEST_ASSERT_FALSE(partition.activated);
+}
+
+void testIncompleteImageShouldAbort() {
+    const auto    image = randomImage(4 * 1024);
+    MockPartition partition;
+    {
+        Ota::Update update(partition, image.size(), sha256(image));
+        TEST_ASSERT_EQUAL(ESP_OK, update.begin());
+        TEST_ASSERT_EQUAL(ESP_OK, update.write(std::span(image).first(image.size() / 2)));
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, update.finish());
+    }
+
+    TEST_ASSERT_TRUE(partition.aborted);
+    TEST_ASSERT_FALSE(partition.activated);
+}
+
+void testInterruptedUploadShouldAbortOnDestruction() {
+    const auto    image = randomImage(4 * 1024);
+    MockPartition partition;
+    {
+        Ota::Update update(partition, image.size(), sha256(image));
+        TEST_ASSERT_EQUAL(ESP_OK, update.begin());
+        TEST_ASSERT_EQUAL(ESP_OK, update.write(std::span(image).first(100)));
+    }
+
+    TEST_ASSERT_TRUE(partition.aborted);
+    TEST_ASSERT_FALSE(partition.ended);
+}
+
+void testInvalidImageShouldNotActivate() {
+    const auto    image = randomImage(4 * 1024);
+    MockPartition partition;
+    partition.endResult = VALIDATE_FAILED;
+    {
+        Ota::Update update(partition, image.size(), sha256(image));
+        TEST_ASSERT_EQUAL(ESP_OK, update.begin());
+        TEST_ASSERT_EQUAL(ESP_OK, writeInChunks(update, image));
+        TEST_ASSERT_EQUAL(VALIDATE_FAILED, update.finish());
+    }
+
+    TEST_ASSERT_TRUE(partition.ended);
+    TEST_ASSERT_FALSE(partition.activated);
+    TEST_ASSERT_FALSE(partition.aborted);
+}
+
+void testDigestShouldParseOnlyHexSha256() {
+    const auto digest = Ota::parseDigest("E3B0C44298FC1C149AFBF4C8996FB92427AE41E4649B934CA495991B7852b855");
+    TEST_ASSERT_TRUE(digest.has_value());
+    TEST_ASSERT_EQUAL_HEX8(0xe3, digest->front());
+    TEST_ASSERT_EQUAL_HEX8(0x55, digest->back());
+
+    TEST_ASSERT_FALSE(Ota::parseDigest("e3b0c442").has_value());
+    TEST_ASSERT_FALSE(Ota::parseDigest("g3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855").has_value());
+}
+
+extern "C" {
+
+auto app_main(void) -> int {
+    UNITY_BEGIN();
+
+    RUN_TEST(testImageShouldBeStreamedAndActivated);
+    RUN_TEST(testHashMismatchShouldNotActivate);
+    RUN_TEST(testImageLargerThanPartitionShouldNotStart);
+    RUN_TEST(testMoreDataThanAnnouncedShouldAbort);
+    RUN_TEST(testIncompleteImageShouldAbort);
+    RUN_TEST(testInterruptedUploadShouldAbortOnDestruction);
+    RUN_TEST(testInvalidImageShouldNotActivate);
+    RUN_TEST(testDigestShouldParseOnlyHexSha256);
+
+    return UNITY_END();
+}
+
+} /* Extern "C" */
@@ -0,0 +1,111 @@
+#include "../../http_server/include/QueryParameters.hpp"
+#include "unity.h"
+
+#include <string_view>
+
+using namespace sdk::Http;
+
+namespace {
+    const std::array<QueryKey, 3> KEYS{"name", "mode", "flag"};
+} // namespace
+
+// Repeated for each test
+void setUp() {}
+
+// Repeated after each test
+void tearDown() {}
+
+void testParametersShouldBeFoundByKey() {
+    const QueryParameters<3> parameters("mode=fast&name=esp", KEYS);
+
+    TEST_ASSERT_EQUAL(2, parameters.size());
+    TEST_ASSERT_TRUE(parameters.value("name").value() == "esp");
+    TEST_ASSERT_TRUE(parameters.value("mode").value() == "fast");
+    TEST_ASSERT_FALSE(parameters.contains("flag"));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, parameters.value("flag").error());
+}
+
+void testUnknownKeysShouldBeIgnored() {
+    const QueryParameters<3> parameters("other=1&name=esp&names=2", KEYS);
+
+    TEST_ASSERT_EQUAL(1, parameters.size());
+    TEST_ASSERT_FALSE(parameters.contains("other"));
+    TEST_ASSERT_TRUE(parameters.value("name").value() == "esp");
+}
+
+void testFirstOfDuplicateKeysShouldCount() {
+    const QueryParameters<3> parameters("name=first&name=second", KEYS);
+
+    TEST_ASSERT_EQUAL(1, parameters.size());
+    TEST_ASSERT_TRUE(parameters.value("name").value() == "first");
+}
+
+void testKeyWithoutValueShouldBePresentAndEmpty() {
+    const QueryParameters<3> parameters("flag&name=&mode", KEYS);
+
+    TEST_ASSERT_EQUAL(3, parameters.size());
+    TEST_ASSERT_TRUE(parameters.contains("flag"));
+    TEST_ASSERT_TRUE(parameters.value("flag").value().empty());
+    TEST_ASSERT_TRUE(parameters.value("name").value().empty());
+    TEST_ASSERT_TRUE(parameters.raw("mode").value().empty());
+}
+
+void testEmptyPairsShouldBeSkipped() {
+    const QueryParameters<3> parameters("&&name=esp&", KEYS);
+
+    TEST_ASSERT_EQUAL(1, parameters.size());
+    TEST_ASSERT_TRUE(parameters.value("name").value() == "esp");
+}
+
+void testValuesShouldBeUrlDecoded() {
+    const QueryParameters<3> parameters("name=hello+big%20world%21&mode=%2B%3d", KEYS);
+
+    TEST_ASSERT_TRUE(parameters.value("name").value() == "hello big world!");
+    TEST_ASSERT_TRUE(parameters.value("mode").value() == "+=");
+    // raw() keeps the value as it was sent
+    TEST_ASSERT_TRUE(parameters.raw("name").value() == "hello+big%20world%21");
+}
+
+void testMalformedEscapesShouldBeKept() {
+    const QueryParameters<3> parameters("name=100%&mode=%zz%4", KEYS);
+
+    TEST_ASSERT_TRUE(parameters.value("name").value() == "100%");
+    TEST_ASSERT_TRUE(parameters.value("mode").value() == "%zz%4");
+}
+
+void testSizeShouldBeCheckedAfterDecoding() {
+    // Nine encoded characters, three decoded
+    const QueryParameters<3> parameters("name=%41%42%43", KEYS);
+
+    TEST_ASSERT_TRUE(parameters.value<3>("name").value() == "ABC");
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, parameters.value<2>("name").error());
+}
+
+void testPlusShouldBeKeptInPaths() {
+    constexpr std::string_view encoded("/a+b%20c");
+    char                       decoded[encoded.size()];
+
+    const auto length = urlDecode(encoded, decoded, false);
+    TEST_ASSERT_TRUE(std::string_view(decoded, length) == "/a+b c");
+    TEST_ASSERT_EQUAL(length, urlDecodedLength(encoded));
+}
+
+extern "C" {
+
+auto app_main(void) -> int {
+    UNITY_BEGIN();
+
+    RUN_TEST(testParametersShouldBeFoundByKey);
+    RUN_TEST(testUnknownKeysShouldBeIgnored);
+    RUN_TEST(testFirstOfDuplicateKeysShouldCount);
+    RUN_TEST(testKeyWithoutValueShouldBePresentAndEmpty);
+    RUN_TEST(testEmptyPairsShouldBeSkipped);
+    RUN_TEST(testValuesShouldBeUrlDecoded);
+    RUN_TEST(testMalformedEscapesShouldBeKept);
+    RUN_TEST(testSizeShouldBeCheckedAfterDecoding);
+    RUN_TEST(testPlusShouldBeKeptInPaths);
+
+    return UNITY_END();
+}
+
+} /* Extern "C" */
@@ -0,0 +1,113 @@
+#include "../../http_server/include/RoutePattern.hpp"
+#include "unity.h"
+
+#include <string_view>
+
+using namespace sdk::Http;
+
+namespace {
+    using Item   = RoutePattern<"/api/items/{id}/name">;
+    using Nested = RoutePattern<"/api/{group}/{id}">;
+    using Plain  = RoutePattern<"/api/status">;
+
+    // countCaptures() does not depend on the path of the pattern, any instance checks other paths
+    constexpr auto countCaptures = Plain::countCaptures;
+} // namespace
+
+// Repeated for each test
+void setUp() {}
+
+// Repeated after each test
+void tearDown() {}
+
+void testHandlerUriShouldBeLiteralPrefixWithWildcard() {
+    TEST_ASSERT_EQUAL(1, Item::N_CAPTURES);
+    TEST_ASSERT_TRUE(std::string_view(Item::handlerUri.data()) == "/api/items/*");
+    TEST_ASSERT_EQUAL(2, Nested::N_CAPTURES);
+    TEST_ASSERT_TRUE(std::string_view(Nested::handlerUri.data()) == "/api/*");
+    TEST_ASSERT_EQUAL(0, Plain::N_CAPTURES);
+    TEST_ASSERT_TRUE(std::string_view(Plain::handlerUri.data()) == "/api/status");
+}
+
+void testSegmentsShouldBeCaptured() {
+    PathParameters captures;
+    TEST_ASSERT_TRUE(Item::match("/api/items/42/name", captures));
+    TEST_ASSERT_EQUAL(1, captures.size());
+    TEST_ASSERT_TRUE(captures.raw("id").value() == "42");
+    TEST_ASSERT_EQUAL(42, captures.as<int>("id").value());
+
+    captures.clear();
+    TEST_ASSERT_TRUE(Nested::match("/api/lights/kitchen%20left", captures));
+    TEST_ASSERT_EQUAL(2, captures.size());
+    TEST_ASSERT_TRUE(captures.raw("group").value() == "lights");
+    TEST_ASSERT_TRUE(captures.value("id").value() == "kitchen left");
+}
+
+void testCaptureShouldNotSpanSegments() {
+    PathParameters captures;
+    TEST_ASSERT_FALSE(Item::match("/api/items/4/2/name", captures));
+    captures.clear();
+    TEST_ASSERT_FALSE(Nested::match("/api/lights/kitchen/left", captures));
+}
+
+void testTrailingSlashShouldNotMatch() {
+    PathParameters captures;
+    TEST_ASSERT_FALSE(Item::match("/api/items/42/name/", captures));
+    captures.clear();
+    TEST_ASSERT_FALSE(Nested::match("/api/lights/kitchen/", captures));
+    captures.clear();
+    TEST_ASSERT_FALSE(Plain::match("/api/status/", captures));
+}
+
+void testEmptySegmentShouldNotBeCaptured() {
+    PathParameters captures;
+    TEST_ASSERT_FALSE(Item::match("/api/items//name", captures));
+    captures.clear();
+    TEST_ASSERT_FALSE(Nested::match("/api/lights/", captures));
+    captures.clear();
+    TEST_ASSERT_FALSE(Nested::match("/api//kitchen", captures));
+}
+
+void testLiteralPartsShouldMatchExactly() {
+    PathParameters captures;
+    TEST_ASSERT_FALSE(Item::match("/api/items/42/names", captures));
+    captures.clear();
+    TEST_ASSERT_FALSE(Item::match("/api/items/42", captures));
+    captures.clear();
+    TEST_ASSERT_FALSE(Item::match("/api/item/42/name", captures));
+    captures.clear();
+    TEST_ASSERT_TRUE(Plain::match("/api/status", captures));
+    TEST_ASSERT_TRUE(captures.empty());
+}
+
+void testMalformedPatternsShouldBeRefused() {
+    static_assert(countCaptures("/api/{id}") == 1);
+    static_assert(countCaptures("/api/{a}/{b}/c") == 2);
+
+    TEST_ASSERT_EQUAL(-1, countCaptures("/api/{id"));
+    TEST_ASSERT_EQUAL(-1, countCaptures("/api/id}"));
+    TEST_ASSERT_EQUAL(-1, countCaptures("/api/{}"));
+    TEST_ASSERT_EQUAL(-1, countCaptures("/api/x{id}"));
+    TEST_ASSERT_EQUAL(-1, countCaptures("/api/{id}x"));
+    TEST_ASSERT_EQUAL(-1, countCaptures("/api/{i{d}"));
+    TEST_ASSERT_EQUAL(-1, countCaptures("/api/{a/b}"));
+    TEST_ASSERT_EQUAL(-1, countCaptures("{id}"));
+}
+
+extern "C" {
+
+auto app_main(void) -> int {
+    UNITY_BEGIN();
+
+    RUN_TEST(testHandlerUriShouldBeLiteralPrefixWithWildcard);
+    RUN_TEST(testSegmentsShouldBeCaptured);
+    RUN_TEST(testCaptureShouldNotSpanSegments);
+    RUN_TEST(testTrailingSlashShouldNotMatch);
+    RUN_TEST(testEmptySegmentShouldNotBeCaptured);
+    RUN_TEST(testLiteralPartsShouldMatchExactly);
+    RUN_TEST(testMalformedPatternsShouldBeRefused);
+
+    return UNITY_END();
+}
+
+} /* Extern "C" */
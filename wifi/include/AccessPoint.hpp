@@ -3,6 +3,8 @@
 
 #include <etl/vector.h>
 
+#include <mutex>
+
 #include "Component.hpp"
 #include "esp_err.h"
 #include "esp_event.h"
@@ -28,7 +30,7 @@ namespace sdk {
 
                 void allocateFields() {
                     ssid     = allocate(ssid);
-                    password = allocate(password);
+                    password = allocate(password, FieldVisibility::SECRET);
                     authMode = allocate(authMode);
                 }
 
@@ -46,7 +48,14 @@ namespace sdk {
                 esp_ip4_addr_t  ip;
             } Client;
 
-            AccessPoint() = default;
+            /**
+             * @brief Binds the config in the ConfigRegistry, so clients can read and patch it through the access point
+             */
+            AccessPoint();
+            ~AccessPoint();
+
+            AccessPoint(const AccessPoint&)            = delete;
+            AccessPoint& operator=(const AccessPoint&) = delete;
 
             /* Component override functions */
             virtual etl::string<50> getTag() override { return TAG; };
@@ -59,12 +68,22 @@ namespace sdk {
             res  initialize_non_blocking();
             void setConfig(const nlohmann::json& config, bool saveConfig = true);
 
+            /**
+             * @brief Stages the updated config in a transaction, the config is only updated once the transaction commits
+             * @param config Json merge patch with the fields to update
+             * @param transaction Transaction to stage the config in
+             * @return Error code of type esp_err_t, an invalid update is ESP_ERR_INVALID_ARG
+             */
+            std::error_code setConfig(const nlohmann::json& config, ConfigTransaction& transaction);
+
             // TODO: Implement function
             // etl::vector<ap_client_t, CONFIG_AP_MAX_CONNECTIONS> get_connectedClients();
 
         private:
             static const inline char TAG[] = "Wifi AP";
 
+            // Guards m_config, which the component task and the httpd task both use
+            std::mutex                                     m_configMutex;
             Config                                         m_config;
             etl::vector<Client, CONFIG_AP_MAX_CONNECTIONS> m_connectedClients;
             esp_netif_t*                                   m_espNetif;
@@ -75,6 +94,21 @@ namespace sdk {
 
             res error_check(esp_err_t err);
 
+            /**
+             * @brief Applies a config update and tracks the restart it requires, must be called with m_configMutex held
+             * @return The amount of changed fields and the restart they require, ESP_ERR_INVALID_ARG if the update is invalid
+             */
+            std::expected<ConfigRegistry::PatchSummary, std::error_code> patchConfig(const nlohmann::json& config);
+
+            /**
+             * @brief Applies and saves a config update from a client of the ConfigRegistry
+             */
+            std::expected<ConfigRegistry::PatchSummary, std::error_code> patchFromClient(const nlohmann::json& config);
+            /**
+             * @brief Loads the config again after a snapshot import replaced it, and tracks the restart that requires
+             */
+            std::expected<ConfigRegistry::PatchSummary, std::error_code> reloadConfig();
+
             static inline EventGroupHandle_t eventGroup = xEventGroupCreate();
         };
 
@@ -3,6 +3,9 @@
 
 #include <etl/vector.h>
 
+#include <atomic>
+#include <mutex>
+
 #include "Component.hpp"
 #include "ConfigProvider.hpp"
 #include "esp_err.h"
@@ -17,18 +20,26 @@ namespace sdk::wifi {
 
     class Station final : public Component {
     public:
-        class Config final : public ConfigObject<3, 512, "WIFI Station"> {
-            using Base = ConfigObject<3, 512, "WIFI Station">;
+        class Config final : public ConfigObject<6, 512, "WIFI Station"> {
+            using Base = ConfigObject<6, 512, "WIFI Station">;
 
         public:
             sdk::ConfigField<etl::string<31>> ssid{"", "ssid", sdk::RestartType::COMPONENT};
             sdk::ConfigField<etl::string<63>> password{"", "password", sdk::RestartType::COMPONENT};
             sdk::ConfigField<etl::string<31>> hostname{CONFIG_DEFAULT_HOSTNAME, "hostname", sdk::RestartType::COMPONENT};
 
+            // The AP of the last successful connection, written by the station itself. Channel 0 means nothing is cached
+            sdk::ConfigField<etl::string<17>>  bssid{"", "bssid"};
+            sdk::ConfigField<uint8_t>          channel{0, "channel"};
+            sdk::ConfigField<wifi_auth_mode_t> authMode{WIFI_AUTH_OPEN, "authmode"};
+
             void allocateFields() {
                 ssid     = allocate(ssid);
-                password = allocate(password);
+                password = allocate(password, FieldVisibility::SECRET);
                 hostname = allocate(hostname);
+                bssid    = allocate(bssid, FieldVisibility::INTERNAL);
+                channel  = allocate(channel, FieldVisibility::INTERNAL);
+                authMode = allocate(authMode, FieldVisibility::INTERNAL);
             }
 
             Config(const nlohmann::json& data) : Base(data) {
@@ -91,7 +102,14 @@ namespace sdk::wifi {
             int        rssi;
         };
 
-        Station() = default;
+        /**
+         * @brief Binds the config in the ConfigRegistry, so clients can read and patch it through the station
+         */
+        Station();
+        ~Station();
+
+        Station(const Station&)            = delete;
+        Station& operator=(const Station&) = delete;
 
         /* Component override functions */
         etl::string<50> getTag() override { return TAG; };
@@ -102,6 +120,9 @@ namespace sdk::wifi {
 
         /**
          * @brief Connects to the configured SSID
+         *
+         *        With CONFIG_STATION_FAST_RECONNECT, the AP of the last connection is associated with directly, on its
+         *        channel, which skips the scan of all channels. If that fails, the station falls back to a full scan.
          * @param blocking If true, the function will block until the connection is established, or times out after CONFIG_STATION_CONNECT_TIMEOUT
          * @return STATUS
          */
@@ -110,16 +131,30 @@ namespace sdk::wifi {
         static inline STATUS getWifiStatus() { return m_wifiStatus; };
 
         /**
-         * @brief Scans for available access points
-         * @note This function will block until the scan is complete
+         * @brief Gets the available access points, strongest first
+         *
+         *        Scans run in the background and finish on WIFI_EVENT_SCAN_DONE. The results are cached for
+         *        CONFIG_STATION_SCAN_CACHE_TTL seconds, callers within that time get the cached results without a scan.
+         *        A caller that finds a scan running joins it instead of starting another one, as every scan takes the
+         *        radio off channel for seconds.
          * @note initialize() must be called before this function
+         * @param blocking If true, waits for a fresh scan when the cache is stale, up to CONFIG_STATION_SCAN_TIMEOUT.
+         *                 If false, returns the cached results right away, stale or empty, and starts a scan if they are stale
          * @return etl::vector<WifiRecord, CONFIG_AP_SCAN_NUMBER> Empty vector on error or no APs found
          */
-        etl::vector<WifiRecord, CONFIG_AP_SCAN_NUMBER> scan();
+        etl::vector<WifiRecord, CONFIG_AP_SCAN_NUMBER> scan(bool blocking = true);
 
         esp_netif_t* const getNetif() { return m_networkInterface; };
         void               setConfig(const nlohmann::json& config, bool saveConfig = true);
 
+        /**
+         * @brief Stages the updated config in a transaction, the config is only updated once the transaction commits
+         * @param config Json merge patch with the fields to update
+         * @param transaction Transaction to stage the config in
+         * @return Error code of type esp_err_t, an invalid update is ESP_ERR_INVALID_ARG
+         */
+        std::error_code setConfig(const nlohmann::json& config, ConfigTransaction& transaction);
+
         /**
          * @brief Retrieves current assigned IP address
          * @return etl::string<15> Empty string if no IP assigned
@@ -129,6 +164,8 @@ namespace sdk::wifi {
     private:
         static const inline char TAG[] = "Wifi STA";
 
+        // Guards m_config, which the component task, the default event loop and the httpd task all use
+        std::mutex           m_configMutex;
         Config               m_config;
         esp_netif_t*         m_networkInterface;
         etl::string<15>      m_assignedIp;
@@ -136,12 +173,70 @@ namespace sdk::wifi {
         RestartType          m_restartType     = RestartType::NONE;
         static inline STATUS m_wifiStatus      = STATUS::NOT_RUNNING;
 
+        // Whether the driver is configured with the cached AP, and whether a connection was made since, guarded by m_configMutex
+        bool m_targeted          = false;
+        bool m_targetedConnected = false;
+        // Set by the event loop when the cached AP changed, run() saves it from the component task
+        std::atomic<bool> m_accessPointUnsaved{false};
+
+        // Results of the last scan, strongest first, guarded by m_scanMutex
+        std::mutex                                     m_scanMutex;
+        etl::vector<WifiRecord, CONFIG_AP_SCAN_NUMBER> m_scanResults;
+        TickType_t                                     m_scannedAt = 0;
+        bool                                           m_scanned   = false;
+        bool                                           m_scanning  = false;
+
         static etl::string<90> reasonToString(wifi_err_reason_t reason);
 
         static void eventHandler(void* arg, esp_event_base_t eventBase, int32_t eventId, void* eventData);
 
         res errorCheck(esp_err_t err);
 
+        /**
+         * @brief Builds the driver config for the configured SSID, takes m_configMutex
+         * @param useCache Target the cached AP, if there is one
+         */
+        wifi_config_t makeWifiConfig(bool useCache);
+
+        /**
+         * @brief Remembers the AP that was connected to, so the next connect can skip the scan. Only saved when it changed,
+         *        by the next run() on the component task rather than on the event loop.
+         */
+        void cacheAccessPoint(const wifi_event_sta_connected_t& event);
+
+        /**
+         * @brief Reconnects with a full scan when the cached AP can't be reached
+         * @param reason Why the station was disconnected
+         * @return True if a new attempt was started, the disconnect is handled
+         */
+        bool fallBackToScan(wifi_err_reason_t reason);
+
+        /**
+         * @brief Starts a scan unless one is running, must be called with m_scanMutex held
+         * @return True if a scan is running
+         */
+        bool startScan();
+
+        /**
+         * @brief Takes the records of a finished scan into the cache, keeping the strongest CONFIG_AP_SCAN_NUMBER
+         */
+        void scanDone(const wifi_event_sta_scan_done_t& event);
+
+        /**
+         * @brief Applies a config update and tracks the restart it requires, must be called with m_configMutex held
+         * @return The amount of changed fields and the restart they require, ESP_ERR_INVALID_ARG if the update is invalid
+         */
+        std::expected<ConfigRegistry::PatchSummary, std::error_code> patchConfig(const nlohmann::json& config);
+
+        /**
+         * @brief Applies and saves a config update from a client of the ConfigRegistry, which may not touch the cached AP
+         */
+        std::expected<ConfigRegistry::PatchSummary, std::error_code> patchFromClient(const nlohmann::json& config);
+        /**
+         * @brief Loads the config again after a snapshot import replaced it, and tracks the restart that requires
+         */
+        std::expected<ConfigRegistry::PatchSummary, std::error_code> reloadConfig();
+
         static inline EventGroupHandle_t eventGroup = xEventGroupCreate();
     };
 
@@ -25,6 +25,24 @@ namespace sdk::wifi {
     using Status = sdk::Component::Status;
     using res    = sdk::Component::res;
 
+    AccessPoint::AccessPoint() {
+        ConfigRegistry::bind({
+                .key    = Config::key(),
+                .owner  = this,
+                .read   = [](void* owner) {
+                    auto&           accessPoint = *static_cast<AccessPoint*>(owner);
+                    std::lock_guard lock(accessPoint.m_configMutex);
+                    return accessPoint.m_config.exposedJson();
+                },
+                .patch  = [](void* owner, const nlohmann::json& patch) { return static_cast<AccessPoint*>(owner)->patchFromClient(patch); },
+                .reload = [](void* owner) { return static_cast<AccessPoint*>(owner)->reloadConfig(); },
+        });
+    }
+
+    AccessPoint::~AccessPoint() {
+        ConfigRegistry::unbind(Config::key(), this);
+    }
+
     Status AccessPoint::run() {
         return m_status;
     }
@@ -92,12 +110,14 @@ namespace sdk::wifi {
         wifi_config_t wifiConfig = {
                 .ap = {
                         .channel        = CONFIG_AP_CHANNEL,
-                        .authmode       = m_config.authMode,
                         .max_connection = CONFIG_AP_MAX_CONNECTIONS}};
-
-        // memcopy to avoid casting errors
-        memcpy(wifiConfig.ap.ssid, m_config.ssid.value().data(), m_config.ssid.value().size());
-        memcpy(wifiConfig.ap.password, m_config.password.value().data(), m_config.password.value().size());
+        {
+            std::lock_guard lock(m_configMutex);
+            wifiConfig.ap.authmode = m_config.authMode;
+            // memcopy to avoid casting errors
+            memcpy(wifiConfig.ap.ssid, m_config.ssid.value().data(), m_config.ssid.value().size());
+            memcpy(wifiConfig.ap.password, m_config.password.value().data(), m_config.password.value().size());
+        }
 
         INIT_RETURN_ON_ERROR(esp_wifi_set_mode(new_mode));
         INIT_RETURN_ON_ERROR(esp_wifi_set_config(WIFI_IF_AP, &wifiConfig));
@@ -143,18 +163,71 @@ namespace sdk::wifi {
     }
 
     void AccessPoint::setConfig(const nlohmann::json& config, const bool saveConfig) {
-        const Config newConfig(config);
-        if (newConfig == m_config) {
-            ESP_LOGD(TAG, "Incoming config is the same, returning");
+        std::lock_guard lock(m_configMutex);
+        const auto      patched = patchConfig(config);
+        if (!patched || patched->changed == 0) {
             return;
         }
-        m_config = newConfig;
         if (saveConfig) {
             const auto ret = m_config.save();
             assert(!ret && "Failed to save config");
         }
-        //All config changes require a restart of the component
-        m_restartType = RestartType::COMPONENT;
+    }
+
+    std::error_code AccessPoint::setConfig(const nlohmann::json& config, ConfigTransaction& transaction) {
+        std::lock_guard lock(m_configMutex);
+        const auto      staged = m_config.stagePatch(config, transaction);
+        if (!staged) {
+            ESP_LOGE(TAG, "Invalid config update: %s", staged.error().message().c_str());
+            return staged.error();
+        } else if (staged->changedKeys.empty()) {
+            return {};
+        }
+        // The fields only change once the staged config is committed
+        return transaction.onCommit([this, config] {
+            std::lock_guard lock(m_configMutex);
+            patchConfig(config);
+        });
+    }
+
+    std::expected<ConfigRegistry::PatchSummary, std::error_code> AccessPoint::patchFromClient(const nlohmann::json& config) {
+        std::lock_guard lock(m_configMutex);
+        if (auto err = m_config.validateClientPatch(config)) {
+            return std::unexpected(err);
+        }
+        const auto patched = patchConfig(config);
+        if (!patched || patched->changed == 0) {
+            return patched;
+        }
+        if (auto err = m_config.save()) {
+            return std::unexpected(err);
+        }
+        return patched;
+    }
+
+    std::expected<ConfigRegistry::PatchSummary, std::error_code> AccessPoint::reloadConfig() {
+        std::lock_guard lock(m_configMutex);
+        const auto      reloaded = m_config.reload();
+        if (!reloaded) {
+            ESP_LOGE(TAG, "Error reloading config: %s", reloaded.error().message().c_str());
+            return std::unexpected(reloaded.error());
+        }
+        m_restartType = std::max(m_restartType, reloaded->restartType);
+        return ConfigRegistry::PatchSummary{.changed = reloaded->changedKeys.size(), .restartType = reloaded->restartType};
+    }
+
+    std::expected<ConfigRegistry::PatchSummary, std::error_code> AccessPoint::patchConfig(const nlohmann::json& config) {
+        const auto patched = m_config.applyPatch(config);
+        if (!patched) {
+            ESP_LOGE(TAG, "Invalid config update: %s", patched.error().message().c_str());
+            return std::unexpected(patched.error());
+        }
+        if (patched->changedKeys.empty()) {
+            ESP_LOGD(TAG, "Incoming config is the same, returning");
+            return ConfigRegistry::PatchSummary{};
+        }
+        m_restartType = std::max(m_restartType, patched->restartType);
+        return ConfigRegistry::PatchSummary{.changed = patched->changedKeys.size(), .restartType = patched->restartType};
     }
 
 
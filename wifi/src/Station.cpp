@@ -1,8 +1,11 @@
 #include "Station.hpp"
 
 #include <lwip/ip4_addr.h>
+#include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
+
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_mac.h"
@@ -11,9 +14,11 @@
 #include "esp_wifi.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
+#include "freertos/task.h"
 
 #define STA_CONNECTED_BIT BIT0
 #define STA_DISCONNECTED_BIT BIT1
+#define STA_SCAN_DONE_BIT BIT2
 
 #define INIT_RETURN_ON_ERROR(err)                                      \
     do {                                                               \
@@ -30,7 +35,32 @@ namespace sdk {
         using Status = Component::Status;
         using res    = Component::res;
 
+        Station::Station() {
+            ConfigRegistry::bind({
+                    .key    = Config::key(),
+                    .owner  = this,
+                    .read   = [](void* owner) {
+                        auto&           station = *static_cast<Station*>(owner);
+                        std::lock_guard lock(station.m_configMutex);
+                        return station.m_config.exposedJson();
+                    },
+                    .patch  = [](void* owner, const nlohmann::json& patch) { return static_cast<Station*>(owner)->patchFromClient(patch); },
+                    .reload = [](void* owner) { return static_cast<Station*>(owner)->reloadConfig(); },
+            });
+        }
+
+        Station::~Station() {
+            ConfigRegistry::unbind(Config::key(), this);
+        }
+
         Status Station::run() {
+            // The AP cached by the event loop is saved here, NVS writes would hold up every other event handler
+            if (m_accessPointUnsaved.exchange(false)) {
+                std::lock_guard lock(m_configMutex);
+                if (auto err = m_config.save()) {
+                    ESP_LOGW(TAG, "Failed to save the connected AP: %s", err.message().c_str());
+                }
+            }
             return m_status;
         }
 
@@ -53,6 +83,12 @@ namespace sdk {
                     return m_status = Status::ERROR;
                 }
             }
+            {
+                // A running scan is dropped with the station, its waiters get the cached results
+                std::lock_guard lock(m_scanMutex);
+                m_scanning = false;
+                xEventGroupSetBits(eventGroup, STA_SCAN_DONE_BIT);
+            }
             return m_status = Status::STOPPED;
         }
 
@@ -83,17 +119,20 @@ namespace sdk {
 
             esp_wifi_set_default_wifi_sta_handlers();
 
-            esp_netif_set_hostname(m_networkInterface, m_config.hostname.value().c_str());
+            {
+                std::lock_guard lock(m_configMutex);
+                esp_netif_set_hostname(m_networkInterface, m_config.hostname.value().c_str());
+            }
 
             INIT_RETURN_ON_ERROR(esp_event_handler_instance_register(WIFI_EVENT,
                                                                      ESP_EVENT_ANY_ID,
                                                                      &eventHandler,
-                                                                     NULL,
+                                                                     this,
                                                                      NULL));
             INIT_RETURN_ON_ERROR(esp_event_handler_instance_register(IP_EVENT,
                                                                      IP_EVENT_STA_GOT_IP,
                                                                      &eventHandler,
-                                                                     NULL,
+                                                                     this,
                                                                      NULL));
 
             INIT_RETURN_ON_ERROR(esp_wifi_set_mode(new_mode));
@@ -112,22 +151,18 @@ namespace sdk {
                 return STATUS::NOT_RUNNING;
             }
 
-            if (m_config.ssid.value().empty()) {
-                ESP_LOGE(TAG, "SSID is empty, returning");
-                return STATUS::EMPTY_CONFIG;
-            }
-
-            wifi_config_t wifiConfig = {
-                    .sta = {
-                            .bssid_set = false,
-                            .pmf_cfg   = {
-                                      .required = true}}};
+            {
+                std::lock_guard lock(m_configMutex);
+                if (m_config.ssid.value().empty()) {
+                    ESP_LOGE(TAG, "SSID is empty, returning");
+                    return STATUS::EMPTY_CONFIG;
+                }
 
-            memcpy(wifiConfig.sta.ssid, m_config.ssid.value().data(), m_config.ssid.value().size());
-            if (m_config.password.value().empty()) {
-                ESP_LOGW(TAG, "Password is empty, connecting without password");
+                if (m_config.password.value().empty()) {
+                    ESP_LOGW(TAG, "Password is empty, connecting without password");
+                }
             }
-            memcpy(wifiConfig.sta.password, m_config.password.value().data(), m_config.password.value().size());
+            wifi_config_t wifiConfig = makeWifiConfig(true);
 
             auto ret = esp_wifi_set_config(WIFI_IF_STA, &wifiConfig);
             if (ret != ESP_OK) {
@@ -135,7 +170,11 @@ namespace sdk {
                 return m_wifiStatus = STATUS::ERROR;
             }
 
-            ESP_LOGI(TAG, "Attempting to connect to: \"%s\"", wifiConfig.sta.ssid);
+            if (wifiConfig.sta.bssid_set) {
+                ESP_LOGI(TAG, "Attempting to connect to: \"%s\" at " MACSTR " on channel %u", wifiConfig.sta.ssid, MAC2STR(wifiConfig.sta.bssid), wifiConfig.sta.channel);
+            } else {
+                ESP_LOGI(TAG, "Attempting to connect to: \"%s\"", wifiConfig.sta.ssid);
+            }
 
             ret = esp_wifi_connect();
             if (ret != ESP_OK) {
@@ -167,6 +206,12 @@ namespace sdk {
 
         void Station::eventHandler(void* arg, esp_event_base_t eventBase,
                                    int32_t eventId, void* eventData) {
+            auto* station = static_cast<Station*>(arg);
+            // Shares its id with IP_EVENT_STA_LOST_IP, so it can't be a case of the switch below
+            if (eventBase == WIFI_EVENT && eventId == WIFI_EVENT_SCAN_DONE) {
+                station->scanDone(*static_cast<wifi_event_sta_scan_done_t*>(eventData));
+                return;
+            }
             switch (eventId) {
                 case WIFI_EVENT_STA_START: {
                     ESP_LOGI(TAG, "Has started");
@@ -181,6 +226,7 @@ namespace sdk {
                     wifi_event_sta_connected_t* event = static_cast<wifi_event_sta_connected_t*>(eventData);
                     ESP_LOGI(TAG, "Successfully connected to: %s", event->ssid);
                     m_wifiStatus = STATUS::CONNECTED;
+                    station->cacheAccessPoint(*event);
                     break;
                 }
                 case WIFI_EVENT_STA_DISCONNECTED: {
@@ -188,6 +234,11 @@ namespace sdk {
                     wifi_err_reason_t              reason = static_cast<wifi_err_reason_t>(event->reason);
                     ESP_LOGW(TAG, "Disconnected from a network, reason: (%u) %s", reason, reasonToString(reason).c_str());
 
+                    if (station->fallBackToScan(reason)) {
+                        m_wifiStatus = STATUS::RECONNECTING;
+                        return;
+                    }
+
                     switch (reason) {
                         case WIFI_REASON_AUTH_FAIL: {
                             ESP_LOGE(TAG, "Authentication failed, not reconnecting");
@@ -232,18 +283,157 @@ namespace sdk {
         }
 
         void Station::setConfig(const nlohmann::json& config, const bool saveConfig) {
-            const Config newConfig(config);
-            if (newConfig == m_config) {
-                ESP_LOGD(TAG, "Incoming config is the same, returning");
+            std::lock_guard lock(m_configMutex);
+            const auto      patched = patchConfig(config);
+            if (!patched || patched->changed == 0) {
                 return;
             }
-            m_config = newConfig;
             if (saveConfig) {
                 const auto ret = m_config.save();
                 assert(!ret && "Failed to save config");
             }
-            // All config changes require a restart of the component
-            m_restartType = RestartType::COMPONENT;
+        }
+
+        std::error_code Station::setConfig(const nlohmann::json& config, ConfigTransaction& transaction) {
+            std::lock_guard lock(m_configMutex);
+            // Stage the cached AP being forgotten as well, patchConfig() does the same once committed
+            nlohmann::json patch   = config;
+            const auto     differs = [&config](const char* key, const auto& current) { return config.contains(key) && config.at(key) != nlohmann::json(current); };
+            if ((differs("ssid", m_config.ssid.value()) || differs("password", m_config.password.value())) && m_config.channel.value() != 0) {
+                patch["bssid"]   = "";
+                patch["channel"] = 0;
+            }
+
+            const auto staged = m_config.stagePatch(patch, transaction);
+            if (!staged) {
+                ESP_LOGE(TAG, "Invalid config update: %s", staged.error().message().c_str());
+                return staged.error();
+            } else if (staged->changedKeys.empty()) {
+                return {};
+            }
+            // The fields only change once the staged config is committed
+            return transaction.onCommit([this, config] {
+                std::lock_guard lock(m_configMutex);
+                patchConfig(config);
+            });
+        }
+
+        std::expected<ConfigRegistry::PatchSummary, std::error_code> Station::patchFromClient(const nlohmann::json& config) {
+            std::lock_guard lock(m_configMutex);
+            if (auto err = m_config.validateClientPatch(config)) {
+                return std::unexpected(err);
+            }
+            const auto patched = patchConfig(config);
+            if (!patched || patched->changed == 0) {
+                return patched;
+            }
+            if (auto err = m_config.save()) {
+                return std::unexpected(err);
+            }
+            return patched;
+        }
+
+        std::expected<ConfigRegistry::PatchSummary, std::error_code> Station::reloadConfig() {
+            std::lock_guard lock(m_configMutex);
+            const auto      reloaded = m_config.reload();
+            if (!reloaded) {
+                ESP_LOGE(TAG, "Error reloading config: %s", reloaded.error().message().c_str());
+                return std::unexpected(reloaded.error());
+            }
+            m_restartType = std::max(m_restartType, reloaded->restartType);
+            return ConfigRegistry::PatchSummary{.changed = reloaded->changedKeys.size(), .restartType = reloaded->restartType};
+        }
+
+        std::expected<ConfigRegistry::PatchSummary, std::error_code> Station::patchConfig(const nlohmann::json& config) {
+            const auto patched = m_config.applyPatch(config);
+            if (!patched) {
+                ESP_LOGE(TAG, "Invalid config update: %s", patched.error().message().c_str());
+                return std::unexpected(patched.error());
+            }
+            if (patched->changedKeys.empty()) {
+                ESP_LOGD(TAG, "Incoming config is the same, returning");
+                return ConfigRegistry::PatchSummary{};
+            }
+            // The cached AP belongs to the old network
+            const auto networkChanged = std::any_of(patched->changedKeys.begin(), patched->changedKeys.end(), [](const ConfigKey& key) { return key == "ssid" || key == "password"; });
+            if (networkChanged && m_config.channel.value() != 0) {
+                m_config.updateField(m_config.bssid, etl::string<17>());
+                m_config.updateField(m_config.channel, uint8_t{0});
+            }
+            m_restartType = std::max(m_restartType, patched->restartType);
+            return ConfigRegistry::PatchSummary{.changed = patched->changedKeys.size(), .restartType = patched->restartType};
+        }
+
+        wifi_config_t Station::makeWifiConfig([[maybe_unused]] const bool useCache) {
+            wifi_config_t wifiConfig = {
+                    .sta = {
+                            .bssid_set = false,
+                            .pmf_cfg   = {
+                                      .required = true}}};
+
+            std::lock_guard lock(m_configMutex);
+            memcpy(wifiConfig.sta.ssid, m_config.ssid.value().data(), m_config.ssid.value().size());
+            memcpy(wifiConfig.sta.password, m_config.password.value().data(), m_config.password.value().size());
+
+            m_targeted          = false;
+            m_targetedConnected = false;
+#ifdef CONFIG_STATION_FAST_RECONNECT
+            uint8_t bssid[6];
+            if (useCache && m_config.channel.value() != 0 && sscanf(m_config.bssid.value().c_str(), "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &bssid[0], &bssid[1], &bssid[2], &bssid[3], &bssid[4], &bssid[5]) == 6) {
+                wifiConfig.sta.bssid_set = true;
+                memcpy(wifiConfig.sta.bssid, bssid, sizeof(bssid));
+                wifiConfig.sta.channel            = m_config.channel.value();
+                wifiConfig.sta.threshold.authmode = m_config.authMode.value();
+                m_targeted                        = true;
+            }
+#endif
+            return wifiConfig;
+        }
+
+        void Station::cacheAccessPoint([[maybe_unused]] const wifi_event_sta_connected_t& event) {
+            // Runs on the default event loop, while the config may be changed from the component or the httpd task
+            std::lock_guard lock(m_configMutex);
+            m_targetedConnected = m_targeted;
+#ifdef CONFIG_STATION_FAST_RECONNECT
+            etl::string<17> bssid;
+            bssid.uninitialized_resize(snprintf(bssid.data(), bssid.max_size() + 1, MACSTR, MAC2STR(event.bssid)));
+
+            if (bssid == m_config.bssid.value() && event.channel == m_config.channel.value() && event.authmode == m_config.authMode.value()) {
+                return;
+            }
+
+            ESP_LOGD(TAG, "Caching AP %s on channel %u", bssid.c_str(), event.channel);
+            m_config.updateField(m_config.bssid, bssid);
+            m_config.updateField(m_config.channel, event.channel);
+            m_config.updateField(m_config.authMode, event.authmode);
+            m_accessPointUnsaved = true;
+#endif
+        }
+
+        bool Station::fallBackToScan(const wifi_err_reason_t reason) {
+            {
+                std::lock_guard lock(m_configMutex);
+                if (!m_targeted || reason == WIFI_REASON_AUTH_FAIL || reason == WIFI_REASON_ASSOC_LEAVE) {
+                    return false;
+                }
+                if (m_targetedConnected && reason != WIFI_REASON_NO_AP_FOUND) {
+                    // A connection to the cached AP was lost, it is likely still there, so it is retried once as usual
+                    m_targetedConnected = false;
+                    return false;
+                }
+            }
+
+            ESP_LOGW(TAG, "Cached AP can't be reached, connecting with a full scan");
+            wifi_config_t wifiConfig = makeWifiConfig(false);
+            if (auto err = esp_wifi_set_config(WIFI_IF_STA, &wifiConfig); err != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to set wifi config: %s", esp_err_to_name(err));
+                return false;
+            }
+            if (auto err = esp_wifi_connect(); err != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to reconnect to wifi: %s", esp_err_to_name(err));
+                return false;
+            }
+            return true;
         }
 
         etl::string<15> Station::getAssignedIp() {
@@ -264,48 +454,81 @@ namespace sdk {
             return ip;
         }
 
-        etl::vector<Station::WifiRecord, CONFIG_AP_SCAN_NUMBER> Station::scan() {
-            if(!m_wifiInitialized){
+        etl::vector<Station::WifiRecord, CONFIG_AP_SCAN_NUMBER> Station::scan(const bool blocking) {
+            if (!m_wifiInitialized) {
                 ESP_LOGE(TAG, "Wifi is not initialized, unable to perform scan, returning");
                 return {};
             }
 
-            ESP_LOGD(TAG, "Starting scan...");
-            auto err = esp_wifi_scan_start(NULL, true);
-            if (err != ESP_OK) {
-                ESP_LOGE(TAG, "Failed to start scan: %s", esp_err_to_name(err));
-                return {};
+            {
+                std::lock_guard lock(m_scanMutex);
+                const bool      fresh = m_scanned && xTaskGetTickCount() - m_scannedAt < pdMS_TO_TICKS(CONFIG_STATION_SCAN_CACHE_TTL * 1000);
+                if (fresh || !startScan() || !blocking) {
+                    return m_scanResults;
+                }
             }
 
-            uint16_t ap_count = 0;
-            err = esp_wifi_scan_get_ap_num(&ap_count);
-            if (err != ESP_OK) {
-                ESP_LOGE(TAG, "Failed to get scan count: %s", esp_err_to_name(err));
-                return {};
+            const EventBits_t bits = xEventGroupWaitBits(eventGroup, STA_SCAN_DONE_BIT, pdFALSE, pdFALSE, pdMS_TO_TICKS(CONFIG_STATION_SCAN_TIMEOUT * 1000));
+
+            std::lock_guard lock(m_scanMutex);
+            if ((bits & STA_SCAN_DONE_BIT) == 0) {
+                ESP_LOGE(TAG, "Scan timed out after %d seconds", CONFIG_STATION_SCAN_TIMEOUT);
+                // Lets the next caller start a new scan, should the event never arrive
+                m_scanning = false;
+            }
+            return m_scanResults;
+        }
+
+        bool Station::startScan() {
+            if (m_scanning) {
+                ESP_LOGD(TAG, "Scan already running, waiting for its results");
+                return true;
             }
-            ESP_LOGD(TAG, "Scan finished; found %d APs", ap_count);
 
-            uint16_t scanCount = CONFIG_AP_SCAN_NUMBER;
-            std::array<wifi_ap_record_t, CONFIG_AP_SCAN_NUMBER> apRecords;
-            err = esp_wifi_scan_get_ap_records(&scanCount, apRecords.data());
+            xEventGroupClearBits(eventGroup, STA_SCAN_DONE_BIT);
+            ESP_LOGD(TAG, "Starting scan...");
+            auto err = esp_wifi_scan_start(NULL, false);
             if (err != ESP_OK) {
-                ESP_LOGE(TAG, "Failed to get scan records: %s", esp_err_to_name(err));
-                return {};
+                ESP_LOGE(TAG, "Failed to start scan: %s", esp_err_to_name(err));
+                return false;
             }
+            return m_scanning = true;
+        }
 
-            if(scanCount > CONFIG_AP_SCAN_NUMBER){
-                ESP_LOGW(TAG, "Scanned more AP than the configured maximum, truncating to %d", CONFIG_AP_SCAN_NUMBER);
-                scanCount = CONFIG_AP_SCAN_NUMBER;
+        void Station::scanDone(const wifi_event_sta_scan_done_t& event) {
+            if (event.status != 0) {
+                ESP_LOGW(TAG, "Scan failed, keeping the previous results");
+                std::lock_guard lock(m_scanMutex);
+                m_scanning = false;
+                xEventGroupSetBits(eventGroup, STA_SCAN_DONE_BIT);
+                return;
             }
+            ESP_LOGD(TAG, "Scan finished; found %d APs", event.number);
 
+            // Records are taken one at a time, which frees them in the driver and keeps them off the event task stack
             etl::vector<WifiRecord, CONFIG_AP_SCAN_NUMBER> aps;
-            ESP_LOGD(TAG, "Found APs:\n");
-            for (int i = 0; i < scanCount; i++) {
-                ESP_LOGD(TAG, "\tSSID: %s, RSSI: %d", apRecords[i].ssid, apRecords[i].rssi);
-                aps.emplace_back(etl::string<32>(reinterpret_cast<char*>(apRecords[i].ssid), sizeof(apRecords[i].ssid)), apRecords[i].rssi);
+            wifi_ap_record_t                               record;
+            while (esp_wifi_scan_get_ap_record(&record) == ESP_OK) {
+                ESP_LOGD(TAG, "\tSSID: %s, RSSI: %d", record.ssid, record.rssi);
+                const auto position = std::upper_bound(aps.begin(), aps.end(), record.rssi, [](const int rssi, const WifiRecord& ap) { return rssi > ap.rssi; });
+                if (aps.full()) {
+                    if (position == aps.end()) {
+                        continue;
+                    }
+                    aps.pop_back();
+                }
+                aps.insert(position, WifiRecord{etl::string<32>(reinterpret_cast<const char*>(record.ssid)), record.rssi});
+            }
+            if (event.number > CONFIG_AP_SCAN_NUMBER) {
+                ESP_LOGD(TAG, "Scanned more AP than the configured maximum, keeping the strongest %d", CONFIG_AP_SCAN_NUMBER);
             }
 
-            return aps;
+            std::lock_guard lock(m_scanMutex);
+            m_scanResults = aps;
+            m_scannedAt   = xTaskGetTickCount();
+            m_scanned     = true;
+            m_scanning    = false;
+            xEventGroupSetBits(eventGroup, STA_SCAN_DONE_BIT);
         }
 
         etl::string<90> Station::reasonToString(wifi_err_reason_t reason) {